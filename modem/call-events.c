@@ -0,0 +1,286 @@
+/*
+ * modem/call-events.c - Log of call state transitions
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * The state transitions of calls are kept in a fixed-size ring buffer,
+ * overwriting the oldest ones. The log is only touched from the main
+ * loop, so no locking is needed. Logging a transition of a known call
+ * does not allocate memory. The first transition of a call allocates
+ * a small record for it, freed when oFono removes the call, and
+ * interns its object path. oFono reuses the paths, so only a few are
+ * ever interned.
+ *
+ * The latencies of call setup and teardown are derived as the events
+ * are logged, so they cover also the events no longer in the log.
+ */
+
+#include "config.h"
+
+#define MODEM_DEBUG_FLAG MODEM_LOG_CALL
+
+#include "debug.h"
+
+#include "modem/call.h"
+#include "modem/call-events.h"
+
+typedef struct {
+  guint state;
+  gint64 dialing;               /* Entered DIALING */
+  gint64 ringing;               /* Entered ALERTING, INCOMING or WAITING */
+  gint64 teardown;              /* Hangup requested or DISCONNECTED */
+} ModemCallEventsCall;
+
+struct _ModemCallEvents
+{
+  ModemCallEvent *ring;
+  guint mask;                   /* Size of ring - 1 */
+  guint next;                   /* Index of next event, wraps around */
+  /* Interned path => ModemCallEventsCall */
+  GHashTable *calls;
+  ModemCallEventsStats stats;
+};
+
+/** Create a log keeping the last @a size transitions.
+ *
+ * The @a size is rounded up to a power of two.
+ */
+ModemCallEvents *
+modem_call_events_new (guint size)
+{
+  ModemCallEvents *self = g_slice_new0 (ModemCallEvents);
+  guint n;
+
+  for (n = 1; n < size && n < (1U << 16); n <<= 1)
+    ;
+
+  self->ring = g_new0 (ModemCallEvent, n);
+  self->mask = n - 1;
+  self->calls = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, g_free);
+
+  return self;
+}
+
+void
+modem_call_events_free (ModemCallEvents *self)
+{
+  if (self == NULL)
+    return;
+
+  g_hash_table_destroy (self->calls);
+  g_free (self->ring);
+  g_slice_free (ModemCallEvents, self);
+}
+
+static void
+modem_call_events_latency (ModemCallEventsLatency *m,
+                           gint64 since,
+                           gint64 now)
+{
+  guint64 latency = now > since ? now - since : 0;
+  guint i;
+
+  m->count++;
+  m->total += latency;
+  if (latency > m->max)
+    m->max = latency;
+
+  /* Bucket 0 is below 1 ms, bucket i is below 2**i ms */
+  for (i = 0; i < MODEM_REQUEST_N_BUCKETS - 1; i++)
+    if (latency < (G_GUINT64_CONSTANT (1000) << i))
+      break;
+  m->buckets[i]++;
+}
+
+static void
+modem_call_events_append (ModemCallEvents *self,
+                          char const *path,
+                          guint old_state,
+                          guint new_state,
+                          guint causetype,
+                          guint cause,
+                          gint64 now)
+{
+  ModemCallEvent *event = self->ring + (self->next++ & self->mask);
+
+  if (event->path)
+    self->stats.dropped++;
+  self->stats.logged++;
+
+  event->path = path;
+  event->time = now;
+  event->old_state = old_state;
+  event->new_state = new_state;
+  event->causetype = causetype;
+  event->cause = cause;
+}
+
+static ModemCallEventsCall *
+modem_call_events_call (ModemCallEvents *self,
+                        char const *path)
+{
+  ModemCallEventsCall *call = g_hash_table_lookup (self->calls, path);
+
+  if (call == NULL)
+    {
+      call = g_new0 (ModemCallEventsCall, 1);
+      call->state = MODEM_CALL_STATE_INVALID;
+      g_hash_table_insert (self->calls, (gpointer) path, call);
+    }
+
+  return call;
+}
+
+/** Log the call at @a path entering @a state.
+ *
+ * A call is forgotten when it enters MODEM_CALL_STATE_INVALID, that
+ * is, when oFono removes it.
+ */
+void
+modem_call_events_log (ModemCallEvents *self,
+                       char const *path,
+                       guint state,
+                       guint causetype,
+                       guint cause,
+                       gint64 now)
+{
+  ModemCallEventsCall *call;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (path != NULL);
+
+  path = g_intern_string (path);
+
+  if (state == MODEM_CALL_STATE_INVALID)
+    {
+      /* Do not create a record for a call removed before it was logged */
+      call = g_hash_table_lookup (self->calls, path);
+      if (call == NULL)
+        return;
+    }
+  else
+    call = modem_call_events_call (self, path);
+
+  if (call->state == state)
+    return;
+
+  DEBUG ("%s: %s -> %s", path,
+      modem_call_event_state_name (call->state),
+      modem_call_event_state_name (state));
+
+  modem_call_events_append (self, path, call->state, state,
+      causetype, cause, now);
+
+  call->state = state;
+
+  switch (state)
+    {
+    case MODEM_CALL_STATE_DIALING:
+      call->dialing = now;
+      break;
+
+    case MODEM_CALL_STATE_ALERTING:
+      if (call->dialing)
+        modem_call_events_latency (&self->stats.post_dial, call->dialing, now);
+      call->dialing = 0;
+      /* FALLTHROUGH */
+    case MODEM_CALL_STATE_INCOMING:
+    case MODEM_CALL_STATE_WAITING:
+      if (call->ringing == 0)
+        call->ringing = now;
+      break;
+
+    case MODEM_CALL_STATE_ACTIVE:
+      if (call->ringing)
+        modem_call_events_latency (&self->stats.answer, call->ringing, now);
+      call->dialing = call->ringing = 0;
+      break;
+
+    case MODEM_CALL_STATE_DISCONNECTED:
+      if (call->teardown == 0)
+        call->teardown = now;
+      break;
+
+    case MODEM_CALL_STATE_INVALID:
+      if (call->teardown)
+        modem_call_events_latency (&self->stats.teardown, call->teardown, now);
+      g_hash_table_remove (self->calls, path);
+      break;
+
+    default:
+      break;
+    }
+}
+
+/** Log a request to hang up the call at @a path. */
+void
+modem_call_events_log_release (ModemCallEvents *self,
+                               char const *path,
+                               gint64 now)
+{
+  ModemCallEventsCall *call;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (path != NULL);
+
+  path = g_intern_string (path);
+  call = g_hash_table_lookup (self->calls, path);
+  if (call == NULL)
+    return;
+
+  modem_call_events_append (self, path, call->state, MODEM_CALL_EVENT_RELEASE,
+      0, 0, now);
+
+  if (call->teardown == 0)
+    call->teardown = now;
+}
+
+/** Call @a func for each logged event, oldest first. */
+void
+modem_call_events_foreach (ModemCallEvents const *self,
+                           ModemCallEventFunc *func,
+                           gpointer user_data)
+{
+  guint i, n;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (func != NULL);
+
+  n = MIN (self->next, self->mask + 1);
+
+  for (i = self->next - n; i != self->next; i++)
+    func (self->ring + (i & self->mask), user_data);
+}
+
+void
+modem_call_events_get_stats (ModemCallEvents const *self,
+                             ModemCallEventsStats *return_stats)
+{
+  *return_stats = self->stats;
+}
+
+char const *
+modem_call_event_state_name (guint state)
+{
+  if (state == MODEM_CALL_EVENT_RELEASE)
+    return "RELEASE";
+  else
+    return modem_call_get_state_name (state);
+}
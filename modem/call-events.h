@@ -0,0 +1,88 @@
+/*
+ * modem/call-events.h - Log of call state transitions
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _MODEM_CALL_EVENTS_H_
+#define _MODEM_CALL_EVENTS_H_
+
+#include <glib.h>
+
+#include <modem/request.h>
+
+G_BEGIN_DECLS
+
+/* Number of transitions kept by default */
+#define MODEM_CALL_EVENTS_SIZE (256)
+
+/* Pseudo state logged when the call is asked to hang up */
+#define MODEM_CALL_EVENT_RELEASE (0xff)
+
+typedef struct _ModemCallEvents ModemCallEvents;
+
+typedef struct {
+  char const *path;             /* Interned object path of the call */
+  gint64 time;                  /* Monotonic time in microseconds */
+  guint8 old_state, new_state;  /* ModemCallState or RELEASE */
+  guint8 causetype, cause;
+} ModemCallEvent;
+
+typedef struct {
+  guint count;
+  guint64 total;                /* Microseconds */
+  guint64 max;                  /* Microseconds */
+  guint buckets[MODEM_REQUEST_N_BUCKETS];
+} ModemCallEventsLatency;
+
+typedef struct {
+  guint logged;                 /* Events logged */
+  guint dropped;                /* Events overwritten by newer ones */
+  ModemCallEventsLatency post_dial; /* DIALING to ALERTING */
+  ModemCallEventsLatency answer;    /* ALERTING, INCOMING or WAITING to ACTIVE */
+  ModemCallEventsLatency teardown;  /* Hangup or DISCONNECTED to removal */
+} ModemCallEventsStats;
+
+typedef void ModemCallEventFunc (ModemCallEvent const *event,
+    gpointer user_data);
+
+ModemCallEvents *modem_call_events_new (guint size);
+void modem_call_events_free (ModemCallEvents *self);
+
+void modem_call_events_log (ModemCallEvents *self,
+    char const *path,
+    guint state,
+    guint causetype,
+    guint cause,
+    gint64 now);
+
+void modem_call_events_log_release (ModemCallEvents *self,
+    char const *path,
+    gint64 now);
+
+void modem_call_events_foreach (ModemCallEvents const *self,
+    ModemCallEventFunc *func,
+    gpointer user_data);
+
+void modem_call_events_get_stats (ModemCallEvents const *self,
+    ModemCallEventsStats *return_stats);
+
+char const *modem_call_event_state_name (guint state);
+
+G_END_DECLS
+
+#endif /* #ifndef _MODEM_CALL_EVENTS_H_*/
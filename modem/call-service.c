@@ -26,6 +26,8 @@
 #include "modem/debug.h"
 
 #include "modem/call.h"
+#include "modem/call-events.h"
+#include "modem/chars.h"
 #include "modem/ofono.h"
 #include "modem/errors.h"
 
@@ -82,6 +84,11 @@ struct _ModemCallServicePrivate
 
   ModemCall *active, *hold;
 
+  /* Monotonic time the CallAdded being handled was received */
+  gint64 call_added;
+
+  ModemCallEvents *events;
+
   unsigned user_connection:1;   /* Do we have in-band connection? */
 
   unsigned signals :1;
@@ -149,6 +156,8 @@ modem_call_service_init (ModemCallService *self)
 
   self->priv->instances = g_hash_table_new_full (
       g_str_hash, g_str_equal, NULL, g_object_unref);
+
+  self->priv->events = modem_call_events_new (MODEM_CALL_EVENTS_SIZE);
 }
 
 static void
@@ -217,6 +226,7 @@ modem_call_service_finalize (GObject *object)
   g_strfreev (priv->emergency_numbers), priv->emergency_numbers = NULL;
 
   g_hash_table_destroy (priv->instances);
+  modem_call_events_free (priv->events);
 
   G_OBJECT_CLASS (modem_call_service_parent_class)->finalize (object);
 
@@ -431,6 +441,9 @@ modem_call_service_connect_to_instance (ModemCallService *self,
   if (!instance)
     return;
 
+  /* Call instances inherit the request timeout from service */
+  modem_request_set_timeout (instance, modem_request_get_timeout (self));
+
   g_signal_connect (instance, "state", G_CALLBACK (on_modem_call_state), self);
 
   modem_oface_connect (MODEM_OFACE (instance));
@@ -453,6 +466,9 @@ modem_call_service_disconnect_instance (ModemCallService *self,
 
   g_signal_handlers_disconnect_by_func (instance, on_modem_call_state, self);
 
+  modem_call_events_log (priv->events, modem_call_get_path (instance),
+      MODEM_CALL_STATE_INVALID, 0, 0, g_get_monotonic_time ());
+
   g_signal_emit (self, signals[SIGNAL_REMOVED], 0, instance);
 
   modem_oface_disconnect (MODEM_OFACE (instance));
@@ -533,6 +549,9 @@ modem_call_service_ensure_instance (ModemCallService *self,
   modem_oface_update_properties (MODEM_OFACE (ci), properties);
   modem_call_service_connect_to_instance (self, ci);
 
+  modem_call_events_log (priv->events, object_path, state, 0, 0,
+      priv->call_added ? priv->call_added : g_get_monotonic_time ());
+
   if (incoming)
     {
       DEBUG ("emit \"incoming\" (\"%s\" (%p), \"%s\")",
@@ -599,7 +618,27 @@ on_manager_call_added (DBusGProxy *proxy,
 
   DEBUG ("%s", path);
 
+  self->priv->call_added = g_get_monotonic_time ();
   modem_call_service_ensure_instance (self, path, properties);
+  self->priv->call_added = 0;
+}
+
+/** Return the monotonic time when CallAdded was received.
+ *
+ * This is only known while the "incoming" or "created" signal for the
+ * added call is being emitted; otherwise zero is returned.
+ */
+gint64
+modem_call_service_time_call_added (ModemCallService const *self)
+{
+  return self->priv->call_added;
+}
+
+/** Return the log of call state transitions. */
+ModemCallEvents *
+modem_call_service_get_events (ModemCallService *self)
+{
+  return self->priv->events;
 }
 
 static void
@@ -969,6 +1008,20 @@ on_modem_call_state (ModemCall *ci,
 
   priv = self->priv;
 
+  if (state == MODEM_CALL_STATE_DISCONNECTED)
+    {
+      guint causetype = 0, cause = 0;
+
+      g_object_get (ci, "causetype", &causetype, "cause", &cause, NULL);
+      modem_call_events_log (priv->events, modem_call_get_path (ci), state,
+          causetype, cause, g_get_monotonic_time ());
+    }
+  else
+    {
+      modem_call_events_log (priv->events, modem_call_get_path (ci), state,
+          0, 0, g_get_monotonic_time ());
+    }
+
   switch (state)
     {
     case MODEM_CALL_STATE_ACTIVE:
@@ -1206,7 +1259,7 @@ modem_call_service_get_calls (ModemCallService *self)
 static char const *
 _modem_call_validate_address (char const *address)
 {
-  size_t n, m;
+  size_t n;
 
   if (address == NULL)
     return "no destination";
@@ -1220,44 +1273,7 @@ _modem_call_validate_address (char const *address)
       return NULL;
     }
 
-  /* Remove regocnized service prefixes */
-  if (g_str_has_prefix (address, "*31#"))
-    address += 4;
-  else if (g_str_has_prefix (address, "#31#"))
-    address += 4;
-
-  if (*address == '+')
-    address++;
-
-  n = strspn (address, "0123456789abc*#");
-  if (n == 0)
-    {
-      if (address[n])
-        return "not a phone number";
-      else
-        return "too short";
-    }
-  if (n > 20)
-    return "too long";
-
-  if (address[n - 1] == '#')
-    return "invalid service code";
-
-  /* Possible dialstring */
-  m = strspn (address + n, "0123456789abc*#pwPW");
-  if (address[n + m] != '\0')
-    {
-      if (m == 0)
-        return "invalid address";
-      else
-        return "invalid dial string";
-    }
-
-  if (m == 1)
-    return "invalid dial string";
-
-  /* OK */
-  return NULL;
+  return modem_address_parse (address, NULL);
 }
 
 gboolean
@@ -1287,8 +1303,9 @@ modem_call_split_address (char const *address,
                           char **return_dialstring,
                           ModemClirOverride *return_clir)
 {
-  char const *emergency;
-  size_t nan;
+  char const *emergency, *number;
+  ModemAddressParts parts[1];
+  gsize n;
 
   g_return_if_fail (address != NULL);
   g_return_if_fail (return_address != NULL);
@@ -1304,23 +1321,23 @@ modem_call_split_address (char const *address,
       return;
     }
 
-  if (g_str_has_prefix (address, "*31#"))
-    {
-      address += strlen ("*31#");
-      /* According to 3GPP 22.030, *31# suppresses CLIR */
-      *return_clir = MODEM_CLIR_OVERRIDE_DISABLED;
-    }
+  modem_address_parse (address, parts);
 
-  if (g_str_has_prefix (address, "#31#"))
-    {
-      /* According to 3GPP 22.030, #31# invokes CLIR */
-      address += strlen ("#31#");
-      *return_clir = MODEM_CLIR_OVERRIDE_ENABLED;
-    }
+  /* According to 3GPP 22.030, *31# suppresses and #31# invokes CLIR */
+  if (parts->clir == '*')
+    *return_clir = MODEM_CLIR_OVERRIDE_DISABLED;
+  else if (parts->clir == '#')
+    *return_clir = MODEM_CLIR_OVERRIDE_ENABLED;
 
-  nan = strspn (address, "+0123456789*#ABCabc");
+  /* Keep also '+' and A-C that a valid address would not have */
+  number = parts->number;
+  for (n = parts->number_len;
+       MODEM_CHAR_IS (number[n], MODEM_CHAR_ADDRESS | MODEM_CHAR_PLUS) ||
+         (number[n] >= 'A' && number[n] <= 'C');
+       n++)
+    ;
 
-  *return_address = g_strndup (address, nan);
-  if (address[nan])
-    *return_dialstring = g_strdup (address + nan);
+  *return_address = g_strndup (number, n);
+  if (number[n])
+    *return_dialstring = g_strdup (number + n);
 }
@@ -28,6 +28,8 @@
 #include "modem/errors.h"
 
 #include "modem/call.h"
+#include "modem/call-events.h"
+#include "modem/chars.h"
 #include "modem/ofono.h"
 #include "modem/request-private.h"
 
@@ -850,6 +852,11 @@ modem_call_request_release (ModemCall *self,
   DEBUG ("%s.%s (%s)", MODEM_OFACE_CALL, "Hangup", modem_call_get_path (self));
   RETURN_NULL_IF_NOT_VALID (self);
 
+  if (self->priv->service)
+    modem_call_events_log_release (
+        modem_call_service_get_events (self->priv->service),
+        modem_call_get_path (self), g_get_monotonic_time ());
+
   return modem_request (MODEM_CALL (self),
       modem_oface_dbus_proxy (MODEM_OFACE (self)),
       "Hangup", reply_to_instance_request,
@@ -990,33 +997,11 @@ modem_call_send_dtmf (ModemCall *self, char const *dialstring,
       if (i == 255)
         return NULL; /* Too long */
 
-      switch (dialstring[i])
-        {
-        case '0':
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-        case '6':
-        case '7':
-        case '8':
-        case '9':
-        case '#':
-        case '*':
-          modemstring[i] = dialstring[i];
-        break;
-
-        case 'p': case 'P': modemstring[i] = 'p'; break;
-        case 'w': case 'W': modemstring[i] = 'w'; break;
-        case 'a': case 'A': modemstring[i] = 'a'; break;
-        case 'b': case 'B': modemstring[i] = 'b'; break;
-        case 'c': case 'C': modemstring[i] = 'c'; break;
-        case 'd': case 'D': modemstring[i] = 'd'; break;
+      if (!MODEM_CHAR_IS (dialstring[i],
+              MODEM_CHAR_TONE | MODEM_CHAR_PAUSE | MODEM_CHAR_WAIT))
+        return NULL;
 
-        default:
-          return NULL;
-        }
+      modemstring[i] = g_ascii_tolower (dialstring[i]);
     }
 
   modemstring[i] = '\0';
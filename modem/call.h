@@ -149,6 +149,11 @@ GError *modem_call_new_error (guint causetype, guint cause,
 
 void modem_call_service_resume (ModemCallService *);
 
+gint64 modem_call_service_time_call_added (ModemCallService const *self);
+
+struct _ModemCallEvents;
+struct _ModemCallEvents *modem_call_service_get_events (ModemCallService *);
+
 /* Validate addresses */
 gboolean modem_call_is_valid_address (char const *address);
 gboolean modem_call_validate_address (char const *address, GError **error);
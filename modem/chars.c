@@ -0,0 +1,133 @@
+/*
+ * modem/chars.c - Character classes for phone numbers and dial strings
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Addresses are checked on every dial and caller IDs normalized on
+ * every incoming call, so the character classes are looked up from a
+ * table instead of going through switch statements or strspn() with
+ * a different set of characters each time.
+ */
+
+#include "config.h"
+
+#include "modem/chars.h"
+
+#define DIGIT (MODEM_CHAR_DIGIT | MODEM_CHAR_TONE)
+#define SERVICE (MODEM_CHAR_SERVICE | MODEM_CHAR_TONE)
+
+guint8 const modem_char_class[256] = {
+  ['0'] = DIGIT, ['1'] = DIGIT, ['2'] = DIGIT, ['3'] = DIGIT,
+  ['4'] = DIGIT, ['5'] = DIGIT, ['6'] = DIGIT, ['7'] = DIGIT,
+  ['8'] = DIGIT, ['9'] = DIGIT,
+
+  ['*'] = SERVICE, ['#'] = SERVICE,
+
+  ['a'] = MODEM_CHAR_BCD | MODEM_CHAR_TONE,
+  ['b'] = MODEM_CHAR_BCD | MODEM_CHAR_TONE,
+  ['c'] = MODEM_CHAR_BCD | MODEM_CHAR_TONE,
+  ['d'] = MODEM_CHAR_TONE,
+  ['A'] = MODEM_CHAR_TONE, ['B'] = MODEM_CHAR_TONE,
+  ['C'] = MODEM_CHAR_TONE, ['D'] = MODEM_CHAR_TONE,
+
+  ['p'] = MODEM_CHAR_PAUSE, ['P'] = MODEM_CHAR_PAUSE,
+  ['w'] = MODEM_CHAR_WAIT, ['W'] = MODEM_CHAR_WAIT,
+
+  ['+'] = MODEM_CHAR_PLUS,
+
+  [' '] = MODEM_CHAR_FILLER, ['.'] = MODEM_CHAR_FILLER,
+  ['('] = MODEM_CHAR_FILLER, [')'] = MODEM_CHAR_FILLER,
+  ['-'] = MODEM_CHAR_FILLER,
+};
+
+#undef DIGIT
+#undef SERVICE
+
+/** Split @a address into CLIR prefix, number and dial string.
+ *
+ * The address may start with *31# or #31# (3GPP TS 22.030), followed
+ * by a number of at most 20 digits with an optional '+', and then a
+ * dial string starting with a pause or wait. The address is scanned
+ * only once.
+ *
+ * The parts are returned in @a return_parts, if it is not NULL, even
+ * if the address is not valid.
+ *
+ * @return NULL if the address is valid, or a message telling what is
+ * wrong with it.
+ */
+char const *
+modem_address_parse (char const *address,
+                     ModemAddressParts *return_parts)
+{
+  ModemAddressParts parts[1] = {{ 0 }};
+  char const *s, *digits, *message = NULL;
+  gsize n, m;
+
+  if (address == NULL)
+    {
+      if (return_parts)
+        *return_parts = *parts;
+      return "no destination";
+    }
+
+  s = address;
+
+  if ((s[0] == '*' || s[0] == '#') && s[1] == '3' && s[2] == '1' &&
+      s[3] == '#')
+    {
+      parts->clir = s[0];
+      s += 4;
+    }
+
+  parts->number = s;
+
+  if (*s == '+')
+    s++;
+
+  for (digits = s; MODEM_CHAR_IS (*s, MODEM_CHAR_ADDRESS); s++)
+    ;
+
+  n = s - digits;
+  parts->number_len = s - parts->number;
+
+  if (*s)
+    parts->dialstring = s;
+
+  for (; MODEM_CHAR_IS (*s, MODEM_CHAR_DIAL); s++)
+    ;
+
+  m = parts->dialstring ? s - parts->dialstring : 0;
+
+  if (n == 0)
+    message = parts->dialstring ? "not a phone number" : "too short";
+  else if (n > 20)
+    message = "too long";
+  else if (digits[n - 1] == '#')
+    message = "invalid service code";
+  else if (*s != '\0')
+    message = m == 0 ? "invalid address" : "invalid dial string";
+  else if (m == 1)
+    message = "invalid dial string";
+
+  if (return_parts)
+    *return_parts = *parts;
+
+  return message;
+}
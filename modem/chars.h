@@ -0,0 +1,65 @@
+/*
+ * modem/chars.h - Character classes for phone numbers and dial strings
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _MODEM_CHARS_H_
+#define _MODEM_CHARS_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+enum {
+  MODEM_CHAR_DIGIT = 1 << 0,    /* 0-9 */
+  MODEM_CHAR_SERVICE = 1 << 1,  /* * # */
+  MODEM_CHAR_BCD = 1 << 2,      /* a b c, extra digits in called party BCD */
+  MODEM_CHAR_TONE = 1 << 3,     /* 0-9 * # A-D a-d */
+  MODEM_CHAR_PAUSE = 1 << 4,    /* p P */
+  MODEM_CHAR_WAIT = 1 << 5,     /* w W */
+  MODEM_CHAR_PLUS = 1 << 6,     /* + */
+  MODEM_CHAR_FILLER = 1 << 7,   /* space . ( ) -, ignored in numbers */
+};
+
+/* Characters in the number part of an address */
+#define MODEM_CHAR_ADDRESS \
+  (MODEM_CHAR_DIGIT | MODEM_CHAR_SERVICE | MODEM_CHAR_BCD)
+/* Characters in the dial string following the number */
+#define MODEM_CHAR_DIAL \
+  (MODEM_CHAR_ADDRESS | MODEM_CHAR_PAUSE | MODEM_CHAR_WAIT)
+
+extern guint8 const modem_char_class[256];
+
+#define MODEM_CHAR_IS(c, classes) \
+  ((modem_char_class[(guchar)(c)] & (classes)) != 0)
+
+/* An address split into its parts. The pointers refer to the parsed
+ * string. */
+typedef struct {
+  char clir;                    /* '*' for *31#, '#' for #31#, or 0 */
+  char const *number;           /* Number, with optional '+' */
+  gsize number_len;
+  char const *dialstring;       /* Rest of the address, NULL if none */
+} ModemAddressParts;
+
+char const *modem_address_parse (char const *address,
+    ModemAddressParts *return_parts);
+
+G_END_DECLS
+
+#endif /* #ifndef _MODEM_CHARS_H_*/
@@ -0,0 +1,365 @@
+/*
+ * modem/dtmf.c - Paced DTMF dial strings
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * A dial string is split into steps, each sent with one SendTones at
+ * a fixed offset from the start. oFono plays the tones with the
+ * duration the modem uses, so the requested duration and pause only
+ * set the interval between the tones; when they are given, each tone
+ * is a step of its own. Otherwise, up to MODEM_DTMF_CHUNK tones are
+ * sent at once. A pause ('p' or ',') starts a new step. A wait ('w')
+ * ends the plan; the tones after it wait for the user, and there is
+ * nothing in oFono to tell when to go on.
+ *
+ * The steps are sent when they are due, without waiting for the reply
+ * to the previous SendTones, but at most MODEM_DTMF_WINDOW of them
+ * are outstanding. The timer is always set from the start time, so a
+ * late wakeup does not delay the rest of the string.
+ */
+
+#include "config.h"
+
+#define MODEM_DEBUG_FLAG MODEM_LOG_CALL
+
+#include "debug.h"
+
+#include "modem/dtmf.h"
+#include "modem/chars.h"
+#include "modem/errors.h"
+#include "modem/request.h"
+
+#include <string.h>
+
+/* ---------------------------------------------------------------------- */
+/* Planning */
+
+/** Split @a dialstring into steps, up to the first wait.
+ *
+ * @a duration and @a pause are in milliseconds; zero selects the
+ * default. If @a return_rest is not NULL, it is set to the part of
+ * @a dialstring after the first wait, or NULL if there is no wait.
+ *
+ * @return array of ModemDTMFStep, or NULL if @a dialstring contains no
+ * tones before the first wait or has characters other than DTMF tones,
+ * pauses and waits.
+ */
+GArray *
+modem_dtmf_plan (char const *dialstring,
+                 guint duration,
+                 guint pause,
+                 char const **return_rest)
+{
+  GArray *steps;
+  ModemDTMFStep *step = NULL;
+  guint offset = 0, interval, chunk;
+  char const *s, *rest = NULL;
+
+  if (return_rest)
+    *return_rest = NULL;
+
+  g_return_val_if_fail (dialstring != NULL, NULL);
+
+  if (duration == 0 && pause == 0)
+    chunk = MODEM_DTMF_CHUNK;
+  else
+    chunk = 1;
+
+  interval = (duration ? duration : MODEM_DTMF_DURATION) +
+    (pause ? pause : MODEM_DTMF_GAP);
+
+  steps = g_array_new (FALSE, TRUE, sizeof (ModemDTMFStep));
+
+  for (s = dialstring; *s; s++)
+    {
+      if (MODEM_CHAR_IS (*s, MODEM_CHAR_TONE))
+        {
+          if (step == NULL || strlen (step->tones) == chunk)
+            {
+              g_array_set_size (steps, steps->len + 1);
+              step = &g_array_index (steps, ModemDTMFStep, steps->len - 1);
+              step->offset = offset;
+            }
+          step->tones[strlen (step->tones)] = *s;
+          offset += interval;
+        }
+      else if (MODEM_CHAR_IS (*s, MODEM_CHAR_PAUSE) || *s == ',')
+        {
+          step = NULL;
+          offset += MODEM_DTMF_PAUSE;
+        }
+      else if (MODEM_CHAR_IS (*s, MODEM_CHAR_WAIT))
+        {
+          rest = s + 1;
+          break;
+        }
+      else
+        {
+          g_array_free (steps, TRUE);
+          return NULL;
+        }
+    }
+
+  if (steps->len == 0)
+    {
+      g_array_free (steps, TRUE);
+      return NULL;
+    }
+
+  if (return_rest)
+    *return_rest = rest;
+
+  return steps;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Sending */
+
+struct _ModemDTMF
+{
+  ModemCall *call;
+  GArray *steps;
+  guint next;                   /* Next step to send */
+  gint64 started;               /* Monotonic time */
+  guint timer;
+  GQueue requests[1];           /* SendTones waiting for reply */
+  ModemDTMFNotify *notify;
+  gpointer user_data;
+};
+
+static void modem_dtmf_pump (ModemDTMF *self);
+
+ModemDTMF *
+modem_dtmf_new (ModemCall *call)
+{
+  ModemDTMF *self = g_slice_new0 (ModemDTMF);
+
+  self->call = g_object_ref (call);
+  g_queue_init (self->requests);
+
+  return self;
+}
+
+/* Stop without notifying */
+static void
+modem_dtmf_reset (ModemDTMF *self)
+{
+  ModemRequest *request;
+
+  if (self->timer)
+    g_source_remove (self->timer);
+  self->timer = 0;
+
+  while ((request = g_queue_pop_head (self->requests)))
+    modem_request_cancel (request);
+
+  if (self->steps)
+    g_array_free (self->steps, TRUE);
+  self->steps = NULL;
+  self->next = 0;
+}
+
+void
+modem_dtmf_free (ModemDTMF *self)
+{
+  if (self == NULL)
+    return;
+
+  modem_dtmf_reset (self);
+  g_object_unref (self->call);
+  g_slice_free (ModemDTMF, self);
+}
+
+static void
+modem_dtmf_done (ModemDTMF *self,
+                 GError const *error)
+{
+  ModemDTMFNotify *notify = self->notify;
+  gpointer user_data = self->user_data;
+
+  modem_dtmf_reset (self);
+
+  self->notify = NULL;
+  self->user_data = NULL;
+
+  if (notify)
+    notify (self, error, user_data);
+}
+
+static void
+modem_dtmf_reply (ModemCall *call,
+                  ModemRequest *request,
+                  GError *error,
+                  gpointer _self)
+{
+  ModemDTMF *self = _self;
+
+  g_queue_remove (self->requests, request);
+
+  if (error)
+    {
+      DEBUG ("SendTones failed: " GERROR_MSG_FMT, GERROR_MSG_CODE (error));
+      modem_call_stop_dtmf (self->call, NULL, NULL);
+      modem_dtmf_done (self, error);
+    }
+  else
+    {
+      modem_dtmf_pump (self);
+    }
+}
+
+static gboolean
+modem_dtmf_timeout (gpointer _self)
+{
+  ModemDTMF *self = _self;
+
+  self->timer = 0;
+  modem_dtmf_pump (self);
+
+  return FALSE;
+}
+
+static void
+modem_dtmf_pump (ModemDTMF *self)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  while (self->steps && self->next < self->steps->len)
+    {
+      ModemDTMFStep const *step;
+      ModemRequest *request;
+      gint64 due;
+
+      step = &g_array_index (self->steps, ModemDTMFStep, self->next);
+      due = self->started + (gint64) step->offset * 1000;
+
+      if (due > now)
+        {
+          if (self->timer == 0)
+            self->timer = g_timeout_add_full (G_PRIORITY_HIGH,
+                (guint) ((due - now + 999) / 1000),
+                modem_dtmf_timeout, self, NULL);
+          return;
+        }
+
+      /* Sent when a reply arrives */
+      if (self->requests->length >= MODEM_DTMF_WINDOW)
+        return;
+
+      DEBUG ("SendTones \"%s\" %" G_GINT64_FORMAT " ms late",
+          step->tones, (now - due) / 1000);
+
+      request = modem_call_send_dtmf (self->call, step->tones,
+          modem_dtmf_reply, self);
+
+      if (request == NULL)
+        {
+          GError *error = g_error_new_literal (MODEM_CALL_ERRORS,
+              MODEM_CALL_ERROR_GENERIC, "SendTones failed");
+          modem_dtmf_done (self, error);
+          g_error_free (error);
+          return;
+        }
+
+      g_queue_push_tail (self->requests, request);
+      self->next++;
+    }
+
+  if (self->steps && g_queue_is_empty (self->requests))
+    modem_dtmf_done (self, NULL);
+}
+
+/** Send a dial string.
+ *
+ * @a notify is called when the dial string, up to the first wait, has
+ * been sent or sending fails. It is not called if the dial string is canceled.
+ *
+ * @retval FALSE if already sending, @a dialstring is not valid, or the
+ * first SendTones could not be sent
+ */
+gboolean
+modem_dtmf_send (ModemDTMF *self,
+                 char const *dialstring,
+                 guint duration,
+                 guint pause,
+                 ModemDTMFNotify *notify,
+                 gpointer user_data)
+{
+  GArray *steps;
+  char const *rest;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (dialstring != NULL, FALSE);
+
+  if (self->steps)
+    return FALSE;
+
+  steps = modem_dtmf_plan (dialstring, duration, pause, &rest);
+  if (steps == NULL)
+    return FALSE;
+
+  DEBUG ("\"%s\" in %u steps", dialstring, steps->len);
+  if (rest)
+    DEBUG ("not sending \"%s\" after wait", rest);
+
+  self->steps = steps;
+  self->next = 0;
+  self->started = g_get_monotonic_time ();
+
+  modem_dtmf_pump (self);
+
+  /* The first SendTones failed */
+  if (self->steps == NULL)
+    return FALSE;
+
+  self->notify = notify;
+  self->user_data = user_data;
+
+  return TRUE;
+}
+
+/** Stop sending the dial string.
+ *
+ * The tones already sent to the modem are not stopped; use
+ * modem_call_stop_dtmf() for that.
+ *
+ * @retval TRUE if a dial string was being sent
+ */
+gboolean
+modem_dtmf_cancel (ModemDTMF *self)
+{
+  g_return_val_if_fail (self != NULL, FALSE);
+
+  if (self->steps == NULL)
+    return FALSE;
+
+  DEBUG ("canceled after %u of %u steps", self->next, self->steps->len);
+
+  modem_dtmf_reset (self);
+  self->notify = NULL;
+  self->user_data = NULL;
+
+  return TRUE;
+}
+
+gboolean
+modem_dtmf_is_sending (ModemDTMF const *self)
+{
+  return self != NULL && self->steps != NULL;
+}
@@ -0,0 +1,73 @@
+/*
+ * modem/dtmf.h - Paced DTMF dial strings
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _MODEM_DTMF_H_
+#define _MODEM_DTMF_H_
+
+#include <glib.h>
+
+#include <modem/call.h>
+
+G_BEGIN_DECLS
+
+/* Default timing in milliseconds */
+#define MODEM_DTMF_DURATION (250)
+#define MODEM_DTMF_GAP (100)
+/* Pause for 'p' or ',', 3GPP TS 02.07 B.3.4 */
+#define MODEM_DTMF_PAUSE (3000)
+
+/* Maximum number of tones in one SendTones */
+#define MODEM_DTMF_CHUNK (8)
+/* Maximum number of SendTones waiting for reply */
+#define MODEM_DTMF_WINDOW (2)
+
+typedef struct {
+  guint offset;                 /* Milliseconds from start */
+  char tones[MODEM_DTMF_CHUNK + 1];
+} ModemDTMFStep;
+
+GArray *modem_dtmf_plan (char const *dialstring,
+    guint duration,
+    guint pause,
+    char const **return_rest);
+
+typedef struct _ModemDTMF ModemDTMF;
+
+typedef void ModemDTMFNotify (ModemDTMF *dtmf,
+    GError const *error,
+    gpointer user_data);
+
+ModemDTMF *modem_dtmf_new (ModemCall *call);
+void modem_dtmf_free (ModemDTMF *self);
+
+gboolean modem_dtmf_send (ModemDTMF *self,
+    char const *dialstring,
+    guint duration,
+    guint pause,
+    ModemDTMFNotify *notify,
+    gpointer user_data);
+
+gboolean modem_dtmf_cancel (ModemDTMF *self);
+
+gboolean modem_dtmf_is_sending (ModemDTMF const *self);
+
+G_END_DECLS
+
+#endif /* #ifndef _MODEM_DTMF_H_*/
@@ -377,57 +377,89 @@ modem_sms_error_get_type (void)
 
 /* ---------------------------------------------------------------------- */
 
+/* The error mappings are kept in an immutable registry. A new registry
+ * is built and published with an atomic pointer swap when a mapping is
+ * added, so the lookups done on every failed reply take no lock. The
+ * mappings are registered a few times at startup, and the replaced
+ * registries are never freed as a reader may still be using one. */
+
 typedef struct _ModemErrorMapping ModemErrorMapping;
+typedef struct _ModemErrorRegistry ModemErrorRegistry;
+
+struct _ModemErrorMapping {
+  GQuark domain;
+  GType  type;
+  char const *prefix;
+  gsize prefixlen;
+};
+
+struct _ModemErrorRegistry {
+  guint n_maps;
+  ModemErrorMapping *maps;
+  /* Mappings indexed by domain quark */
+  guint n_quarks;
+  ModemErrorMapping const **by_quark;
+};
+
+static ModemErrorRegistry *modem_error_registry;
+static GStaticMutex modem_error_registry_mutex = G_STATIC_MUTEX_INIT;
+
+static ModemErrorRegistry *
+modem_error_registry_extend (ModemErrorRegistry const *old,
+                             GQuark domain,
+                             char const *prefix,
+                             GType type)
+{
+  ModemErrorRegistry *registry = g_new0 (ModemErrorRegistry, 1);
+  ModemErrorMapping *map;
+  guint i;
 
-struct {
-  GStaticRWLock lock;
-  struct _ModemErrorMapping {
-    ModemErrorMapping *next;
-    GQuark domain;
-    GType  type;
-    char const *prefix;
-    gsize prefixlen;
-  } *list;
-} modem_registered_errors =
-  {
-    G_STATIC_RW_LOCK_INIT,
-    NULL,
-  };
+  registry->n_maps = old ? old->n_maps + 1 : 1;
+  registry->maps = g_new0 (ModemErrorMapping, registry->n_maps);
 
-static ModemErrorMapping **
-modem_error_append_mapping (ModemErrorMapping **list,
-                            GQuark domain,
-                            char const *prefix,
-                            GType type)
-{
-  *list = g_new0 (ModemErrorMapping, 1);
+  if (old)
+    memcpy (registry->maps, old->maps, old->n_maps * sizeof *old->maps);
 
-  (*list)->domain = domain;
-  (*list)->type = type;
-  (*list)->prefix = prefix;
-  (*list)->prefixlen = strlen (prefix);
+  map = &registry->maps[registry->n_maps - 1];
+  map->domain = domain;
+  map->type = type;
+  map->prefix = prefix;
+  map->prefixlen = strlen (prefix);
+
+  for (i = 0; i < registry->n_maps; i++)
+    if (registry->maps[i].domain >= registry->n_quarks)
+      registry->n_quarks = registry->maps[i].domain + 1;
+
+  registry->by_quark = g_new0 (ModemErrorMapping const *, registry->n_quarks);
+
+  for (i = 0; i < registry->n_maps; i++)
+    registry->by_quark[registry->maps[i].domain] = &registry->maps[i];
 
   g_type_class_unref (g_type_class_ref (type));
 
   dbus_g_error_domain_register (domain, prefix, type);
 
-  return &(*list)->next;
+  return registry;
 }
 
-static ModemErrorMapping **
-modem_registered_errors_writer_lock (void)
+static ModemErrorRegistry const *
+modem_error_registry_get (void)
 {
-  ModemErrorMapping **list;
+  ModemErrorRegistry *registry;
+
+  registry = g_atomic_pointer_get (&modem_error_registry);
+  if (G_LIKELY (registry != NULL))
+    return registry;
 
-  g_static_rw_lock_writer_lock (&modem_registered_errors.lock);
+  g_static_mutex_lock (&modem_error_registry_mutex);
 
-  list = &modem_registered_errors.list;
+  registry = g_atomic_pointer_get (&modem_error_registry);
 
-  if (*list == NULL)
+  if (registry == NULL)
     {
-#define _(n) list = modem_error_append_mapping (list,   \
-          MODEM_## n ##_ERRORS,                         \
-          MODEM_## n ##_ERROR_PREFIX,                   \
+#define _(n) registry = modem_error_registry_extend (registry,  \
+          MODEM_## n ##_ERRORS,                                 \
+          MODEM_## n ##_ERROR_PREFIX,                           \
           MODEM_TYPE_## n ##_ERROR)
       _(OFONO);
       _(CALL);
@@ -435,35 +467,49 @@ modem_registered_errors_writer_lock (void)
       _(SMS);
       _(SMS_NET);
 #undef _
+      g_atomic_pointer_set (&modem_error_registry, registry);
     }
 
-  return &modem_registered_errors.list;
+  g_static_mutex_unlock (&modem_error_registry_mutex);
+
+  return registry;
 }
 
-static void
-modem_registered_errors_writer_unlock (void)
+static ModemErrorMapping const *
+modem_error_registry_find_domain (ModemErrorRegistry const *registry,
+                                  GQuark domain)
 {
-  g_static_rw_lock_writer_unlock (&modem_registered_errors.lock);
+  if (domain < registry->n_quarks)
+    return registry->by_quark[domain];
+  return NULL;
 }
 
+/* Find mapping for a fully qualified D-Bus error name.
+ *
+ * The error name is the prefix followed by a dot and a name without
+ * dots, so the prefix must match everything up to the last dot. */
 static ModemErrorMapping const *
-modem_registered_errors_reader_lock (void)
+modem_error_registry_find_prefix (ModemErrorRegistry const *registry,
+                                  char const *fqe)
 {
-  if (modem_registered_errors.list == NULL)
-    {
-      modem_registered_errors_writer_lock ();
-      modem_registered_errors_writer_unlock ();
-    }
+  char const *dot = strrchr (fqe, '.');
+  gsize len;
+  guint i;
 
-  g_static_rw_lock_reader_lock (&modem_registered_errors.lock);
+  if (dot == NULL)
+    return NULL;
 
-  return modem_registered_errors.list;
-}
+  len = dot - fqe;
 
-static void
-modem_registered_errors_reader_unlock (void)
-{
-  g_static_rw_lock_reader_unlock (&modem_registered_errors.lock);
+  for (i = 0; i < registry->n_maps; i++)
+    {
+      ModemErrorMapping const *map = &registry->maps[i];
+
+      if (map->prefixlen == len && memcmp (fqe, map->prefix, len) == 0)
+        return map;
+    }
+
+  return NULL;
 }
 
 void
@@ -471,20 +517,21 @@ modem_error_register_mapping (GQuark domain,
                               char const *prefix,
                               GType type)
 {
+  ModemErrorRegistry const *registry;
+
   DEBUG ("enter");
 
-  ModemErrorMapping **list =  modem_registered_errors_writer_lock ();
+  modem_error_registry_get ();
+
+  g_static_mutex_lock (&modem_error_registry_mutex);
 
-  for (; *list; list = &(*list)->next)
-    if ((*list)->domain == domain)
-      {
-        modem_registered_errors_writer_unlock ();
-        return;
-      }
+  registry = g_atomic_pointer_get (&modem_error_registry);
 
-  modem_error_append_mapping (list, domain, prefix, type);
+  if (!modem_error_registry_find_domain (registry, domain))
+    g_atomic_pointer_set (&modem_error_registry,
+        modem_error_registry_extend (registry, domain, prefix, type));
 
-  modem_registered_errors_writer_unlock ();
+  g_static_mutex_unlock (&modem_error_registry_mutex);
 }
 
 char const *
@@ -492,13 +539,8 @@ modem_error_domain_prefix (GQuark error_domain)
 {
   ModemErrorMapping const *map;
 
-  map = modem_registered_errors_reader_lock ();
-
-  for (; map; map = map->next)
-    if (map->domain == error_domain)
-      break;
-
-  modem_registered_errors_reader_unlock ();
+  map = modem_error_registry_find_domain (modem_error_registry_get (),
+      error_domain);
 
   if (map)
     return map->prefix;
@@ -516,18 +558,11 @@ modem_error_name (GError const *error, void *buffer, guint len)
     {
       ModemErrorMapping const *map;
 
-      map = modem_registered_errors_reader_lock ();
-
-      for (; map; map = map->next)
-        {
-          if (map->domain == error->domain)
-            {
-              type = map->type;
-              break;
-            }
-        }
+      map = modem_error_registry_find_domain (modem_error_registry_get (),
+          error->domain);
 
-      modem_registered_errors_reader_unlock ();
+      if (map)
+        type = map->type;
     }
 
   if (type)
@@ -695,15 +730,7 @@ modem_error_fix (GError **error)
 
   char const *fqe = (*error)->message + strlen ((*error)->message) + 1;
 
-  map = modem_registered_errors_reader_lock ();
-
-  for (; map; map = map->next)
-    if (strncmp (fqe, map->prefix, map->prefixlen) == 0 &&
-        fqe[map->prefixlen] == '.' &&
-        strchr (fqe + map->prefixlen + 1, '.') == 0)
-      break;
-
-  modem_registered_errors_reader_unlock ();
+  map = modem_error_registry_find_prefix (modem_error_registry_get (), fqe);
 
   if (!map)
     {
@@ -77,6 +77,7 @@ enum
   SIGNAL_INTERFACE_ADDED,
   SIGNAL_INTERFACE_REMOVED,
   SIGNAL_IMSI_ADDED,
+  SIGNAL_READY,
   N_SIGNALS
 };
 
@@ -99,15 +100,21 @@ struct _ModemPrivate
   GHashTable *ifhash;
   GHashTable *connecting;
   GHashTable *ofaces;
+
+  /* Startup barrier */
+  gint64 started;
+  guint64 startup_time;
+  unsigned ready:1, updating:1;
 };
 
 /* ------------------------------------------------------------------------ */
 /* Local functions */
 
-static void on_notify_interfaces (Modem *, GParamSpec *, Modem *);
+static void on_properties_updated (Modem *, char const * const *, Modem *);
 static void modem_update_interfaces (Modem *);
 static void on_sim_notify_imsi (ModemSIMService *, GParamSpec *, Modem *);
 static void on_oface_connected  (ModemOface *, gboolean, Modem *);
+static void modem_check_ready (Modem *);
 
 /* ------------------------------------------------------------------------ */
 
@@ -310,10 +317,12 @@ modem_connect (ModemOface *_self)
 {
   DEBUG ("(%p): enter", _self);
 
+  MODEM_MODEM (_self)->priv->started = g_get_monotonic_time ();
+
   modem_oface_connect_properties (_self, FALSE);
 
-  g_signal_connect (_self, "notify::interfaces",
-      G_CALLBACK(on_notify_interfaces), _self);
+  g_signal_connect (_self, "properties-updated",
+      G_CALLBACK(on_properties_updated), _self);
 
   modem_update_interfaces ( MODEM_MODEM(_self) );
 }
@@ -330,7 +339,7 @@ modem_disconnect (ModemOface *_self)
   ModemOface *oface;
 
   g_signal_handlers_disconnect_by_func (_self,
-      G_CALLBACK(on_notify_interfaces), _self);
+      G_CALLBACK(on_properties_updated), _self);
 
   for (g_hash_table_iter_init (iter, priv->connecting);
        g_hash_table_iter_next (iter, (gpointer)&interface, (gpointer)&oface);)
@@ -396,6 +405,16 @@ modem_class_init (ModemClass *klass)
       g_cclosure_marshal_VOID__STRING,
       G_TYPE_NONE, 1, G_TYPE_STRING);
 
+  /* Emitted once, when all the interfaces present at startup have either
+   * been connected or failed to connect */
+  signals[SIGNAL_READY] = g_signal_new ("ready",
+      G_OBJECT_CLASS_TYPE (klass),
+      G_SIGNAL_RUN_LAST,
+      0,
+      NULL, NULL,
+      g_cclosure_marshal_VOID__VOID,
+      G_TYPE_NONE, 0);
+
   g_object_class_install_property (object_class, PROP_POWERED,
       g_param_spec_boolean ("powered",
           "Powered",
@@ -529,6 +548,8 @@ on_oface_connected (ModemOface *oface,
 
       g_free (interface);
 
+      modem_check_ready (self);
+
       return;
     }
 
@@ -545,6 +566,32 @@ on_oface_connected (ModemOface *oface,
           G_CALLBACK(on_sim_notify_imsi), self);
       on_sim_notify_imsi (MODEM_SIM_SERVICE (oface), NULL, self);
     }
+
+  modem_check_ready (self);
+}
+
+/* All interfaces get connected in parallel, their GetProperties (and
+ * GetCalls, GetMessages) requests are all sent before the first reply
+ * arrives. The modem becomes ready when the last reply has been received. */
+static void
+modem_check_ready (Modem *self)
+{
+  ModemPrivate *priv = self->priv;
+
+  if (priv->ready || priv->updating ||
+      g_hash_table_size (priv->connecting) != 0)
+    return;
+
+  priv->ready = TRUE;
+  priv->startup_time = g_get_monotonic_time () - priv->started;
+
+  modem_message (MODEM_LOG_MODEM, "%s: %u interfaces connected in %"
+      G_GUINT64_FORMAT " ms",
+      modem_oface_object_path (MODEM_OFACE (self)),
+      g_hash_table_size (priv->ofaces),
+      priv->startup_time / 1000);
+
+  g_signal_emit (self, signals[SIGNAL_READY], 0);
 }
 
 static void
@@ -572,6 +619,8 @@ modem_update_interfaces (Modem *self)
 
   object_path = modem_oface_object_path (MODEM_OFACE (self));
 
+  priv->updating = TRUE;
+
   for (i = 0; priv->interfaces[i]; i++)
     {
       interface = priv->interfaces[i];
@@ -589,6 +638,8 @@ modem_update_interfaces (Modem *self)
 
       DEBUG("Modem %s adding interface %s", object_path, interface);
 
+      modem_request_set_timeout (oface, modem_request_get_timeout (self));
+
       already = g_hash_table_lookup (priv->connecting, interface);
       if (already)
         {
@@ -605,6 +656,8 @@ modem_update_interfaces (Modem *self)
       modem_oface_connect (oface);
     }
 
+  priv->updating = FALSE;
+
   g_hash_table_unref (prev_ifhash);
 
   DEBUG("All modem %s interfaces added", object_path);
@@ -632,14 +685,17 @@ modem_update_interfaces (Modem *self)
           goto redo_ofaces;
         }
     }
+
+  modem_check_ready (self);
 }
 
 static void
-on_notify_interfaces (Modem *self,
-                      GParamSpec *dummy1,
-                      Modem *dummy2)
+on_properties_updated (Modem *self,
+                       char const * const *names,
+                       Modem *dummy)
 {
-  modem_update_interfaces (self);
+  if (tp_strv_contains (names, "interfaces"))
+    modem_update_interfaces (self);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -729,6 +785,25 @@ modem_supports_sms (Modem const *self)
   return modem_get_interface (self, MODEM_OFACE_SMS) != NULL;
 }
 
+/** Return TRUE if the initial set of interfaces has been connected. */
+gboolean
+modem_is_ready (Modem const *self)
+{
+  g_return_val_if_fail (MODEM_IS_MODEM (self), FALSE);
+
+  return self->priv->ready;
+}
+
+/** Return time in microseconds it took to connect the initial interfaces,
+ * or 0 if the modem is not ready yet. */
+guint64
+modem_get_startup_time (Modem const *self)
+{
+  g_return_val_if_fail (MODEM_IS_MODEM (self), 0);
+
+  return self->priv->startup_time;
+}
+
 gboolean
 modem_has_imsi (Modem const *self, gchar const *imsi)
 {
@@ -752,6 +827,35 @@ modem_has_imsi (Modem const *self, gchar const *imsi)
   return match;
 }
 
+/** Set reply timeout for requests made via modem and its interfaces.
+ *
+ * Zero restores the default D-Bus timeout.
+ */
+void
+modem_set_request_timeout (Modem *self, guint timeout)
+{
+  ModemPrivate *priv;
+  GHashTableIter iter[1];
+  char *interface;
+  ModemOface *oface;
+
+  g_return_if_fail (MODEM_IS_MODEM (self));
+
+  priv = self->priv;
+
+  DEBUG ("%s timeout %u ms", modem_get_modem_path (self), timeout);
+
+  modem_request_set_timeout (self, timeout);
+
+  for (g_hash_table_iter_init (iter, priv->connecting);
+       g_hash_table_iter_next (iter, (gpointer)&interface, (gpointer)&oface);)
+    modem_request_set_timeout (oface, timeout);
+
+  for (g_hash_table_iter_init (iter, priv->ofaces);
+       g_hash_table_iter_next (iter, (gpointer)&interface, (gpointer)&oface);)
+    modem_request_set_timeout (oface, timeout);
+}
+
 gboolean
 modem_has_imei (Modem const *self, gchar const *imei)
 {
@@ -73,10 +73,15 @@ gboolean modem_supports_sim (Modem const *self);
 gboolean modem_supports_call (Modem const *self);
 gboolean modem_supports_sms (Modem const *self);
 
+gboolean modem_is_ready (Modem const *self);
+guint64 modem_get_startup_time (Modem const *self);
+
 gboolean modem_has_imsi (Modem const *self, gchar const *imsi);
 
 gboolean modem_has_imei (Modem const *self, gchar const *imei);
 
+void modem_set_request_timeout (Modem *self, guint timeout);
+
 G_END_DECLS
 
 #endif /* #ifndef _MODEM_MODEM_H_*/
@@ -33,6 +33,7 @@
 #include "modem/ofono.h"
 
 #include <dbus/dbus-glib.h>
+#include <dbus/dbus-glib-lowlevel.h>
 
 #include "signals-marshal.h"
 
@@ -61,6 +62,7 @@ enum
 enum
 {
   SIGNAL_CONNECTED,
+  SIGNAL_PROPERTIES_UPDATED,
   N_SIGNALS
 };
 
@@ -77,6 +79,9 @@ struct _ModemOfacePrivate
     GError *error;
   } connecting;
 
+  /* Names of properties changed by ongoing modem_oface_update_properties */
+  GPtrArray *updated;
+
   unsigned dispose_has_run:1, connected:1, signals:1, disconnected:1, :0;
 };
 
@@ -84,8 +89,8 @@ struct _ModemOfacePrivate
 /* Local functions */
 
 static void modem_oface_set_object_path (ModemOface *self, char const *path);
-static void on_property_changed (DBusGProxy *,
-    char const *, GValue const *, gpointer);
+static void modem_oface_subscribe (ModemOface *self);
+static void modem_oface_unsubscribe (ModemOface *self);
 
 /* ------------------------------------------------------------------------ */
 
@@ -170,6 +175,8 @@ modem_oface_dispose (GObject *object)
   if (!priv->disconnected)
     modem_oface_disconnect (self);
 
+  modem_oface_disconnect_properties (self);
+
   g_clear_error (&priv->connecting.error);
 
   g_object_run_dispose (G_OBJECT (priv->proxy));
@@ -232,6 +239,17 @@ modem_oface_class_init (ModemOfaceClass *klass)
         NULL, NULL,
         g_cclosure_marshal_VOID__BOOLEAN,
         G_TYPE_NONE, 1, G_TYPE_BOOLEAN);
+
+  /* Emitted once after a PropertyChanged signal or a GetProperties reply
+   * has been applied, with the NULL-terminated list of changed GObject
+   * property names */
+  signals[SIGNAL_PROPERTIES_UPDATED] =
+    g_signal_new ("properties-updated", G_OBJECT_CLASS_TYPE (klass),
+        G_SIGNAL_RUN_LAST,
+        0,
+        NULL, NULL,
+        g_cclosure_marshal_VOID__BOXED,
+        G_TYPE_NONE, 1, G_TYPE_STRV);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -499,10 +517,7 @@ modem_oface_connect_properties (ModemOface *self,
   if (!priv->signals)
     {
       priv->signals = TRUE;
-      dbus_g_proxy_add_signal (priv->proxy, "PropertyChanged",
-          G_TYPE_STRING, G_TYPE_VALUE, G_TYPE_INVALID);
-      dbus_g_proxy_connect_signal (priv->proxy, "PropertyChanged",
-	  G_CALLBACK (on_property_changed), self, NULL);
+      modem_oface_subscribe (self);
     }
 
   if (!get_all)
@@ -521,9 +536,7 @@ modem_oface_disconnect_properties (ModemOface *self)
   if (priv->signals)
     {
       priv->signals = FALSE;
-
-      dbus_g_proxy_disconnect_signal (priv->proxy, "PropertyChanged",
-          G_CALLBACK (on_property_changed), self);
+      modem_oface_unsubscribe (self);
     }
 }
 
@@ -584,50 +597,756 @@ modem_oface_request_properties (ModemOface *self,
       G_TYPE_INVALID);
 }
 
-static void
-on_property_changed (DBusGProxy *proxy,
-                     char const *property,
-                     GValue const *value,
-                     gpointer _self)
+/* ------------------------------------------------------------------------- */
+/* Property dispatch table */
+
+#define MODEM_OFACE_PROPERTY_TABLE_QUARK modem_oface_property_table_quark ()
+static GQuark
+modem_oface_property_table_quark (void)
+{
+  static GQuark quark;
+  if (G_UNLIKELY (!quark))
+    quark = g_quark_from_static_string ("ModemOfacePropertyTable");
+  return quark;
+}
+
+/** Maps an oFono property name to a GParamSpec of the @a klass.
+ *
+ * The class property_mapper is consulted only once per property name;
+ * the result (including a miss) is stored in a per-class table keyed by
+ * the interned oFono property name.
+ *
+ * Returns NULL if the property is not mapped.
+ */
+GParamSpec *
+modem_oface_class_find_property (ModemOfaceClass *klass,
+                                 char const *ofono_property)
 {
-  ModemOface *self = MODEM_OFACE (_self);
-  char const *(*property_mapper)(char const *ofono_property);
+  GType type = G_OBJECT_CLASS_TYPE (klass);
+  GHashTable *table;
+  gpointer key, pspec;
   char const *gname;
 
-  property_mapper = MODEM_OFACE_GET_CLASS (self)->property_mapper;
-  if (!property_mapper)
+  table = g_type_get_qdata (type, MODEM_OFACE_PROPERTY_TABLE_QUARK);
+  if (G_UNLIKELY (table == NULL))
+    {
+      table = g_hash_table_new (g_str_hash, g_str_equal);
+      g_type_set_qdata (type, MODEM_OFACE_PROPERTY_TABLE_QUARK, table);
+    }
+
+  if (g_hash_table_lookup_extended (table, ofono_property, &key, &pspec))
+    return pspec;
+
+  pspec = NULL;
+
+  gname = klass->property_mapper ? klass->property_mapper (ofono_property)
+    : NULL;
+
+  if (gname)
+    {
+      pspec = g_object_class_find_property (G_OBJECT_CLASS (klass), gname);
+
+      if (pspec == NULL ||
+          (((GParamSpec *)pspec)->flags & G_PARAM_WRITABLE) == 0 ||
+          (((GParamSpec *)pspec)->flags & G_PARAM_CONSTRUCT_ONLY) != 0)
+        {
+          g_warning ("%s: cannot map %s to property %s",
+              G_OBJECT_CLASS_NAME (klass), ofono_property, gname);
+          pspec = NULL;
+        }
+    }
+
+  g_hash_table_insert (table, (gpointer) g_intern_string (ofono_property),
+      pspec);
+
+  return pspec;
+}
+
+static void
+modem_oface_set_mapped_property (ModemOface *self,
+                                 GParamSpec *pspec,
+                                 GValue const *value)
+{
+  /* GObject transforms and validates the value as needed */
+  g_object_set_property (G_OBJECT (self), pspec->name, value);
+}
+
+/* Record a property applied within an update batch, or emit at once */
+static void
+modem_oface_property_updated (ModemOface *self,
+                              GParamSpec *pspec)
+{
+  if (self->priv->updated)
+    {
+      GPtrArray *updated = self->priv->updated;
+      guint i;
+
+      for (i = 0; i < updated->len; i++)
+        if (g_ptr_array_index (updated, i) == pspec->name)
+          return;
+
+      g_ptr_array_add (updated, (gpointer) pspec->name);
+    }
+  else
+    {
+      char const *names[2] = { pspec->name, NULL };
+
+      g_signal_emit (self, signals[SIGNAL_PROPERTIES_UPDATED], 0, names);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* PropertyChanged signal */
+
+/* PropertyChanged signals are read directly from the D-Bus message by a
+ * connection filter instead of going through a DBusGProxy. The variant
+ * is decoded straight into a GValue of the target property type, and the
+ * signal is not decoded at all if the property is not mapped. Decoding
+ * does not copy strings; the value refers to the message until it has
+ * been set, and setting the property copies what the object keeps.
+ *
+ * The filter adds no PropertyChanged match rules of its own. Each object
+ * has a DBusGProxy for its method calls, and dbus-glib adds a match rule
+ * for all signals from the proxy's path and interface; "make bench"
+ * shows the count. The receiving object is found from a table indexed
+ * by interface and object path.
+ *
+ * Signals are accepted only from the current owner of the oFono bus
+ * name. It is asked for without blocking when the first object
+ * subscribes and then followed with NameOwnerChanged. */
+
+static GHashTable *modem_oface_signal_table;
+static char *modem_oface_ofono_owner;
+
+/* Decode a variant into a GValue of the @pspec type.
+ *
+ * Strings are not copied, the value is valid only as long as the message.
+ * The string vector (if any) is returned in @return_strv and must be
+ * freed with g_free().
+ */
+static gboolean
+modem_oface_demarshal (DBusMessageIter *variant,
+                       GParamSpec *pspec,
+                       GValue *value,
+                       gpointer *return_strv)
+{
+  GType type = G_PARAM_SPEC_VALUE_TYPE (pspec);
+  int dtype = dbus_message_iter_get_arg_type (variant);
+
+  if (type == G_TYPE_BOOLEAN && dtype == DBUS_TYPE_BOOLEAN)
+    {
+      dbus_bool_t b;
+
+      dbus_message_iter_get_basic (variant, &b);
+      g_value_init (value, type);
+      g_value_set_boolean (value, b != FALSE);
+      return TRUE;
+    }
+
+  if (type == G_TYPE_STRING && (dtype == DBUS_TYPE_STRING ||
+          dtype == DBUS_TYPE_OBJECT_PATH || dtype == DBUS_TYPE_SIGNATURE))
+    {
+      char const *str;
+
+      dbus_message_iter_get_basic (variant, &str);
+      g_value_init (value, type);
+      g_value_set_static_string (value, str);
+      return TRUE;
+    }
+
+  if (type == G_TYPE_UINT || type == G_TYPE_INT)
+    {
+      union {
+        unsigned char y;
+        dbus_int16_t n;
+        dbus_uint16_t q;
+        dbus_int32_t i;
+        dbus_uint32_t u;
+      } basic;
+      gint64 n;
+
+      switch (dtype)
+        {
+        case DBUS_TYPE_BYTE:
+          dbus_message_iter_get_basic (variant, &basic);
+          n = basic.y;
+          break;
+        case DBUS_TYPE_INT16:
+          dbus_message_iter_get_basic (variant, &basic);
+          n = basic.n;
+          break;
+        case DBUS_TYPE_UINT16:
+          dbus_message_iter_get_basic (variant, &basic);
+          n = basic.q;
+          break;
+        case DBUS_TYPE_INT32:
+          dbus_message_iter_get_basic (variant, &basic);
+          n = basic.i;
+          break;
+        case DBUS_TYPE_UINT32:
+          dbus_message_iter_get_basic (variant, &basic);
+          n = basic.u;
+          break;
+        default:
+          return FALSE;
+        }
+
+      g_value_init (value, type);
+      if (type == G_TYPE_UINT)
+        g_value_set_uint (value, (guint) n);
+      else
+        g_value_set_int (value, (gint) n);
+      return TRUE;
+    }
+
+  if (type == G_TYPE_STRV && dtype == DBUS_TYPE_ARRAY &&
+      (dbus_message_iter_get_element_type (variant) == DBUS_TYPE_STRING ||
+          dbus_message_iter_get_element_type (variant) ==
+          DBUS_TYPE_OBJECT_PATH))
+    {
+      DBusMessageIter array[1];
+      char const **strv;
+      guint n = 0;
+
+      dbus_message_iter_recurse (variant, array);
+      while (dbus_message_iter_get_arg_type (array) != DBUS_TYPE_INVALID)
+        n++, dbus_message_iter_next (array);
+
+      *return_strv = strv = g_new (char const *, n + 1);
+
+      dbus_message_iter_recurse (variant, array);
+      for (n = 0;
+           dbus_message_iter_get_arg_type (array) != DBUS_TYPE_INVALID;
+           dbus_message_iter_next (array))
+        dbus_message_iter_get_basic (array, &strv[n++]);
+      strv[n] = NULL;
+
+      g_value_init (value, type);
+      g_value_set_static_boxed (value, strv);
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+modem_oface_value_free (gpointer value)
+{
+  g_value_unset (value);
+  g_slice_free (GValue, value);
+}
+
+/* Decode a variant into a GValue of the type dbus-glib would use.
+ *
+ * This is used for properties of types modem_oface_demarshal() does not
+ * know about; the value is then transformed to the property type. The
+ * value is a copy and does not refer to the message.
+ */
+static gboolean
+modem_oface_demarshal_generic (DBusMessageIter *iter,
+                               GValue *value)
+{
+  union {
+    unsigned char y;
+    dbus_bool_t b;
+    dbus_int16_t n;
+    dbus_uint16_t q;
+    dbus_int32_t i;
+    dbus_uint32_t u;
+    dbus_int64_t x;
+    dbus_uint64_t t;
+    double d;
+    char const *s;
+  } basic;
+  DBusMessageIter array[1];
+  int dtype = dbus_message_iter_get_arg_type (iter);
+
+  switch (dtype)
+    {
+    case DBUS_TYPE_BYTE:
+      dbus_message_iter_get_basic (iter, &basic);
+      g_value_init (value, G_TYPE_UCHAR);
+      g_value_set_uchar (value, basic.y);
+      return TRUE;
+
+    case DBUS_TYPE_BOOLEAN:
+      dbus_message_iter_get_basic (iter, &basic);
+      g_value_init (value, G_TYPE_BOOLEAN);
+      g_value_set_boolean (value, basic.b != FALSE);
+      return TRUE;
+
+    case DBUS_TYPE_INT16:
+      dbus_message_iter_get_basic (iter, &basic);
+      g_value_init (value, G_TYPE_INT);
+      g_value_set_int (value, basic.n);
+      return TRUE;
+
+    case DBUS_TYPE_UINT16:
+      dbus_message_iter_get_basic (iter, &basic);
+      g_value_init (value, G_TYPE_UINT);
+      g_value_set_uint (value, basic.q);
+      return TRUE;
+
+    case DBUS_TYPE_INT32:
+      dbus_message_iter_get_basic (iter, &basic);
+      g_value_init (value, G_TYPE_INT);
+      g_value_set_int (value, basic.i);
+      return TRUE;
+
+    case DBUS_TYPE_UINT32:
+      dbus_message_iter_get_basic (iter, &basic);
+      g_value_init (value, G_TYPE_UINT);
+      g_value_set_uint (value, basic.u);
+      return TRUE;
+
+    case DBUS_TYPE_INT64:
+      dbus_message_iter_get_basic (iter, &basic);
+      g_value_init (value, G_TYPE_INT64);
+      g_value_set_int64 (value, basic.x);
+      return TRUE;
+
+    case DBUS_TYPE_UINT64:
+      dbus_message_iter_get_basic (iter, &basic);
+      g_value_init (value, G_TYPE_UINT64);
+      g_value_set_uint64 (value, basic.t);
+      return TRUE;
+
+    case DBUS_TYPE_DOUBLE:
+      dbus_message_iter_get_basic (iter, &basic);
+      g_value_init (value, G_TYPE_DOUBLE);
+      g_value_set_double (value, basic.d);
+      return TRUE;
+
+    case DBUS_TYPE_STRING:
+      dbus_message_iter_get_basic (iter, &basic);
+      g_value_init (value, G_TYPE_STRING);
+      g_value_set_string (value, basic.s);
+      return TRUE;
+
+    case DBUS_TYPE_OBJECT_PATH:
+      dbus_message_iter_get_basic (iter, &basic);
+      g_value_init (value, DBUS_TYPE_G_OBJECT_PATH);
+      g_value_set_boxed (value, basic.s);
+      return TRUE;
+
+    case DBUS_TYPE_VARIANT:
+      dbus_message_iter_recurse (iter, array);
+      return modem_oface_demarshal_generic (array, value);
+
+    case DBUS_TYPE_ARRAY:
+      break;
+
+    default:
+      return FALSE;
+    }
+
+  switch (dbus_message_iter_get_element_type (iter))
+    {
+    case DBUS_TYPE_STRING:
+      {
+        GPtrArray *strv = g_ptr_array_new ();
+
+        for (dbus_message_iter_recurse (iter, array);
+             dbus_message_iter_get_arg_type (array) != DBUS_TYPE_INVALID;
+             dbus_message_iter_next (array))
+          {
+            dbus_message_iter_get_basic (array, &basic);
+            g_ptr_array_add (strv, g_strdup (basic.s));
+          }
+        g_ptr_array_add (strv, NULL);
+
+        g_value_init (value, G_TYPE_STRV);
+        g_value_take_boxed (value, g_ptr_array_free (strv, FALSE));
+        return TRUE;
+      }
+
+    case DBUS_TYPE_OBJECT_PATH:
+      {
+        GPtrArray *paths = g_ptr_array_new ();
+
+        for (dbus_message_iter_recurse (iter, array);
+             dbus_message_iter_get_arg_type (array) != DBUS_TYPE_INVALID;
+             dbus_message_iter_next (array))
+          {
+            dbus_message_iter_get_basic (array, &basic);
+            g_ptr_array_add (paths, g_strdup (basic.s));
+          }
+
+        g_value_init (value, MODEM_TYPE_ARRAY_OF_PATHS);
+        g_value_take_boxed (value, paths);
+        return TRUE;
+      }
+
+    case DBUS_TYPE_DICT_ENTRY:
+      {
+        GHashTable *dict;
+        DBusMessageIter entry[1];
+        GValue *item;
+        char *signature;
+        gboolean is_dict;
+
+        signature = dbus_message_iter_get_signature (iter);
+        is_dict = strcmp (signature, "a{sv}") == 0;
+        dbus_free (signature);
+
+        if (!is_dict)
+          return FALSE;
+
+        dbus_message_iter_recurse (iter, array);
+
+        dict = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+            modem_oface_value_free);
+
+        for (;
+             dbus_message_iter_get_arg_type (array) != DBUS_TYPE_INVALID;
+             dbus_message_iter_next (array))
+          {
+            dbus_message_iter_recurse (array, entry);
+            dbus_message_iter_get_basic (entry, &basic);
+            dbus_message_iter_next (entry);
+
+            item = g_slice_new0 (GValue);
+            if (!modem_oface_demarshal_generic (entry, item))
+              {
+                g_slice_free (GValue, item);
+                DEBUG ("%s: cannot decode '%c'", basic.s,
+                    dbus_message_iter_get_arg_type (entry));
+                continue;
+              }
+
+            g_hash_table_insert (dict, g_strdup (basic.s), item);
+          }
+
+        g_value_init (value, MODEM_TYPE_DBUS_DICT);
+        g_value_take_boxed (value, dict);
+        return TRUE;
+      }
+
+    default:
+      return FALSE;
+    }
+}
+
+static void
+modem_oface_property_changed (ModemOface *self,
+                              char const *property,
+                              DBusMessageIter *variant)
+{
+  GParamSpec *pspec;
+  GValue value[1];
+  gpointer strv = NULL;
+
+  pspec = modem_oface_class_find_property (MODEM_OFACE_GET_CLASS (self),
+      property);
+
+  if (!pspec)
+    {
+      DEBUG ("%s (not mapped)", property);
+      return;
+    }
+
+  memset (value, 0, sizeof value);
+
+  if (!modem_oface_demarshal (variant, pspec, value, &strv))
+    {
+      /* Decode like dbus-glib would, then transform */
+      if (!modem_oface_demarshal_generic (variant, value))
+        {
+          DEBUG ("%s: cannot decode '%c', skipping", property,
+              dbus_message_iter_get_arg_type (variant));
+          return;
+        }
+
+      if (!g_value_type_transformable (G_VALUE_TYPE (value),
+              G_PARAM_SPEC_VALUE_TYPE (pspec)))
+        {
+          DEBUG ("%s: cannot convert %s to %s, skipping", property,
+              G_VALUE_TYPE_NAME (value),
+              g_type_name (G_PARAM_SPEC_VALUE_TYPE (pspec)));
+          g_value_unset (value);
+          return;
+        }
+    }
+
+  if (DEBUGGING)
+    {
+      char *s = g_strdup_value_contents (value);
+      DEBUG ("%s = %s (as %s)", property, s, pspec->name);
+      g_free (s);
+    }
+
+  modem_oface_set_mapped_property (self, pspec, value);
+  modem_oface_property_updated (self, pspec);
+
+  g_value_unset (value);
+  g_free (strv);
+}
+
+static void
+modem_oface_reply_to_get_name_owner (DBusPendingCall *pending,
+                                     void *dummy)
+{
+  DBusMessage *reply = dbus_pending_call_steal_reply (pending);
+  DBusError error[1];
+  char const *owner;
+
+  /* Replies and signals from the bus are handled in the order they were
+   * sent, so the reply is newer than any NameOwnerChanged before it */
+  g_free (modem_oface_ofono_owner);
+  modem_oface_ofono_owner = NULL;
+
+  dbus_error_init (error);
+
+  if (reply == NULL)
+    ;
+  else if (dbus_set_error_from_message (error, reply))
+    {
+      DEBUG ("%s: %s", OFONO_BUS_NAME, error->message);
+      dbus_error_free (error);
+    }
+  else if (dbus_message_get_args (reply, NULL,
+          DBUS_TYPE_STRING, &owner, DBUS_TYPE_INVALID))
+    {
+      DEBUG ("%s owner %s", OFONO_BUS_NAME, owner);
+      modem_oface_ofono_owner = g_strdup (owner);
+    }
+
+  if (reply)
+    dbus_message_unref (reply);
+  dbus_pending_call_unref (pending);
+}
+
+/* Look up the unique name of oFono. Until the reply arrives, the owner
+ * is not known and PropertyChanged signals are ignored. */
+static void
+modem_oface_get_ofono_owner (DBusConnection *connection)
+{
+  DBusMessage *call;
+  DBusPendingCall *pending = NULL;
+  char const *name = OFONO_BUS_NAME;
+
+  call = dbus_message_new_method_call (DBUS_SERVICE_DBUS, DBUS_PATH_DBUS,
+      DBUS_INTERFACE_DBUS, "GetNameOwner");
+  dbus_message_append_args (call, DBUS_TYPE_STRING, &name,
+      DBUS_TYPE_INVALID);
+
+  if (dbus_connection_send_with_reply (connection, call, &pending, -1) &&
+      pending != NULL)
+    dbus_pending_call_set_notify (pending,
+        modem_oface_reply_to_get_name_owner, NULL, NULL);
+  else
+    DEBUG ("cannot ask for owner of %s", OFONO_BUS_NAME);
+
+  dbus_message_unref (call);
+}
+
+/* Follow the unique name of oFono */
+static void
+modem_oface_name_owner_changed (DBusMessage *message)
+{
+  char const *name, *old_owner, *new_owner;
+
+  if (!dbus_message_has_sender (message, DBUS_SERVICE_DBUS) ||
+      !dbus_message_get_args (message, NULL,
+          DBUS_TYPE_STRING, &name,
+          DBUS_TYPE_STRING, &old_owner,
+          DBUS_TYPE_STRING, &new_owner,
+          DBUS_TYPE_INVALID) ||
+      strcmp (name, OFONO_BUS_NAME))
+    return;
+
+  DEBUG ("%s owner %s", OFONO_BUS_NAME, new_owner[0] ? new_owner : "none");
+
+  g_free (modem_oface_ofono_owner);
+  modem_oface_ofono_owner = new_owner[0] ? g_strdup (new_owner) : NULL;
+}
+
+static DBusHandlerResult
+modem_oface_signal_filter (DBusConnection *connection,
+                           DBusMessage *message,
+                           void *dummy)
+{
+  GHashTable *objects;
+  ModemOface *self;
+  DBusMessageIter iter[1], variant[1];
+  char const *interface, *path, *property, *sender;
+
+  if (dbus_message_get_type (message) != DBUS_MESSAGE_TYPE_SIGNAL)
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+  if (dbus_message_is_signal (message, DBUS_INTERFACE_DBUS,
+          "NameOwnerChanged"))
+    {
+      modem_oface_name_owner_changed (message);
+      return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+    }
+
+  if (!dbus_message_has_member (message, "PropertyChanged"))
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+  /* Anyone could send us a PropertyChanged */
+  sender = dbus_message_get_sender (message);
+  if (sender == NULL || modem_oface_ofono_owner == NULL ||
+      strcmp (sender, modem_oface_ofono_owner))
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+  interface = dbus_message_get_interface (message);
+  path = dbus_message_get_path (message);
+
+  if (interface == NULL || path == NULL)
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+  objects = g_hash_table_lookup (modem_oface_signal_table, interface);
+  if (objects == NULL)
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+  self = g_hash_table_lookup (objects, path);
+  if (self == NULL)
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+  if (!dbus_message_iter_init (message, iter) ||
+      dbus_message_iter_get_arg_type (iter) != DBUS_TYPE_STRING)
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+  dbus_message_iter_get_basic (iter, &property);
+
+  if (!dbus_message_iter_next (iter) ||
+      dbus_message_iter_get_arg_type (iter) != DBUS_TYPE_VARIANT)
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+  dbus_message_iter_recurse (iter, variant);
+
+  g_object_ref (self);
+  modem_oface_property_changed (self, property, variant);
+  g_object_unref (self);
+
+  return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+static void
+modem_oface_subscribe (ModemOface *self)
+{
+  DBusConnection *connection;
+  GHashTable *objects;
+  char const *interface = modem_oface_interface (self);
+
+  connection = dbus_g_connection_get_connection (modem_oface_get_bus ());
+
+  if (G_UNLIKELY (modem_oface_signal_table == NULL))
+    {
+      modem_oface_signal_table = g_hash_table_new_full (g_str_hash,
+          g_str_equal, g_free, (GDestroyNotify) g_hash_table_destroy);
+      dbus_connection_add_filter (connection,
+          modem_oface_signal_filter, NULL, NULL);
+
+      dbus_bus_add_match (connection, "type='signal',"
+          "sender='" DBUS_SERVICE_DBUS "',"
+          "interface='" DBUS_INTERFACE_DBUS "',"
+          "member='NameOwnerChanged',"
+          "arg0='" OFONO_BUS_NAME "'", NULL);
+      modem_oface_get_ofono_owner (connection);
+    }
+
+  objects = g_hash_table_lookup (modem_oface_signal_table, interface);
+  if (objects == NULL)
+    {
+      objects = g_hash_table_new_full (g_str_hash, g_str_equal,
+          g_free, NULL);
+      g_hash_table_insert (modem_oface_signal_table,
+          g_strdup (interface), objects);
+    }
+
+  g_hash_table_insert (objects,
+      g_strdup (modem_oface_object_path (self)), self);
+}
+
+static void
+modem_oface_unsubscribe (ModemOface *self)
+{
+  GHashTable *objects;
+  char const *interface = modem_oface_interface (self);
+  char const *path = modem_oface_object_path (self);
+
+  objects = g_hash_table_lookup (modem_oface_signal_table, interface);
+  if (objects == NULL)
     return;
 
-  gname = property_mapper (property);
+  if (g_hash_table_lookup (objects, path) == self)
+    g_hash_table_remove (objects, path);
+
+  if (g_hash_table_size (objects) == 0)
+    g_hash_table_remove (modem_oface_signal_table, interface);
+}
+
+/* Apply a property value from a GetProperties or managed object dict */
+static void
+modem_oface_apply_property (ModemOface *self,
+                            char const *property,
+                            GValue const *value)
+{
+  GParamSpec *pspec;
+
+  pspec = modem_oface_class_find_property (MODEM_OFACE_GET_CLASS (self),
+      property);
 
   if (DEBUGGING)
     {
       char *s = g_strdup_value_contents (value);
-      DEBUG("%s = %s (as %s)", property, s, gname);
+      DEBUG("%s = %s (as %s)", property, s, pspec ? pspec->name : NULL);
       g_free(s);
     }
 
-  if (!gname)
+  if (!pspec)
     return;
 
-  g_object_set_property (G_OBJECT (self), gname, value);
+  modem_oface_set_mapped_property (self, pspec, value);
+  modem_oface_property_updated (self, pspec);
 }
 
+/** Apply a dictionary of oFono properties.
+ *
+ * The property notifications are coalesced and a single
+ * "properties-updated" signal is emitted after the whole batch.
+ */
 void
 modem_oface_update_properties (ModemOface *self,
                                GHashTable *properties)
 {
+  ModemOfacePrivate *priv = self->priv;
+  GPtrArray *outer = priv->updated;
+  GPtrArray *updated;
   GHashTableIter iter[1];
   char *name;
   GValue *value;
 
   DEBUG ("enter");
 
+  updated = g_ptr_array_sized_new (g_hash_table_size (properties) + 1);
+
+  g_object_ref (self);
+  g_object_freeze_notify (G_OBJECT (self));
+
+  priv->updated = updated;
+
   for (g_hash_table_iter_init (iter, properties);
        g_hash_table_iter_next (iter, (gpointer)&name, (gpointer)&value);)
     {
-      on_property_changed (NULL, name, value, self);
+      modem_oface_apply_property (self, name, value);
     }
+
+  priv->updated = outer;
+
+  g_object_thaw_notify (G_OBJECT (self));
+
+  if (updated->len)
+    {
+      g_ptr_array_add (updated, NULL);
+      g_signal_emit (self, signals[SIGNAL_PROPERTIES_UPDATED], 0,
+          updated->pdata);
+    }
+
+  g_ptr_array_free (updated, TRUE);
+  g_object_unref (self);
 }
 
 static void
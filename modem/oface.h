@@ -115,6 +115,9 @@ ModemRequest *modem_oface_request_properties (ModemOface *,
 void modem_oface_update_properties (ModemOface *,
     GHashTable *properties);
 
+GParamSpec *modem_oface_class_find_property (ModemOfaceClass *,
+    char const *ofono_property);
+
 ModemRequest *modem_oface_request_managed (ModemOface *oface,
     char const *method,
     ModemOfaceManagedReply *callback,
@@ -37,19 +37,27 @@ ModemRequest *_modem_request_new (gpointer object,
     gpointer user_data);
 
 void _modem_request_add_proxy_call (ModemRequest *request,
+    char const *method,
     DBusGProxyCall *call);
 
 void _modem_request_destroy_notify (gpointer _request);
 
-/** Make a DBus method call with reply */
+int _modem_request_dbus_timeout (gpointer object);
+
+/** Make a DBus method call with reply.
+ *
+ * The call uses the timeout set with modem_request_set_timeout() for
+ * the @a object, if any.
+ */
 #define modem_request_begin(object, proxy, method, method_callback,     \
     callback, user, gtype, ...)                                         \
   ({ ModemRequest *_temp = NULL; DBusGProxyCall *_pcall;                \
     _temp = _modem_request_new ((object), (proxy), (callback), (user)); \
-    _pcall = dbus_g_proxy_begin_call ((proxy), (method),                \
+    _pcall = dbus_g_proxy_begin_call_with_timeout ((proxy), (method),   \
         (method_callback), _temp, _modem_request_destroy_notify,        \
+        _modem_request_dbus_timeout ((object)),                         \
         (gtype), ## __VA_ARGS__);                                       \
-    _modem_request_add_proxy_call (_temp, _pcall);                      \
+    _modem_request_add_proxy_call (_temp, (method), _pcall);            \
     _temp; })
 
 /** Make a DBus method call with reply and timeout */
@@ -61,7 +69,7 @@ void _modem_request_destroy_notify (gpointer _request);
     _pcall = dbus_g_proxy_begin_call_with_timeout ((proxy), (method),   \
         (method_callback), _temp, _modem_request_destroy_notify,        \
         (timeout), (gtype), ## __VA_ARGS__);                            \
-    _modem_request_add_proxy_call (_temp, _pcall);                      \
+    _modem_request_add_proxy_call (_temp, (method), _pcall);            \
     _temp; })
 
 
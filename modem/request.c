@@ -21,17 +21,14 @@
 
 #include "config.h"
 
+#define MODEM_DEBUG_FLAG MODEM_LOG_DBUS
+
+#include "debug.h"
+
 #include "modem/request-private.h"
 
 #include <string.h>
 
-/* This is a specially laid out GPtrArray */
-struct _ModemRequest
-{
-  ModemRequestPrivate *priv;
-  guint len;
-};
-
 typedef struct _ModemRequestNotify ModemRequestNotify;
 
 struct _ModemRequestPrivate
@@ -55,9 +52,196 @@ enum
 {
   N_SIZED = offsetof (ModemRequestPrivate, notify[4]) / sizeof (gpointer),
   N_SIZE = offsetof (ModemRequestPrivate, notify[0]) / sizeof (gpointer),
-  N_NOTIFY = sizeof (struct _ModemRequestNotify) / sizeof (gpointer)
+  N_NOTIFY = sizeof (struct _ModemRequestNotify) / sizeof (gpointer),
+  /* Number of free request blocks kept per thread */
+  N_POOLED = 32
+};
+
+typedef struct _ModemRequestRegistry ModemRequestRegistry;
+typedef struct _ModemRequestMethod ModemRequestMethod;
+
+/* This is laid out like a GPtrArray, see modem_request_object().
+ *
+ * The slots are kept inline in the request block until they overflow
+ * to heap, and the blocks are recycled through a per-thread free list.
+ */
+struct _ModemRequest
+{
+  ModemRequestPrivate *priv;
+  guint len;
+  guint alloc;
+
+  /* In-flight registration */
+  ModemRequestRegistry *registry;
+  char const *method;
+  gint64 started;
+  GList link[1];
+
+  gpointer slots[N_SIZED];
 };
 
+/* In-flight requests and latency histograms of an object */
+struct _ModemRequestRegistry
+{
+  char *label;
+  char *path;                   /* Object path of the proxy */
+  GQueue pending[1];
+  GHashTable *methods;
+};
+
+struct _ModemRequestMethod
+{
+  char const *method;
+  guint count;
+  guint64 total;
+  guint64 max;
+  guint buckets[MODEM_REQUEST_N_BUCKETS];
+};
+
+static GList *modem_request_registries;
+
+typedef struct _ModemRequestPool ModemRequestPool;
+
+struct _ModemRequestPool
+{
+  GTrashStack *free;
+  guint n_free;
+};
+
+static GStaticPrivate modem_request_pool_key = G_STATIC_PRIVATE_INIT;
+
+static struct
+{
+  volatile gint allocated;
+  volatile gint reused;
+  volatile gint released;
+  volatile gint freed;
+  volatile gint overflows;
+} modem_request_stats;
+
+static void
+modem_request_pool_free (gpointer _pool)
+{
+  ModemRequestPool *pool = _pool;
+  gpointer block;
+
+  while ((block = g_trash_stack_pop (&pool->free)))
+    {
+      g_slice_free1 (sizeof (ModemRequest), block);
+      g_atomic_int_inc (&modem_request_stats.freed);
+    }
+
+  g_slice_free (ModemRequestPool, pool);
+}
+
+static ModemRequestPool *
+modem_request_pool (void)
+{
+  ModemRequestPool *pool = g_static_private_get (&modem_request_pool_key);
+
+  if (G_UNLIKELY (pool == NULL))
+    {
+      pool = g_slice_new0 (ModemRequestPool);
+      g_static_private_set (&modem_request_pool_key, pool,
+          modem_request_pool_free);
+    }
+
+  return pool;
+}
+
+static ModemRequest *
+modem_request_alloc (void)
+{
+  ModemRequestPool *pool = modem_request_pool ();
+  ModemRequest *request;
+
+  if (pool->free)
+    {
+      request = g_trash_stack_pop (&pool->free);
+      pool->n_free--;
+      g_atomic_int_inc (&modem_request_stats.reused);
+    }
+  else
+    {
+      request = g_slice_new (ModemRequest);
+      g_atomic_int_inc (&modem_request_stats.allocated);
+    }
+
+  memset (request, 0, sizeof *request);
+
+  request->priv = (gpointer)request->slots;
+  request->len = N_SIZE;
+  request->alloc = N_SIZED;
+
+  return request;
+}
+
+static void
+modem_request_release (ModemRequest *request)
+{
+  ModemRequestPool *pool = modem_request_pool ();
+
+  if ((gpointer)request->priv != (gpointer)request->slots)
+    g_free (request->priv);
+
+  if (pool->n_free < N_POOLED)
+    {
+      g_trash_stack_push (&pool->free, request);
+      pool->n_free++;
+      g_atomic_int_inc (&modem_request_stats.released);
+    }
+  else
+    {
+      g_slice_free (ModemRequest, request);
+      g_atomic_int_inc (&modem_request_stats.freed);
+    }
+}
+
+/* Append a notify entry, spilling the slots to heap when needed */
+static void
+modem_request_append (ModemRequest *request,
+                      gpointer quark,
+                      GDestroyNotify destroy,
+                      gpointer data)
+{
+  gpointer *pdata;
+
+  if (request->len + N_NOTIFY > request->alloc)
+    {
+      guint alloc = request->alloc * 2;
+
+      pdata = g_new (gpointer, alloc);
+      memcpy (pdata, request->priv, request->len * sizeof (gpointer));
+
+      if ((gpointer)request->priv != (gpointer)request->slots)
+        g_free (request->priv);
+
+      request->priv = (gpointer)pdata;
+      request->alloc = alloc;
+
+      g_atomic_int_inc (&modem_request_stats.overflows);
+    }
+
+  pdata = (gpointer *)request->priv;
+
+  pdata[request->len++] = quark;
+  pdata[request->len++] = destroy;
+  pdata[request->len++] = data;
+}
+
+/** Get allocation statistics of ModemRequest blocks */
+void
+modem_request_get_stats (ModemRequestStats *stats)
+{
+  g_return_if_fail (stats != NULL);
+
+  stats->allocated = g_atomic_int_get (&modem_request_stats.allocated);
+  stats->reused = g_atomic_int_get (&modem_request_stats.reused);
+  stats->released = g_atomic_int_get (&modem_request_stats.released);
+  stats->freed = g_atomic_int_get (&modem_request_stats.freed);
+  stats->overflows = g_atomic_int_get (&modem_request_stats.overflows);
+}
+
 #define DUMMYQ modem_request_dummy_quark ()
 GQuark
 modem_request_dummy_quark (void)
@@ -85,11 +269,7 @@ _modem_request_new (gpointer object,
                     GCallback callback,
                     gpointer user_data)
 {
-  GPtrArray *container = g_ptr_array_sized_new (N_SIZED);
-
-  g_ptr_array_set_size (container, N_SIZE);
-
-  ModemRequest *request = (gpointer)container;
+  ModemRequest *request = modem_request_alloc ();
   ModemRequestPrivate *priv = request->priv;
 
   if (object)
@@ -101,11 +281,245 @@ _modem_request_new (gpointer object,
   return request;
 }
 
+/* ------------------------------------------------------------------------- */
+/* In-flight registry */
+
+#define MODEM_REQUEST_REGISTRY_QUARK modem_request_registry_quark ()
+static GQuark
+modem_request_registry_quark (void)
+{
+  static GQuark quark;
+  if (G_UNLIKELY (!quark))
+    quark = g_quark_from_static_string ("modem_request_registry");
+  return quark;
+}
+
+static void
+modem_request_registry_free (gpointer _registry)
+{
+  ModemRequestRegistry *registry = _registry;
+
+  modem_request_registries = g_list_remove (modem_request_registries,
+      registry);
+
+  g_hash_table_destroy (registry->methods);
+  g_free (registry->label);
+  g_free (registry->path);
+  g_slice_free (ModemRequestRegistry, registry);
+}
+
+static void
+modem_request_method_free (gpointer method)
+{
+  g_slice_free (ModemRequestMethod, method);
+}
+
+static ModemRequestRegistry *
+modem_request_registry (GObject *object,
+                        DBusGProxy *proxy)
+{
+  ModemRequestRegistry *registry;
+
+  registry = g_object_get_qdata (object, MODEM_REQUEST_REGISTRY_QUARK);
+
+  if (G_UNLIKELY (registry == NULL))
+    {
+      registry = g_slice_new0 (ModemRequestRegistry);
+      registry->path = g_strdup (dbus_g_proxy_get_path (proxy));
+      registry->label = g_strdup_printf ("%s %s",
+          G_OBJECT_TYPE_NAME (object), registry->path);
+      g_queue_init (registry->pending);
+      registry->methods = g_hash_table_new_full (NULL, NULL, NULL,
+          modem_request_method_free);
+
+      g_object_set_qdata_full (object, MODEM_REQUEST_REGISTRY_QUARK,
+          registry, modem_request_registry_free);
+
+      modem_request_registries = g_list_prepend (modem_request_registries,
+          registry);
+    }
+
+  return registry;
+}
+
+static void
+modem_request_register (ModemRequest *request,
+                        char const *method)
+{
+  ModemRequestPrivate *priv = request->priv;
+  ModemRequestRegistry *registry;
+
+  registry = modem_request_registry (priv->object, priv->proxy);
+
+  request->registry = registry;
+  request->method = g_intern_string (method);
+  request->started = g_get_monotonic_time ();
+  request->link->data = request;
+
+  g_queue_push_tail_link (registry->pending, request->link);
+}
+
+static void
+modem_request_unregister (ModemRequest *request)
+{
+  ModemRequestRegistry *registry = request->registry;
+  ModemRequestMethod *m;
+  guint64 latency;
+  guint i;
+
+  latency = g_get_monotonic_time () - request->started;
+
+  m = g_hash_table_lookup (registry->methods, request->method);
+  if (m == NULL)
+    {
+      m = g_slice_new0 (ModemRequestMethod);
+      m->method = request->method;
+      g_hash_table_insert (registry->methods, (gpointer)m->method, m);
+    }
+
+  m->count++;
+  m->total += latency;
+  if (latency > m->max)
+    m->max = latency;
+
+  /* Bucket 0 is below 1 ms, bucket i is below 2**i ms */
+  for (i = 0; i < MODEM_REQUEST_N_BUCKETS - 1; i++)
+    if (latency < (G_GUINT64_CONSTANT (1000) << i))
+      break;
+  m->buckets[i]++;
+
+  g_queue_unlink (registry->pending, request->link);
+  request->registry = NULL;
+}
+
 void
 _modem_request_add_proxy_call (ModemRequest *request,
+                               char const *method,
                                DBusGProxyCall *call)
 {
   request->priv->call = call;
+
+  if (request->priv->object)
+    modem_request_register (request, method);
+}
+
+/* Check if registry is for an object at or below path */
+static gboolean
+modem_request_registry_is_below (ModemRequestRegistry const *registry,
+                                 char const *path)
+{
+  gsize n;
+
+  if (path == NULL)
+    return TRUE;
+
+  n = strlen (path);
+
+  if (strncmp (registry->path, path, n))
+    return FALSE;
+
+  return registry->path[n] == '\0' || registry->path[n] == '/';
+}
+
+/** Iterate over requests waiting for reply.
+ *
+ * Only requests to objects at or below @a path are included, or all
+ * of them if @a path is NULL.
+ */
+void
+modem_request_foreach_pending (char const *path,
+                               ModemRequestPendingFunc *func,
+                               gpointer user_data)
+{
+  gint64 now = g_get_monotonic_time ();
+  GList *r, *l;
+
+  for (r = modem_request_registries; r; r = r->next)
+    {
+      ModemRequestRegistry *registry = r->data;
+
+      if (!modem_request_registry_is_below (registry, path))
+        continue;
+
+      for (l = registry->pending->head; l; l = l->next)
+        {
+          ModemRequest *request = l->data;
+
+          func (registry->label, request->method,
+              now - request->started, user_data);
+        }
+    }
+}
+
+/** Iterate over latency histograms of completed requests.
+ *
+ * Only requests to objects at or below @a path are included, or all
+ * of them if @a path is NULL.
+ */
+void
+modem_request_foreach_latency (char const *path,
+                               ModemRequestLatencyFunc *func,
+                               gpointer user_data)
+{
+  GHashTableIter iter[1];
+  ModemRequestMethod *m;
+  GList *r;
+
+  for (r = modem_request_registries; r; r = r->next)
+    {
+      ModemRequestRegistry *registry = r->data;
+
+      if (!modem_request_registry_is_below (registry, path))
+        continue;
+
+      for (g_hash_table_iter_init (iter, registry->methods);
+           g_hash_table_iter_next (iter, NULL, (gpointer)&m);)
+        {
+          func (registry->label, m->method, m->count, m->total, m->max,
+              m->buckets, user_data);
+        }
+    }
+}
+
+static void
+modem_request_dump_pending (char const *label,
+                            char const *method,
+                            guint64 age,
+                            gpointer dummy)
+{
+  modem_message (MODEM_LOG_DBUS, "%s: %s pending for %" G_GUINT64_FORMAT
+      " ms", label, method, age / 1000);
+}
+
+static void
+modem_request_dump_latency (char const *label,
+                            char const *method,
+                            guint count,
+                            guint64 total,
+                            guint64 max,
+                            guint const *buckets,
+                            gpointer dummy)
+{
+  GString *histogram = g_string_new ("");
+  guint i;
+
+  for (i = 0; i < MODEM_REQUEST_N_BUCKETS; i++)
+    g_string_append_printf (histogram, " %u", buckets[i]);
+
+  modem_message (MODEM_LOG_DBUS, "%s: %s count %u mean %" G_GUINT64_FORMAT
+      " ms max %" G_GUINT64_FORMAT " ms histogram%s",
+      label, method, count, total / count / 1000, max / 1000,
+      histogram->str);
+
+  g_string_free (histogram, TRUE);
+}
+
+/** Log pending requests and request latencies */
+void
+modem_request_dump (void)
+{
+  modem_request_foreach_pending (NULL, modem_request_dump_pending, NULL);
+  modem_request_foreach_latency (NULL, modem_request_dump_latency, NULL);
 }
 
 void
@@ -114,15 +528,15 @@ modem_request_add_qdata_full (ModemRequest *request,
                               gpointer user_data,
                               GDestroyNotify destroy)
 {
-  GPtrArray *container = (GPtrArray *)request;
+  gpointer *pdata = (gpointer *)request->priv;
   gpointer qpointer = GUINT_TO_POINTER (quark);
   guint i;
 
   g_assert (quark != DUMMYQ);
 
-  for (i = N_SIZE; i < container->len; i += N_NOTIFY)
+  for (i = N_SIZE; i < request->len; i += N_NOTIFY)
     {
-      ModemRequestNotify *notify = (gpointer)(container->pdata + i);
+      ModemRequestNotify *notify = (gpointer)(pdata + i);
 
       if (notify->quark == qpointer)
         {
@@ -138,9 +552,7 @@ modem_request_add_qdata_full (ModemRequest *request,
         }
     }
 
-  g_ptr_array_add (container, qpointer);
-  g_ptr_array_add (container, destroy);
-  g_ptr_array_add (container, user_data);
+  modem_request_append (request, qpointer, destroy, user_data);
 }
 
 void
@@ -181,7 +593,6 @@ modem_request_add_notifys (ModemRequest *request,
                            gpointer user_data,
                            ...)
 {
-  GPtrArray *container = (GPtrArray *)request;
   gpointer qpointer = GUINT_TO_POINTER (DUMMYQ);
 
   va_list ap;
@@ -190,9 +601,7 @@ modem_request_add_notifys (ModemRequest *request,
 
   for (;;)
     {
-      g_ptr_array_add (container, qpointer);
-      g_ptr_array_add (container, destroy);
-      g_ptr_array_add (container, user_data);
+      modem_request_append (request, qpointer, destroy, user_data);
 
       destroy = va_arg (ap, GDestroyNotify);
       if (!destroy)
@@ -207,20 +616,22 @@ gpointer
 modem_request_steal_qdata (ModemRequest *request,
                            GQuark quark)
 {
-  GPtrArray *container = (GPtrArray *)request;
+  gpointer *pdata = (gpointer *)request->priv;
   gpointer qpointer = GUINT_TO_POINTER (quark);
   guint i;
 
   g_assert (quark != DUMMYQ);
 
-  for (i = N_SIZE; i < container->len; i += N_NOTIFY)
+  for (i = N_SIZE; i < request->len; i += N_NOTIFY)
     {
-      ModemRequestNotify *notify = (gpointer)(container->pdata + i);
+      ModemRequestNotify *notify = (gpointer)(pdata + i);
 
       if (notify->quark == qpointer)
         {
           gpointer data = notify->data;
-          g_ptr_array_remove_range (container, i, N_NOTIFY);
+          memmove (pdata + i, pdata + i + N_NOTIFY,
+              (request->len - i - N_NOTIFY) * sizeof (gpointer));
+          request->len -= N_NOTIFY;
           return data;
         }
     }
@@ -232,14 +643,14 @@ gpointer
 modem_request_get_qdata (ModemRequest *request,
                          GQuark quark)
 {
-  GPtrArray *container = (GPtrArray *)request;
+  gpointer *pdata = (gpointer *)request->priv;
   gpointer qpointer = GUINT_TO_POINTER (quark);
 
   guint i;
 
-  for (i = N_SIZE; i < container->len; i += N_NOTIFY)
+  for (i = N_SIZE; i < request->len; i += N_NOTIFY)
     {
-      ModemRequestNotify *notify = (gpointer)(container->pdata + i);
+      ModemRequestNotify *notify = (gpointer)(pdata + i);
       if (notify->quark == qpointer)
         return notify->data;
     }
@@ -294,16 +705,19 @@ _modem_request_destroy_notify (gpointer _request)
   GObject *object = priv->object;
   DBusGProxy *proxy = priv->proxy;
 
+  if (request->registry)
+    modem_request_unregister (request);
+
   priv->object = NULL;
   priv->proxy = NULL;
   priv->call = NULL;
 
-  GPtrArray *container = (GPtrArray *)request;
   guint i;
 
-  for (i = N_SIZE; i < container->len; i += N_NOTIFY)
+  /* A destroy notify may add or steal qdata, so re-read the slots */
+  for (i = N_SIZE; i < request->len; i += N_NOTIFY)
     {
-      ModemRequestNotify *notify = (gpointer)(container->pdata + i);
+      ModemRequestNotify *notify = (gpointer)((gpointer *)request->priv + i);
 
       GDestroyNotify destroy = notify->destroy;
       gpointer data = notify->data;
@@ -319,7 +733,7 @@ _modem_request_destroy_notify (gpointer _request)
   if (object)
     g_object_unref (object);
 
-  g_ptr_array_free (_request, TRUE);
+  modem_request_release (request);
 }
 
 /**  Cancel request
@@ -344,6 +758,58 @@ modem_request_cancel (ModemRequest *request)
     _modem_request_destroy_notify (request);
 }
 
+/* ------------------------------------------------------------------------- */
+/* Timeouts */
+
+#define MODEM_REQUEST_TIMEOUT_QUARK modem_request_timeout_quark ()
+static GQuark
+modem_request_timeout_quark (void)
+{
+  static GQuark quark;
+  if (G_UNLIKELY (!quark))
+    quark = g_quark_from_static_string ("modem_request_timeout");
+  return quark;
+}
+
+/** Set reply timeout for requests made on behalf of @a object.
+ *
+ * If no reply is received within @a timeout milliseconds, the pending
+ * call is cancelled and the reply callback is invoked with a
+ * DBUS_GERROR_NO_REPLY error. Zero restores the D-Bus default timeout.
+ */
+void
+modem_request_set_timeout (gpointer object,
+                           guint timeout)
+{
+  g_return_if_fail (G_IS_OBJECT (object));
+  g_return_if_fail (timeout <= G_MAXINT);
+
+  g_object_set_qdata (object, MODEM_REQUEST_TIMEOUT_QUARK,
+      GUINT_TO_POINTER (timeout));
+}
+
+/** Get reply timeout for requests made on behalf of @a object.
+ *
+ * Returns 0 if the D-Bus default timeout is used.
+ */
+guint
+modem_request_get_timeout (gpointer object)
+{
+  if (object == NULL)
+    return 0;
+
+  return GPOINTER_TO_UINT (g_object_get_qdata (object,
+          MODEM_REQUEST_TIMEOUT_QUARK));
+}
+
+int
+_modem_request_dbus_timeout (gpointer object)
+{
+  guint timeout = modem_request_get_timeout (object);
+
+  return timeout ? (int)timeout : -1;
+}
+
 void
 modem_request_add_cancel_notify (ModemRequest *request,
                                  GDestroyNotify notify)
@@ -61,6 +61,47 @@ void modem_request_add_data_full (ModemRequest *request,
 gpointer modem_request_get_data (ModemRequest *request, char const *key);
 gpointer modem_request_steal_data (ModemRequest *request, char const *key);
 
+void modem_request_set_timeout (gpointer object, guint timeout);
+guint modem_request_get_timeout (gpointer object);
+
+/* Number of buckets in latency histogram */
+#define MODEM_REQUEST_N_BUCKETS (16)
+
+typedef void ModemRequestPendingFunc (char const *object,
+    char const *method,
+    guint64 age_usec,
+    gpointer user_data);
+
+typedef void ModemRequestLatencyFunc (char const *object,
+    char const *method,
+    guint count,
+    guint64 total_usec,
+    guint64 max_usec,
+    guint const buckets[MODEM_REQUEST_N_BUCKETS],
+    gpointer user_data);
+
+void modem_request_foreach_pending (char const *path,
+    ModemRequestPendingFunc *func,
+    gpointer user_data);
+void modem_request_foreach_latency (char const *path,
+    ModemRequestLatencyFunc *func,
+    gpointer user_data);
+void modem_request_dump (void);
+
+typedef struct _ModemRequestStats ModemRequestStats;
+
+/** Counters for ModemRequest blocks */
+struct _ModemRequestStats
+{
+  guint allocated;  /**< blocks allocated from g_slice */
+  guint reused;     /**< blocks taken from per-thread free list */
+  guint released;   /**< blocks returned to per-thread free list */
+  guint freed;      /**< blocks returned to g_slice */
+  guint overflows;  /**< notify slots spilled to heap */
+};
+
+void modem_request_get_stats (ModemRequestStats *stats);
+
 G_END_DECLS
 
 #endif /* #ifndef _MODEM_REQUEST_H_ */
@@ -0,0 +1,613 @@
+/*
+ * modem/sms-codec.c - SMS text encoding and length estimation
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Text is sent in the GSM 03.38 default alphabet when possible, and in
+ * UCS-2 otherwise. Most messages are plain ASCII, and most ASCII
+ * characters have the same code in the default alphabet, so the text
+ * is scanned 16 bytes at a time with SSE2 or NEON when available. The
+ * blocks with other characters are handled one character at a time.
+ */
+
+#include "config.h"
+
+#define MODEM_DEBUG_FLAG MODEM_LOG_SMS
+
+#include "debug.h"
+
+#include "modem/sms-codec.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#elif defined (__ARM_NEON__) || defined (__ARM_NEON)
+#include <arm_neon.h>
+#define USE_NEON 1
+#endif
+
+#define GSM7_ESCAPE (0x1b)
+/* Flag for characters in the extension table, sent after escape */
+#define GSM7_EXT (0x100)
+
+static guint16 const gsm7_default[128] = {
+  0x0040, 0x00a3, 0x0024, 0x00a5, 0x00e8, 0x00e9, 0x00f9, 0x00ec,
+  0x00f2, 0x00c7, 0x000a, 0x00d8, 0x00f8, 0x000d, 0x00c5, 0x00e5,
+  0x0394, 0x005f, 0x03a6, 0x0393, 0x039b, 0x03a9, 0x03a0, 0x03a8,
+  0x03a3, 0x0398, 0x039e, 0x00a0, 0x00c6, 0x00e6, 0x00df, 0x00c9,
+  0x0020, 0x0021, 0x0022, 0x0023, 0x00a4, 0x0025, 0x0026, 0x0027,
+  0x0028, 0x0029, 0x002a, 0x002b, 0x002c, 0x002d, 0x002e, 0x002f,
+  0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+  0x0038, 0x0039, 0x003a, 0x003b, 0x003c, 0x003d, 0x003e, 0x003f,
+  0x00a1, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+  0x0048, 0x0049, 0x004a, 0x004b, 0x004c, 0x004d, 0x004e, 0x004f,
+  0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+  0x0058, 0x0059, 0x005a, 0x00c4, 0x00d6, 0x00d1, 0x00dc, 0x00a7,
+  0x00bf, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+  0x0068, 0x0069, 0x006a, 0x006b, 0x006c, 0x006d, 0x006e, 0x006f,
+  0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+  0x0078, 0x0079, 0x007a, 0x00e4, 0x00f6, 0x00f1, 0x00fc, 0x00e0,
+};
+
+static struct {
+  guint8 code;
+  guint16 uc;
+} const gsm7_extension[] = {
+  { 0x0a, 0x000c }, { 0x14, 0x005e }, { 0x28, 0x007b }, { 0x29, 0x007d },
+  { 0x2f, 0x005c }, { 0x3c, 0x005b }, { 0x3d, 0x007e }, { 0x3e, 0x005d },
+  { 0x40, 0x007c }, { 0x65, 0x20ac },
+};
+
+typedef struct {
+  gunichar uc;
+  guint16 code;
+} Gsm7Reverse;
+
+/* Codes of ASCII characters, -1 if not in alphabet */
+static gint16 gsm7_ascii[128];
+/* Codes of other characters, sorted by character */
+static Gsm7Reverse gsm7_reverse[128 + G_N_ELEMENTS (gsm7_extension)];
+static guint gsm7_n_reverse;
+
+static int
+gsm7_reverse_cmp (void const *_a, void const *_b)
+{
+  Gsm7Reverse const *a = _a, *b = _b;
+
+  return a->uc < b->uc ? -1 : a->uc > b->uc;
+}
+
+static void
+gsm7_add (gunichar uc, guint16 code)
+{
+  if (uc < 0x80)
+    gsm7_ascii[uc] = code;
+  else
+    {
+      gsm7_reverse[gsm7_n_reverse].uc = uc;
+      gsm7_reverse[gsm7_n_reverse].code = code;
+      gsm7_n_reverse++;
+    }
+}
+
+static void
+gsm7_init (void)
+{
+  static gsize initialized = 0;
+  guint i;
+
+  if (!g_once_init_enter (&initialized))
+    return;
+
+  for (i = 0; i < 128; i++)
+    gsm7_ascii[i] = -1;
+
+  for (i = 0; i < 128; i++)
+    if (i != GSM7_ESCAPE)
+      gsm7_add (gsm7_default[i], i);
+
+  for (i = 0; i < G_N_ELEMENTS (gsm7_extension); i++)
+    gsm7_add (gsm7_extension[i].uc, GSM7_EXT | gsm7_extension[i].code);
+
+  qsort (gsm7_reverse, gsm7_n_reverse, sizeof gsm7_reverse[0],
+      gsm7_reverse_cmp);
+
+  g_once_init_leave (&initialized, 1);
+}
+
+/* Return code of character, -1 if it is not in the alphabet */
+static gint
+gsm7_lookup (gunichar uc)
+{
+  Gsm7Reverse key = { uc, 0 };
+  Gsm7Reverse const *found;
+
+  if (uc < 0x80)
+    return gsm7_ascii[uc];
+
+  found = bsearch (&key, gsm7_reverse, gsm7_n_reverse, sizeof key,
+      gsm7_reverse_cmp);
+
+  return found ? found->code : -1;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Block kernels */
+
+/* Return length of the prefix, in whole 16-byte blocks, where every byte
+ * is an ASCII character with the same code in the default alphabet */
+static gsize
+gsm7_identity_run (guint8 const *s,
+                   gsize n)
+{
+  gsize i = 0;
+
+#if defined (__SSE2__)
+  /* Signed compares, so bytes above 0x7f are below lo */
+  __m128i const lo = _mm_set1_epi8 (0x1f), hi = _mm_set1_epi8 (0x7b);
+  __m128i const dollar = _mm_set1_epi8 ('$'), at = _mm_set1_epi8 ('@');
+  __m128i const z = _mm_set1_epi8 ('Z'), a = _mm_set1_epi8 ('a');
+
+  for (; i + 16 <= n; i += 16)
+    {
+      __m128i b = _mm_loadu_si128 ((__m128i const *)(s + i));
+      __m128i ok, bad;
+
+      ok = _mm_and_si128 (_mm_cmpgt_epi8 (b, lo), _mm_cmplt_epi8 (b, hi));
+      bad = _mm_or_si128 (_mm_cmpeq_epi8 (b, dollar), _mm_cmpeq_epi8 (b, at));
+      bad = _mm_or_si128 (bad,
+          _mm_and_si128 (_mm_cmpgt_epi8 (b, z), _mm_cmplt_epi8 (b, a)));
+
+      if (_mm_movemask_epi8 (_mm_andnot_si128 (bad, ok)) != 0xffff)
+        break;
+    }
+#elif USE_NEON
+  uint8x16_t const lo = vdupq_n_u8 (0x1f), hi = vdupq_n_u8 (0x7b);
+  uint8x16_t const dollar = vdupq_n_u8 ('$'), at = vdupq_n_u8 ('@');
+  uint8x16_t const z = vdupq_n_u8 ('Z'), a = vdupq_n_u8 ('a');
+
+  for (; i + 16 <= n; i += 16)
+    {
+      uint8x16_t b = vld1q_u8 (s + i);
+      uint8x16_t ok, bad;
+      uint8x8_t all;
+
+      ok = vandq_u8 (vcgtq_u8 (b, lo), vcltq_u8 (b, hi));
+      bad = vorrq_u8 (vceqq_u8 (b, dollar), vceqq_u8 (b, at));
+      bad = vorrq_u8 (bad, vandq_u8 (vcgtq_u8 (b, z), vcltq_u8 (b, a)));
+      ok = vbicq_u8 (ok, bad);
+
+      all = vand_u8 (vget_low_u8 (ok), vget_high_u8 (ok));
+      if (vget_lane_u64 (vreinterpret_u64_u8 (all), 0) != ~(guint64)0)
+        break;
+    }
+#else
+  (void)s, (void)n;
+#endif
+
+  return i;
+}
+
+/* Count UTF-16 code units in valid UTF-8: one for each byte that is
+ * not a continuation byte, and another for each 4-byte sequence */
+static guint
+utf16_units (guint8 const *s,
+             gsize n,
+             guint *return_pairs)
+{
+  gsize i = 0;
+  guint chars = 0, pairs = 0;
+
+#if defined (__SSE2__)
+  __m128i const mask = _mm_set1_epi8 ((char)0xc0);
+  __m128i const cont = _mm_set1_epi8 ((char)0x80);
+  __m128i const lead4 = _mm_set1_epi8 ((char)0xf0);
+  __m128i const one = _mm_set1_epi8 (1), zero = _mm_setzero_si128 ();
+  __m128i n_cont = zero, n_lead4 = zero;
+
+  for (; i + 16 <= n; i += 16)
+    {
+      __m128i b = _mm_loadu_si128 ((__m128i const *)(s + i));
+      __m128i c = _mm_cmpeq_epi8 (_mm_and_si128 (b, mask), cont);
+      __m128i l = _mm_cmpeq_epi8 (_mm_max_epu8 (b, lead4), b);
+
+      n_cont = _mm_add_epi64 (n_cont,
+          _mm_sad_epu8 (_mm_and_si128 (c, one), zero));
+      n_lead4 = _mm_add_epi64 (n_lead4,
+          _mm_sad_epu8 (_mm_and_si128 (l, one), zero));
+    }
+
+  n_cont = _mm_add_epi64 (n_cont, _mm_srli_si128 (n_cont, 8));
+  n_lead4 = _mm_add_epi64 (n_lead4, _mm_srli_si128 (n_lead4, 8));
+  chars = i - _mm_cvtsi128_si32 (n_cont);
+  pairs = _mm_cvtsi128_si32 (n_lead4);
+#elif USE_NEON
+  uint8x16_t const mask = vdupq_n_u8 (0xc0), cont = vdupq_n_u8 (0x80);
+  uint8x16_t const lead4 = vdupq_n_u8 (0xf0), one = vdupq_n_u8 (1);
+  uint32x4_t n_cont = vdupq_n_u32 (0), n_lead4 = vdupq_n_u32 (0);
+  uint64x2_t sum;
+
+  for (; i + 16 <= n; i += 16)
+    {
+      uint8x16_t b = vld1q_u8 (s + i);
+      uint8x16_t c = vceqq_u8 (vandq_u8 (b, mask), cont);
+      uint8x16_t l = vcgeq_u8 (b, lead4);
+
+      n_cont = vpadalq_u16 (n_cont, vpaddlq_u8 (vandq_u8 (c, one)));
+      n_lead4 = vpadalq_u16 (n_lead4, vpaddlq_u8 (vandq_u8 (l, one)));
+    }
+
+  sum = vpaddlq_u32 (n_cont);
+  chars = i - (vgetq_lane_u64 (sum, 0) + vgetq_lane_u64 (sum, 1));
+  sum = vpaddlq_u32 (n_lead4);
+  pairs = vgetq_lane_u64 (sum, 0) + vgetq_lane_u64 (sum, 1);
+#endif
+
+  for (; i < n; i++)
+    {
+      if ((s[i] & 0xc0) != 0x80)
+        chars++;
+      if (s[i] >= 0xf0)
+        pairs++;
+    }
+
+  *return_pairs = pairs;
+
+  return chars + pairs;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Length estimation */
+
+/* Count septets needed for valid UTF-8 text.
+ *
+ * @retval FALSE if text can not be sent in default alphabet
+ */
+static gboolean
+gsm7_count (guint8 const *s,
+            gsize n,
+            guint *return_septets,
+            gboolean *return_escaped)
+{
+  gsize i = 0, end;
+  guint septets = 0;
+  gboolean escaped = FALSE;
+
+  while (i < n)
+    {
+      gsize k = gsm7_identity_run (s + i, n - i);
+
+      septets += k, i += k;
+
+      /* Handle the rest of the block one character at a time */
+      for (end = MIN (i + 16, n); i < end;)
+        {
+          gint code = gsm7_lookup (g_utf8_get_char ((char const *)s + i));
+
+          if (code < 0)
+            return FALSE;
+
+          if (code & GSM7_EXT)
+            septets += 2, escaped = TRUE;
+          else
+            septets += 1;
+
+          i += g_utf8_skip[s[i]];
+        }
+    }
+
+  *return_septets = septets;
+  *return_escaped = escaped;
+
+  return TRUE;
+}
+
+/* Count SMSes when a character must not be split between them */
+static guint
+count_segments (char const *text,
+                ModemSMSAlphabet alphabet,
+                guint capacity,
+                guint *return_used)
+{
+  char const *s;
+  guint segments = 1, used = 0;
+
+  for (s = text; *s; s = g_utf8_next_char (s))
+    {
+      gunichar uc = g_utf8_get_char (s);
+      guint width;
+
+      if (alphabet == MODEM_SMS_ALPHABET_GSM7)
+        width = (gsm7_lookup (uc) & GSM7_EXT) ? 2 : 1;
+      else
+        width = uc > 0xffff ? 2 : 1;
+
+      if (used + width > capacity)
+        segments++, used = 0;
+
+      used += width;
+    }
+
+  *return_used = used;
+
+  return segments;
+}
+
+/** Estimate how many SMSes are needed to send text.
+ *
+ * @retval FALSE if text is not valid UTF-8
+ */
+gboolean
+modem_sms_length (char const *text,
+                  ModemSMSLength *return_length)
+{
+  guint8 const *s = (guint8 const *)text;
+  gsize n;
+  guint units, single, multi, used;
+  gboolean wide;
+
+  g_return_val_if_fail (text != NULL, FALSE);
+  g_return_val_if_fail (return_length != NULL, FALSE);
+
+  n = strlen (text);
+  if (!g_utf8_validate (text, n, NULL))
+    return FALSE;
+
+  gsm7_init ();
+
+  if (gsm7_count (s, n, &units, &wide))
+    {
+      return_length->alphabet = MODEM_SMS_ALPHABET_GSM7;
+      single = MODEM_SMS_GSM7_SINGLE, multi = MODEM_SMS_GSM7_MULTI;
+    }
+  else
+    {
+      guint pairs;
+
+      units = utf16_units (s, n, &pairs);
+      wide = pairs != 0;
+      return_length->alphabet = MODEM_SMS_ALPHABET_UCS2;
+      single = MODEM_SMS_UCS2_SINGLE, multi = MODEM_SMS_UCS2_MULTI;
+    }
+
+  return_length->units = units;
+
+  if (units <= single)
+    {
+      return_length->segments = 1;
+      return_length->remaining = single - units;
+    }
+  else if (wide)
+    {
+      return_length->segments = count_segments (text,
+          return_length->alphabet, multi, &used);
+      return_length->remaining = multi - used;
+    }
+  else
+    {
+      return_length->segments = (units + multi - 1) / multi;
+      return_length->remaining = return_length->segments * multi - units;
+    }
+
+  return TRUE;
+}
+
+/* ------------------------------------------------------------------------ */
+/* GSM 03.38 default alphabet */
+
+/** Convert UTF-8 text to unpacked septets.
+ *
+ * @return septets, or NULL if text can not be represented in the
+ * default alphabet. Free with g_free().
+ */
+guint8 *
+modem_sms_gsm7_encode (char const *text,
+                       gsize *return_length)
+{
+  guint8 const *s = (guint8 const *)text;
+  guint8 *septets;
+  gsize i = 0, j = 0, n, end;
+
+  g_return_val_if_fail (text != NULL, NULL);
+  g_return_val_if_fail (return_length != NULL, NULL);
+
+  n = strlen (text);
+  if (!g_utf8_validate (text, n, NULL))
+    return NULL;
+
+  gsm7_init ();
+
+  /* No character takes more septets than it has bytes in UTF-8 */
+  septets = g_malloc (2 * n + 1);
+
+  while (i < n)
+    {
+      gsize k = gsm7_identity_run (s + i, n - i);
+
+      memcpy (septets + j, s + i, k);
+      i += k, j += k;
+
+      for (end = MIN (i + 16, n); i < end;)
+        {
+          gint code = gsm7_lookup (g_utf8_get_char ((char const *)s + i));
+
+          if (code < 0)
+            {
+              g_free (septets);
+              return NULL;
+            }
+
+          if (code & GSM7_EXT)
+            septets[j++] = GSM7_ESCAPE;
+          septets[j++] = code & 0x7f;
+
+          i += g_utf8_skip[s[i]];
+        }
+    }
+
+  *return_length = j;
+
+  return septets;
+}
+
+/** Convert unpacked septets to UTF-8 text. Free with g_free(). */
+char *
+modem_sms_gsm7_decode (guint8 const *septets,
+                       gsize length)
+{
+  GString *text = g_string_sized_new (length + length / 2 + 1);
+  gsize i;
+
+  for (i = 0; i < length; i++)
+    {
+      guint8 c = septets[i] & 0x7f;
+      gunichar uc = gsm7_default[c];
+
+      if (c == GSM7_ESCAPE && i + 1 < length)
+        {
+          guint j;
+
+          /* Unknown extension is shown as the character in default table */
+          c = septets[++i] & 0x7f;
+          uc = gsm7_default[c];
+
+          for (j = 0; j < G_N_ELEMENTS (gsm7_extension); j++)
+            if (gsm7_extension[j].code == c)
+              uc = gsm7_extension[j].uc;
+        }
+
+      if (uc < 0x80)
+        g_string_append_c (text, uc);
+      else
+        g_string_append_unichar (text, uc);
+    }
+
+  return g_string_free (text, FALSE);
+}
+
+/** Pack septets into octets, as in 3GPP TS 23.038 6.1.2.1.1.
+ *
+ * The @a packed must have room for (@a length * 7 + 7) / 8 octets.
+ *
+ * @return number of octets
+ */
+gsize
+modem_sms_gsm7_pack (guint8 const *septets,
+                     gsize length,
+                     guint8 *packed)
+{
+  guint32 bits = 0;
+  guint n_bits = 0;
+  gsize i, j = 0;
+
+  for (i = 0; i < length; i++)
+    {
+      bits |= (guint32)(septets[i] & 0x7f) << n_bits;
+      n_bits += 7;
+
+      if (n_bits >= 8)
+        {
+          packed[j++] = bits & 0xff;
+          bits >>= 8, n_bits -= 8;
+        }
+    }
+
+  if (n_bits)
+    packed[j++] = bits;
+
+  return j;
+}
+
+/** Unpack @a length septets from octets. */
+void
+modem_sms_gsm7_unpack (guint8 const *packed,
+                       gsize length,
+                       guint8 *septets)
+{
+  guint32 bits = 0;
+  guint n_bits = 0;
+  gsize i = 0, j;
+
+  for (j = 0; j < length; j++)
+    {
+      if (n_bits < 7)
+        {
+          bits |= (guint32)packed[i++] << n_bits;
+          n_bits += 8;
+        }
+
+      septets[j] = bits & 0x7f;
+      bits >>= 7, n_bits -= 7;
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* UCS-2 */
+
+/** Convert UTF-8 text to UTF-16 big endian.
+ *
+ * @return octets, or NULL if text is not valid UTF-8. Free with g_free().
+ */
+guint8 *
+modem_sms_ucs2_encode (char const *text,
+                       gsize *return_length)
+{
+  gunichar2 *utf16;
+  glong i, n;
+
+  g_return_val_if_fail (text != NULL, NULL);
+  g_return_val_if_fail (return_length != NULL, NULL);
+
+  utf16 = g_utf8_to_utf16 (text, -1, NULL, &n, NULL);
+  if (utf16 == NULL)
+    return NULL;
+
+  for (i = 0; i < n; i++)
+    utf16[i] = GUINT16_TO_BE (utf16[i]);
+
+  *return_length = 2 * n;
+
+  return (guint8 *)utf16;
+}
+
+/** Convert UTF-16 big endian to UTF-8 text.
+ *
+ * @return text, or NULL if @a ucs2 is not valid. Free with g_free().
+ */
+char *
+modem_sms_ucs2_decode (guint8 const *ucs2,
+                       gsize length)
+{
+  gunichar2 *utf16;
+  char *text;
+  gsize i, n = length / 2;
+
+  utf16 = g_new (gunichar2, n + 1);
+
+  for (i = 0; i < n; i++)
+    utf16[i] = (ucs2[2 * i] << 8) | ucs2[2 * i + 1];
+
+  text = g_utf16_to_utf8 (utf16, n, NULL, NULL, NULL);
+
+  g_free (utf16);
+
+  return text;
+}
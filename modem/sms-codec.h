@@ -0,0 +1,61 @@
+/*
+ * modem/sms-codec.h - SMS text encoding and length estimation
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _MODEM_SMS_CODEC_H_
+#define _MODEM_SMS_CODEC_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+  MODEM_SMS_ALPHABET_GSM7,      /* GSM 03.38 default alphabet */
+  MODEM_SMS_ALPHABET_UCS2,      /* UTF-16 big endian */
+} ModemSMSAlphabet;
+
+/* Capacity of a single SMS and of a fragment of a concatenated one */
+#define MODEM_SMS_GSM7_SINGLE (160)
+#define MODEM_SMS_GSM7_MULTI (153)
+#define MODEM_SMS_UCS2_SINGLE (70)
+#define MODEM_SMS_UCS2_MULTI (67)
+
+typedef struct {
+  ModemSMSAlphabet alphabet;
+  guint units;                  /* Septets or UTF-16 code units */
+  guint segments;               /* Number of SMSes needed */
+  guint remaining;              /* Units left in the last SMS */
+} ModemSMSLength;
+
+gboolean modem_sms_length (char const *text, ModemSMSLength *return_length);
+
+guint8 *modem_sms_gsm7_encode (char const *text, gsize *return_length);
+char *modem_sms_gsm7_decode (guint8 const *septets, gsize length);
+
+gsize modem_sms_gsm7_pack (guint8 const *septets, gsize length,
+    guint8 *packed);
+void modem_sms_gsm7_unpack (guint8 const *packed, gsize length,
+    guint8 *septets);
+
+guint8 *modem_sms_ucs2_encode (char const *text, gsize *return_length);
+char *modem_sms_ucs2_decode (guint8 const *ucs2, gsize length);
+
+G_END_DECLS
+
+#endif /* #ifndef _MODEM_SMS_CODEC_H_*/
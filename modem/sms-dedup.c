@@ -0,0 +1,319 @@
+/*
+ * modem/sms-dedup.c - Index of received SMS for dropping duplicates
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * oFono may hand us a message again after the modem has been reset or
+ * the connection to it has been lost. The index remembers a hash of
+ * each message seen within a time window, so that the same message is
+ * not delivered to clients twice. The index is bounded; when full, the
+ * least recently seen message is dropped.
+ */
+
+#include "config.h"
+
+#define MODEM_DEBUG_FLAG MODEM_LOG_SMS
+
+#include "debug.h"
+
+#include "modem/sms-dedup.h"
+
+#include <glib/gstdio.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+  guint64 key;
+  gint64 seen;
+} ModemSMSDedupEntry;
+
+struct _ModemSMSDedup
+{
+  /* Least recently seen first */
+  GQueue entries[1];
+  /* key => link in entries */
+  GHashTable *index;
+  guint max_entries;
+  guint window;                 /* Seconds */
+};
+
+ModemSMSDedup *
+modem_sms_dedup_new (guint max_entries, guint window)
+{
+  ModemSMSDedup *self = g_slice_new0 (ModemSMSDedup);
+
+  g_queue_init (self->entries);
+  self->index = g_hash_table_new (g_int64_hash, g_int64_equal);
+  self->max_entries = MAX (max_entries, 1);
+  self->window = window;
+
+  return self;
+}
+
+void
+modem_sms_dedup_free (ModemSMSDedup *self)
+{
+  ModemSMSDedupEntry *entry;
+
+  if (self == NULL)
+    return;
+
+  while ((entry = g_queue_pop_head (self->entries)))
+    g_slice_free (ModemSMSDedupEntry, entry);
+
+  g_hash_table_destroy (self->index);
+
+  g_slice_free (ModemSMSDedup, self);
+}
+
+/** Hash the fields identifying an incoming message. */
+guint64
+modem_sms_dedup_key (char const *sender,
+                     char const *sent_time,
+                     char const *body)
+{
+  char const *fields[3] = { sender, sent_time, body };
+  guint64 hash = G_GUINT64_CONSTANT (14695981039346656037);
+  guint i;
+
+  /* FNV-1a, with the terminating NULs so that field boundaries count */
+  for (i = 0; i < G_N_ELEMENTS (fields); i++)
+    {
+      guint8 const *s = (guint8 const *)(fields[i] ? fields[i] : "");
+
+      do
+        hash = (hash ^ *s) * G_GUINT64_CONSTANT (1099511628211);
+      while (*s++);
+    }
+
+  return hash;
+}
+
+static void
+modem_sms_dedup_drop_head (ModemSMSDedup *self)
+{
+  ModemSMSDedupEntry *entry = g_queue_pop_head (self->entries);
+
+  g_hash_table_remove (self->index, &entry->key);
+  g_slice_free (ModemSMSDedupEntry, entry);
+}
+
+static void
+modem_sms_dedup_expire (ModemSMSDedup *self,
+                        gint64 now)
+{
+  ModemSMSDedupEntry *entry;
+
+  while ((entry = g_queue_peek_head (self->entries)) &&
+      entry->seen + self->window < now)
+    modem_sms_dedup_drop_head (self);
+}
+
+static void
+modem_sms_dedup_add (ModemSMSDedup *self,
+                     guint64 key,
+                     gint64 seen)
+{
+  ModemSMSDedupEntry *entry = g_slice_new (ModemSMSDedupEntry);
+
+  entry->key = key;
+  entry->seen = seen;
+
+  g_queue_push_tail (self->entries, entry);
+  g_hash_table_insert (self->index, &entry->key, self->entries->tail);
+
+  while (self->entries->length > self->max_entries)
+    modem_sms_dedup_drop_head (self);
+}
+
+/** Check if a message has been seen already, and remember it.
+ *
+ * @retval TRUE if message is a duplicate
+ */
+gboolean
+modem_sms_dedup_check (ModemSMSDedup *self,
+                       guint64 key,
+                       gint64 now)
+{
+  GList *link;
+
+  modem_sms_dedup_expire (self, now);
+
+  link = g_hash_table_lookup (self->index, &key);
+  if (link)
+    {
+      ModemSMSDedupEntry *entry = link->data;
+
+      entry->seen = now;
+      g_queue_unlink (self->entries, link);
+      g_queue_push_tail_link (self->entries, link);
+
+      return TRUE;
+    }
+
+  modem_sms_dedup_add (self, key, now);
+
+  return FALSE;
+}
+
+guint
+modem_sms_dedup_size (ModemSMSDedup const *self)
+{
+  return self->entries->length;
+}
+
+/* ------------------------------------------------------------------------ */
+/* Persistence
+ *
+ * The file has one line per message, "<key> <seen>" in hex and decimal,
+ * least recently seen first.
+ */
+
+gboolean
+modem_sms_dedup_load (ModemSMSDedup *self,
+                      char const *path,
+                      GError **error)
+{
+  char *content, *line, *next;
+  gint64 now = (gint64)time (NULL);
+
+  if (!g_file_get_contents (path, &content, NULL, error))
+    return FALSE;
+
+  for (line = content; *line; line = next)
+    {
+      guint64 key;
+      gint64 seen;
+      char *end;
+
+      next = strchr (line, '\n');
+      if (next)
+        *next++ = '\0';
+      else
+        next = line + strlen (line);
+
+      key = g_ascii_strtoull (line, &end, 16);
+      if (end == line || *end != ' ')
+        continue;
+      seen = g_ascii_strtoll (end + 1, NULL, 10);
+
+      if (seen + self->window < now)
+        continue;
+      if (g_hash_table_lookup (self->index, &key))
+        continue;
+
+      modem_sms_dedup_add (self, key, seen);
+    }
+
+  g_free (content);
+
+  DEBUG ("loaded %u entries from %s", self->entries->length, path);
+
+  return TRUE;
+}
+
+/* Write @content to @path like g_file_set_contents() does, but create
+ * the file with mode 0600: the index tells when messages arrived */
+static gboolean
+modem_sms_dedup_write (char const *path,
+                       GString const *content,
+                       GError **error)
+{
+  char *tmp = g_strdup_printf ("%s.new", path);
+  gsize done;
+  int fd, saved;
+
+  fd = g_open (tmp, O_WRONLY | O_CREAT | O_EXCL, 0600);
+  if (fd < 0 && errno == EEXIST)
+    {
+      /* Left over by a crash during an earlier save */
+      g_unlink (tmp);
+      fd = g_open (tmp, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    }
+  if (fd < 0)
+    goto failed;
+
+  for (done = 0; done < content->len;)
+    {
+      gssize n = write (fd, content->str + done, content->len - done);
+
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        goto failed;
+      done += n;
+    }
+
+  if (fsync (fd) < 0)
+    goto failed;
+
+  if (close (fd) < 0)
+    {
+      fd = -1;
+      goto failed;
+    }
+  fd = -1;
+
+  if (g_rename (tmp, path) < 0)
+    goto failed;
+
+  g_free (tmp);
+  return TRUE;
+
+ failed:
+  saved = errno;
+  if (fd >= 0)
+    close (fd);
+  g_unlink (tmp);
+  g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved),
+      "%s: %s", tmp, g_strerror (saved));
+  g_free (tmp);
+  return FALSE;
+}
+
+gboolean
+modem_sms_dedup_save (ModemSMSDedup *self,
+                      char const *path,
+                      GError **error)
+{
+  GString *content = g_string_sized_new (32 * self->entries->length);
+  GList *link;
+  gboolean ok;
+
+  for (link = self->entries->head; link; link = link->next)
+    {
+      ModemSMSDedupEntry const *entry = link->data;
+
+      g_string_append_printf (content,
+          "%016" G_GINT64_MODIFIER "x %" G_GINT64_FORMAT "\n",
+          entry->key, entry->seen);
+    }
+
+  ok = modem_sms_dedup_write (path, content, error);
+
+  g_string_free (content, TRUE);
+
+  return ok;
+}
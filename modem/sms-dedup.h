@@ -0,0 +1,52 @@
+/*
+ * modem/sms-dedup.h - Index of received SMS for dropping duplicates
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _MODEM_SMS_DEDUP_H_
+#define _MODEM_SMS_DEDUP_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ModemSMSDedup ModemSMSDedup;
+
+ModemSMSDedup *modem_sms_dedup_new (guint max_entries, guint window);
+void modem_sms_dedup_free (ModemSMSDedup *self);
+
+guint64 modem_sms_dedup_key (char const *sender,
+    char const *sent_time,
+    char const *body);
+
+gboolean modem_sms_dedup_check (ModemSMSDedup *self,
+    guint64 key,
+    gint64 now);
+
+guint modem_sms_dedup_size (ModemSMSDedup const *self);
+
+gboolean modem_sms_dedup_load (ModemSMSDedup *self,
+    char const *path,
+    GError **error);
+gboolean modem_sms_dedup_save (ModemSMSDedup *self,
+    char const *path,
+    GError **error);
+
+G_END_DECLS
+
+#endif /* #ifndef _MODEM_SMS_DEDUP_H_*/
@@ -0,0 +1,276 @@
+/*
+ * modem/sms-reports.c - Matching status reports to sent SMS
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * A message sent with a status report request is remembered by the
+ * object path oFono gave it, until the final status report for it
+ * arrives. A report may identify the message only by its message
+ * reference (TP-MR); the reference is learned from the first report
+ * that carries both. Messages are dropped if no final report arrives
+ * within the time-to-live, or if they are the oldest ones when the
+ * table is full.
+ */
+
+#include "config.h"
+
+#define MODEM_DEBUG_FLAG MODEM_LOG_SMS
+
+#include "debug.h"
+
+#include "modem/sms-reports.h"
+
+#define N_REFERENCES (256)
+
+typedef struct {
+  char *path;
+  char *destination;
+  gint64 submitted;
+  gint reference;               /* TP-MR, -1 if not known */
+} ModemSMSReportsEntry;
+
+struct _ModemSMSReports
+{
+  /* Oldest first */
+  GQueue entries[1];
+  /* path => link in entries */
+  GHashTable *index;
+  /* TP-MR => link in entries */
+  GList *references[N_REFERENCES];
+  guint max_entries;
+  guint ttl;                    /* Seconds */
+  ModemSMSReportsStats stats;
+};
+
+ModemSMSReports *
+modem_sms_reports_new (guint max_entries,
+                       guint ttl)
+{
+  ModemSMSReports *self = g_slice_new0 (ModemSMSReports);
+
+  g_queue_init (self->entries);
+  self->index = g_hash_table_new (g_str_hash, g_str_equal);
+  self->max_entries = MAX (max_entries, 1);
+  self->ttl = ttl;
+
+  return self;
+}
+
+static void
+modem_sms_reports_entry_free (ModemSMSReportsEntry *entry)
+{
+  g_free (entry->path);
+  g_free (entry->destination);
+  g_slice_free (ModemSMSReportsEntry, entry);
+}
+
+void
+modem_sms_reports_free (ModemSMSReports *self)
+{
+  ModemSMSReportsEntry *entry;
+
+  if (self == NULL)
+    return;
+
+  g_hash_table_destroy (self->index);
+
+  while ((entry = g_queue_pop_head (self->entries)))
+    modem_sms_reports_entry_free (entry);
+
+  g_slice_free (ModemSMSReports, self);
+}
+
+static void
+modem_sms_reports_remove (ModemSMSReports *self,
+                          GList *link)
+{
+  ModemSMSReportsEntry *entry = link->data;
+
+  g_hash_table_remove (self->index, entry->path);
+
+  if (entry->reference >= 0 && self->references[entry->reference] == link)
+    self->references[entry->reference] = NULL;
+
+  g_queue_delete_link (self->entries, link);
+  modem_sms_reports_entry_free (entry);
+}
+
+/** Drop messages that have waited for a report longer than time-to-live.
+ *
+ * @return number of messages dropped
+ */
+guint
+modem_sms_reports_expire (ModemSMSReports *self,
+                          gint64 now)
+{
+  ModemSMSReportsEntry *entry;
+  guint n = 0;
+
+  while ((entry = g_queue_peek_head (self->entries)) &&
+      entry->submitted + self->ttl <= now)
+    {
+      DEBUG ("no status report for %s", entry->path);
+      modem_sms_reports_remove (self, self->entries->head);
+      n++;
+    }
+
+  self->stats.expired += n;
+
+  return n;
+}
+
+/** Remember a message sent to @a destination, known by its @a path. */
+void
+modem_sms_reports_add (ModemSMSReports *self,
+                       char const *path,
+                       char const *destination,
+                       gint64 now)
+{
+  ModemSMSReportsEntry *entry;
+  GList *link;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (path != NULL);
+  g_return_if_fail (destination != NULL);
+
+  modem_sms_reports_expire (self, now);
+
+  link = g_hash_table_lookup (self->index, path);
+  if (link)
+    modem_sms_reports_remove (self, link);
+
+  while (self->entries->length >= self->max_entries)
+    {
+      entry = g_queue_peek_head (self->entries);
+      modem_message (MODEM_LOG_SMS,
+          "dropping pending status report for %s (out of room)",
+          entry->path);
+      modem_sms_reports_remove (self, self->entries->head);
+      self->stats.evicted++;
+    }
+
+  entry = g_slice_new (ModemSMSReportsEntry);
+  entry->path = g_strdup (path);
+  entry->destination = g_strdup (destination);
+  entry->submitted = now;
+  entry->reference = -1;
+
+  g_queue_push_tail (self->entries, entry);
+  g_hash_table_insert (self->index, entry->path, self->entries->tail);
+}
+
+static guint
+modem_sms_reports_bucket (gint64 latency)
+{
+  if (latency <= 0)
+    return 0;
+
+  if (latency >= (G_GINT64_CONSTANT (1) << (MODEM_SMS_REPORTS_BUCKETS - 2)))
+    return MODEM_SMS_REPORTS_BUCKETS - 1;
+
+  return g_bit_storage ((gulong) latency);
+}
+
+/** Find the message a status report is about.
+ *
+ * The message is looked up by @a path, or if @a path is NULL, by the
+ * TP-MR @a reference. If the report is @a final, the message is
+ * forgotten and the time since it was sent is recorded.
+ *
+ * @retval TRUE if the message was found. The path and destination of
+ * the message are then returned; they should be freed with g_free().
+ */
+gboolean
+modem_sms_reports_match (ModemSMSReports *self,
+                         char const *path,
+                         gint reference,
+                         gboolean final,
+                         gint64 now,
+                         char **return_path,
+                         char **return_destination)
+{
+  ModemSMSReportsEntry *entry;
+  GList *link;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (return_path != NULL, FALSE);
+  g_return_val_if_fail (return_destination != NULL, FALSE);
+
+  modem_sms_reports_expire (self, now);
+
+  if (reference >= N_REFERENCES)
+    reference = -1;
+
+  if (path)
+    link = g_hash_table_lookup (self->index, path);
+  else if (reference >= 0)
+    link = self->references[reference];
+  else
+    link = NULL;
+
+  if (link == NULL)
+    {
+      DEBUG ("no message for status report (%s, %d)",
+          path ? path : "", reference);
+      self->stats.unmatched++;
+      return FALSE;
+    }
+
+  entry = link->data;
+
+  if (path && reference >= 0 && entry->reference != reference)
+    {
+      if (entry->reference >= 0 &&
+          self->references[entry->reference] == link)
+        self->references[entry->reference] = NULL;
+      entry->reference = reference;
+      self->references[reference] = link;
+    }
+
+  *return_path = g_strdup (entry->path);
+  *return_destination = g_strdup (entry->destination);
+
+  if (final)
+    {
+      self->stats.matched++;
+      self->stats.latency[modem_sms_reports_bucket (now - entry->submitted)]++;
+      modem_sms_reports_remove (self, link);
+    }
+  else
+    {
+      self->stats.temporary++;
+    }
+
+  return TRUE;
+}
+
+/** Return number of messages waiting for a status report. */
+guint
+modem_sms_reports_pending (ModemSMSReports const *self)
+{
+  return self->entries->length;
+}
+
+void
+modem_sms_reports_get_stats (ModemSMSReports const *self,
+                             ModemSMSReportsStats *return_stats)
+{
+  *return_stats = self->stats;
+  return_stats->pending = self->entries->length;
+}
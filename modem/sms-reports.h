@@ -0,0 +1,75 @@
+/*
+ * modem/sms-reports.h - Matching status reports to sent SMS
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _MODEM_SMS_REPORTS_H_
+#define _MODEM_SMS_REPORTS_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Number of latency buckets; bucket 0 counts reports received within a
+ * second, bucket i > 0 those within [2^(i-1), 2^i) seconds, and the last
+ * bucket everything slower */
+#define MODEM_SMS_REPORTS_BUCKETS (20)
+
+typedef struct _ModemSMSReports ModemSMSReports;
+
+typedef struct {
+  guint pending;                /* Messages waiting for a report */
+  guint matched;                /* Final reports matched to a message */
+  guint temporary;              /* Reports saying SMSC is still trying */
+  guint unmatched;              /* Reports for unknown messages */
+  guint expired;                /* Messages that got no report in time */
+  guint evicted;                /* Messages dropped to make room */
+  guint latency[MODEM_SMS_REPORTS_BUCKETS];
+} ModemSMSReportsStats;
+
+/* TP-Status, 3GPP TS 23.040 9.2.3.15 */
+#define MODEM_SMS_TP_ST_IS_COMPLETED(st) ((st) < 0x20)
+#define MODEM_SMS_TP_ST_IS_TRYING(st) (((st) & 0x60) == 0x20)
+#define MODEM_SMS_TP_ST_IS_PERMANENT(st) (((st) & 0x60) == 0x40)
+
+ModemSMSReports *modem_sms_reports_new (guint max_entries, guint ttl);
+void modem_sms_reports_free (ModemSMSReports *self);
+
+void modem_sms_reports_add (ModemSMSReports *self,
+    char const *path,
+    char const *destination,
+    gint64 now);
+
+gboolean modem_sms_reports_match (ModemSMSReports *self,
+    char const *path,
+    gint reference,
+    gboolean final,
+    gint64 now,
+    char **return_path,
+    char **return_destination);
+
+guint modem_sms_reports_expire (ModemSMSReports *self, gint64 now);
+
+guint modem_sms_reports_pending (ModemSMSReports const *self);
+
+void modem_sms_reports_get_stats (ModemSMSReports const *self,
+    ModemSMSReportsStats *return_stats);
+
+G_END_DECLS
+
+#endif /* #ifndef _MODEM_SMS_REPORTS_H_*/
@@ -27,6 +27,7 @@
 #include "debug.h"
 
 #include "modem/sms.h"
+#include "modem/sms-dedup.h"
 #include "modem/request-private.h"
 #include "modem/errors.h"
 
@@ -47,6 +48,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <assert.h>
 
 /* ---------------------------------------------------------------------- */
@@ -58,11 +60,11 @@ enum
 {
   SIGNAL_INCOMING_MESSAGE,
   SIGNAL_IMMEDIATE_MESSAGE,
+  SIGNAL_STATUS_REPORT,
 #if nomore
   SIGNAL_DELIVER,
   SIGNAL_OUTGOING_COMPLETE,
   SIGNAL_OUTGOING_ERROR,
-  SIGNAL_STATUS_REPORT,
 #endif
   N_SIGNALS
 };
@@ -77,9 +79,14 @@ enum
     PROP_SMSC,
     PROP_VALIDITY_PERIOD,
     PROP_REDUCED_CHARSET,
+    PROP_DEDUP_FILE,
     LAST_PROPERTY
   };
 
+/* Remember this many received messages for a week */
+#define MODEM_SMS_DEDUP_ENTRIES (256)
+#define MODEM_SMS_DEDUP_WINDOW (7 * 24 * 60 * 60)
+
 /* private data */
 struct _ModemSMSServicePrivate
 {
@@ -88,6 +95,10 @@ struct _ModemSMSServicePrivate
   char *smsc;
   guint validity_period;
 
+  ModemSMSDedup *dedup;
+  char *dedup_file;
+  guint dedup_save;             /* Timer for saving dedup_file */
+
 #if nomore
   char **content_types;
 
@@ -111,6 +122,10 @@ static void on_manager_message_added (DBusGProxy *, char const *, GHashTable *,
     gpointer);
 static void on_manager_message_removed (DBusGProxy *, char const *, gpointer);
 
+static void modem_sms_service_set_dedup_file (ModemSMSService *,
+    char const *path);
+static void modem_sms_service_save_dedup (ModemSMSService *);
+
 /* ------------------------------------------------------------------------ */
 /* GObject interface */
 
@@ -122,6 +137,9 @@ modem_sms_service_init (ModemSMSService *self)
   self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
       MODEM_TYPE_SMS_SERVICE, ModemSMSServicePrivate);
 
+  self->priv->dedup = modem_sms_dedup_new (MODEM_SMS_DEDUP_ENTRIES,
+      MODEM_SMS_DEDUP_WINDOW);
+
 #if nomore
   self->priv->received = g_hash_table_new_full (g_str_hash, g_str_equal,
       NULL, /* Message object stored in hash owns the key */
@@ -158,6 +176,10 @@ modem_sms_service_get_property (GObject *object,
       g_value_set_boolean (value, priv->reduced_charset);
       break;
 
+    case PROP_DEDUP_FILE:
+      g_value_set_string (value, priv->dedup_file);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -198,6 +220,10 @@ modem_sms_service_set_property (GObject *object,
       priv->reduced_charset = g_value_get_boolean (value);
       break;
 
+    case PROP_DEDUP_FILE:
+      modem_sms_service_set_dedup_file (self, g_value_get_string (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -232,6 +258,14 @@ modem_sms_service_finalize (GObject *object)
   /* Free any data held directly by the object here */
   g_free (priv->smsc);
 
+  if (priv->dedup_save)
+    {
+      g_source_remove (priv->dedup_save);
+      modem_sms_service_save_dedup (self);
+    }
+  modem_sms_dedup_free (priv->dedup);
+  g_free (priv->dedup_file);
+
 #if nomore
   if (priv->content_types)
     g_boxed_free (G_TYPE_STRV, priv->content_types);
@@ -441,15 +475,24 @@ modem_sms_service_class_init (ModemSMSServiceClass *klass)
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT |
           G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class, PROP_DEDUP_FILE,
+      g_param_spec_string ("dedup-file",
+          "Received message index file",
+          "File used to remember received messages over restarts, "
+          "so that duplicates can be dropped",
+          NULL, /* default value */
+          G_PARAM_READWRITE |
+          G_PARAM_STATIC_STRINGS));
+
   signals[SIGNAL_IMMEDIATE_MESSAGE] =
     g_signal_new ("immediate-message",
         G_OBJECT_CLASS_TYPE (klass),
         G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED,
         0,
         NULL, NULL,
-        _modem__marshal_VOID__STRING_BOXED,
+        _modem__marshal_VOID__STRING_POINTER,
         G_TYPE_NONE, 2,
-        G_TYPE_STRING, G_TYPE_HASH_TABLE);
+        G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE, G_TYPE_POINTER);
 
   signals[SIGNAL_INCOMING_MESSAGE] =
     g_signal_new ("incoming-message",
@@ -457,9 +500,19 @@ modem_sms_service_class_init (ModemSMSServiceClass *klass)
         G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED,
         0,
         NULL, NULL,
-        _modem__marshal_VOID__STRING_BOXED,
+        _modem__marshal_VOID__STRING_POINTER,
         G_TYPE_NONE, 2,
-        G_TYPE_STRING, G_TYPE_HASH_TABLE);
+        G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE, G_TYPE_POINTER);
+
+  signals[SIGNAL_STATUS_REPORT] =
+    g_signal_new ("status-report",
+        G_OBJECT_CLASS_TYPE (klass),
+        G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED,
+        0,
+        NULL, NULL,
+        _modem__marshal_VOID__STRING_INT_UINT,
+        G_TYPE_NONE, 3,
+        G_TYPE_STRING, G_TYPE_INT, G_TYPE_UINT);
 
 #if nomore
   signals[SIGNAL_DELIVER] =
@@ -492,16 +545,6 @@ modem_sms_service_class_init (ModemSMSServiceClass *klass)
         G_TYPE_NONE, 3,
         G_TYPE_STRING, G_TYPE_STRING, G_TYPE_POINTER);
 
-  signals[SIGNAL_STATUS_REPORT] =
-    g_signal_new ("state-report",
-        G_OBJECT_CLASS_TYPE (klass),
-        G_SIGNAL_RUN_LAST | G_SIGNAL_DETAILED,
-        0,
-        NULL, NULL,
-        g_cclosure_marshal_VOID__OBJECT,
-        G_TYPE_NONE, 1,
-        G_TYPE_OBJECT);
-
 #endif
 
   g_type_class_add_private (klass, sizeof (ModemSMSServicePrivate));
@@ -546,6 +589,15 @@ modem_sms_connect_to_immediate_message (ModemSMSService *self,
       G_CALLBACK (handler), data);
 }
 
+gulong
+modem_sms_connect_to_status_report (ModemSMSService *self,
+                                    ModemSMSStatusReportHandler *handler,
+                                    gpointer data)
+{
+  return g_signal_connect (self, "status-report",
+      G_CALLBACK (handler), data);
+}
+
 /* ------------------------------------------------------------------------- */
 /* modem_sms_service interface */
 
@@ -558,17 +610,125 @@ modem_sms_service_time_connected (ModemSMSService const *self)
     return 0;
 }
 
+static gboolean
+parse_digits (char const **s,
+              guint n,
+              int *value)
+{
+  char const *p = *s;
+  int v = 0;
+
+  for (; n > 0; n--, p++)
+    {
+      if (!g_ascii_isdigit (*p))
+        return FALSE;
+      v = v * 10 + (*p - '0');
+    }
+
+  *s = p, *value = v;
+
+  return TRUE;
+}
+
+/* Days since 1970-01-01 in proleptic Gregorian calendar */
+static gint64
+days_from_civil (int y,
+                 int m,
+                 int d)
+{
+  int era, yoe, doy, doe;
+
+  y -= m <= 2;
+  era = (y >= 0 ? y : y - 399) / 400;
+  yoe = y - era * 400;
+  doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+  return (gint64)era * 146097 + doe - 719468;
+}
+
+/** Convert oFono time stamp to seconds since epoch.
+ *
+ * oFono uses "YYYY-MM-DDTHH:MM:SS+HHMM". It is parsed by hand, as
+ * strptime() and mktime() are slow and mktime() ignores the offset.
+ *
+ * @retval 0 if time stamp can not be parsed
+ */
 gint64
 modem_sms_parse_time (gchar const *s)
 {
+  char const *p = s;
+  int year, mon, mday, hour, min, sec, tzh, tzm, sign;
   struct tm tm = { };
-  char *rest;
 
-  rest = strptime (s, "%Y-%m-%dT%H:%M:%S%z", &tm);
+  if (s == NULL)
+    return 0;
+
+  if (!(parse_digits (&p, 4, &year) && *p++ == '-' &&
+        parse_digits (&p, 2, &mon) && *p++ == '-' &&
+        parse_digits (&p, 2, &mday) && *p++ == 'T' &&
+        parse_digits (&p, 2, &hour) && *p++ == ':' &&
+        parse_digits (&p, 2, &min) && *p++ == ':' &&
+        parse_digits (&p, 2, &sec)))
+    goto fallback;
+
+  if (*p == 'Z' && p[1] == '\0')
+    sign = 0, tzh = tzm = 0;
+  else if (*p == '+' || *p == '-')
+    {
+      sign = *p++ == '-' ? -1 : 1;
+      if (!parse_digits (&p, 2, &tzh))
+        goto fallback;
+      if (*p == ':')
+        p++;
+      if (!parse_digits (&p, 2, &tzm) || *p != '\0')
+        goto fallback;
+    }
+  else
+    goto fallback;
+
+  if (mon < 1 || mon > 12 || mday < 1 || mday > 31 ||
+      hour > 23 || min > 59 || sec > 60)
+    goto fallback;
+
+  return days_from_civil (year, mon, mday) * 86400
+    + hour * 3600 + min * 60 + sec
+    - sign * (tzh * 3600 + tzm * 60);
+
+ fallback:
+  /* Without an offset the time is taken to be local */
+  if (strptime (s, "%Y-%m-%dT%H:%M:%S", &tm) == NULL)
+    return 0;
+
+  tm.tm_isdst = -1;
 
   return (gint64) mktime (&tm);
 }
 
+/** Parse information about an incoming message from oFono dict. */
+void
+modem_sms_parse_info (ModemSMSInfo *info,
+                      GHashTable *dict)
+{
+  GValue const *value;
+
+  memset (info, 0, sizeof *info);
+
+  info->dict = dict;
+  info->received = (gint64) time (NULL);
+
+  value = g_hash_table_lookup (dict, "Sender");
+  if (value && G_VALUE_HOLDS_STRING (value))
+    info->sender = g_value_get_string (value);
+
+  value = g_hash_table_lookup (dict, "SentTime");
+  if (value && G_VALUE_HOLDS_STRING (value))
+    {
+      info->sent_time = g_value_get_string (value);
+      info->sent = modem_sms_parse_time (info->sent_time);
+    }
+}
+
 
 /* ------------------------------------------------------------------------- */
 
@@ -782,6 +942,145 @@ modem_sms_incoming_status_report (ModemSMSService *self,
 }
 #endif
 
+/* ---------------------------------------------------------------------- */
+/* Dropping duplicates */
+
+static void
+modem_sms_service_set_dedup_file (ModemSMSService *self,
+                                  char const *path)
+{
+  ModemSMSServicePrivate *priv = self->priv;
+  GError *error = NULL;
+
+  if (!g_strcmp0 (path, priv->dedup_file))
+    return;
+
+  g_free (priv->dedup_file);
+  priv->dedup_file = g_strdup (path);
+
+  if (path == NULL)
+    return;
+
+  if (!modem_sms_dedup_load (priv->dedup, path, &error))
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        DEBUG ("%s", error->message);
+      g_error_free (error);
+    }
+}
+
+static void
+modem_sms_service_save_dedup (ModemSMSService *self)
+{
+  ModemSMSServicePrivate *priv = self->priv;
+  GError *error = NULL;
+
+  priv->dedup_save = 0;
+
+  if (priv->dedup_file &&
+      !modem_sms_dedup_save (priv->dedup, priv->dedup_file, &error))
+    {
+      DEBUG ("%s", error->message);
+      g_error_free (error);
+    }
+}
+
+static gboolean
+modem_sms_service_save_dedup_cb (gpointer _self)
+{
+  modem_sms_service_save_dedup (MODEM_SMS_SERVICE (_self));
+  return FALSE;
+}
+
+/* oFono does not give an object path for received messages, so they
+ * are identified by their sender, time stamp and text. Without a time
+ * stamp, a repeated short text like "OK" would look like a duplicate
+ * for the whole window, so such messages are not checked. */
+static gboolean
+modem_sms_is_duplicate (ModemSMSService *self,
+                        char const *message,
+                        ModemSMSInfo const *info)
+{
+  ModemSMSServicePrivate *priv = self->priv;
+  guint64 key;
+  gboolean duplicate;
+
+  if (info->sent_time == NULL || info->sent_time[0] == '\0')
+    return FALSE;
+
+  key = modem_sms_dedup_key (info->sender, info->sent_time, message);
+
+  duplicate = modem_sms_dedup_check (priv->dedup, key, info->received);
+
+  if (duplicate)
+    modem_message (MODEM_LOG_SMS, "dropping duplicate of message %016"
+        G_GINT64_MODIFIER "x", key);
+
+  /* A duplicate is seen again, too, and moves in the index */
+  if (priv->dedup_file && !priv->dedup_save)
+    priv->dedup_save = g_timeout_add_seconds (1,
+        modem_sms_service_save_dedup_cb, self);
+
+  return duplicate;
+}
+
+/* The message and dict are passed on as they came from D-Bus, without
+ * copying; the signals use static scope for the message text. */
+static void
+modem_sms_emit_message (ModemSMSService *self,
+                        guint signal,
+                        char const *message,
+                        GHashTable *dict)
+{
+  ModemSMSInfo info[1];
+
+  if (DEBUGGING)
+    {
+      DEBUG ("%s = \"%.50s\"%s",
+          signal == SIGNAL_IMMEDIATE_MESSAGE ? "immediate" : "incoming",
+          message, strlen (message) > 50 ? "..." : "");
+      dump_message_dict (dict);
+    }
+
+  modem_sms_parse_info (info, dict);
+
+  if (modem_sms_is_duplicate (self, message, info))
+    return;
+
+  g_signal_emit (self, signals[signal], 0, message, info);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Status reports */
+
+/** Receive a status report.
+ *
+ * This is for modems that give the SMS-STATUS-REPORTs to us. The sent
+ * message is identified by its @a message_path, if known, and by its
+ * message reference (TP-MR), or -1 if not known. The @a status is the
+ * TP-Status from the report.
+ */
+void
+modem_sms_receive_status_report (ModemSMSService *self,
+                                 char const *message_path,
+                                 gint reference,
+                                 guint8 status)
+{
+  g_return_if_fail (MODEM_IS_SMS_SERVICE (self));
+  g_return_if_fail (message_path != NULL || reference >= 0);
+
+  if (!self->priv->connected)
+    return;
+
+  DEBUG ("status report 0x%02x for %s (reference %d)", status,
+      message_path ? message_path : "unknown message", reference);
+
+  g_signal_emit (self, signals[SIGNAL_STATUS_REPORT], 0,
+      message_path, reference, (guint) status);
+}
+
+/* ---------------------------------------------------------------------- */
+
 static void
 on_immediate_message (DBusGProxy *proxy,
                       char const *message,
@@ -789,16 +1088,9 @@ on_immediate_message (DBusGProxy *proxy,
                       gpointer _self)
 {
   ModemSMSService *self = MODEM_SMS_SERVICE (_self);
-  ModemSMSServicePrivate *priv = self->priv;
 
-  if (!priv->connected)
-    return;
-
-  DEBUG ("immediate = \"%50s\"%s", message, strlen (message) > 50 ? "..." : "");
-  dump_message_dict (dict);
-
-  g_signal_emit (self, signals[SIGNAL_IMMEDIATE_MESSAGE], 0,
-      message, dict);
+  if (self->priv->connected)
+    modem_sms_emit_message (self, SIGNAL_IMMEDIATE_MESSAGE, message, dict);
 }
 
 static void
@@ -808,16 +1100,9 @@ on_incoming_message (DBusGProxy *proxy,
                      gpointer _self)
 {
   ModemSMSService *self = MODEM_SMS_SERVICE (_self);
-  ModemSMSServicePrivate *priv = self->priv;
-
-  if (!priv->connected)
-    return;
-
-  DEBUG ("incoming = \"%50s\"%s", message, strlen (message) > 50 ? "..." : "");
-  dump_message_dict (dict);
 
-  g_signal_emit (self, signals[SIGNAL_INCOMING_MESSAGE], 0,
-      message, dict);
+  if (self->priv->connected)
+    modem_sms_emit_message (self, SIGNAL_INCOMING_MESSAGE, message, dict);
 }
 
 
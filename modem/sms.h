@@ -76,9 +76,30 @@ typedef void ModemSMSDeliverHandler (ModemSMSService *,
     SMSGDeliver *, gpointer);
 #endif
 
+/* Incoming message information, parsed once from the oFono dict. The
+ * strings point into the dict and are valid during the signal emission. */
+typedef struct _ModemSMSInfo ModemSMSInfo;
+
+struct _ModemSMSInfo
+{
+  char const *sender;
+  char const *sent_time;        /* As given by oFono */
+  gint64 sent;                  /* Zero if not known */
+  gint64 received;
+  GHashTable *dict;
+};
+
 typedef void ModemSMSMessageHandler (ModemSMSService *self,
     gchar const *message,
-    GHashTable *info,
+    ModemSMSInfo const *info,
+    gpointer user_data);
+
+/* Status report for a sent message; @a message_path is NULL and
+ * @a reference -1 if not known, @a status is the TP-Status */
+typedef void ModemSMSStatusReportHandler (ModemSMSService *self,
+    gchar const *message_path,
+    gint reference,
+    guint status,
     gpointer user_data);
 
 typedef void ModemSMSServiceReply (ModemSMSService *self,
@@ -114,10 +135,16 @@ gulong modem_sms_connect_to_immediate_message (ModemSMSService *self,
     ModemSMSMessageHandler *handler,
     gpointer data);
 
+gulong modem_sms_connect_to_status_report (ModemSMSService *self,
+    ModemSMSStatusReportHandler *handler,
+    gpointer data);
+
 guint64 modem_sms_service_time_connected (ModemSMSService const *self);
 
 gint64 modem_sms_parse_time (gchar const *);
 
+void modem_sms_parse_info (ModemSMSInfo *info, GHashTable *dict);
+
 /* ---------------------------------------------------------------------- */
 
 ModemRequest *modem_sms_set_sc_address (ModemSMSService *self,
@@ -130,6 +157,11 @@ ModemRequest *modem_sms_set_srr (ModemSMSService *self,
     ModemSMSServiceReply *reply,
     gpointer user_data);
 
+void modem_sms_receive_status_report (ModemSMSService *self,
+    char const *message_path,
+    gint reference,
+    guint8 status);
+
 ModemRequest *modem_sms_request_send (ModemSMSService *self,
   char const *to, char const *message,
   ModemSMSServiceSendReply *reply,
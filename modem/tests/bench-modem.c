@@ -0,0 +1,607 @@
+/*
+ * bench-modem.c - Benchmark modem library hot paths against fake oFono
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Run with "make bench", which starts fake-ofono.py on a private bus.
+ *
+ * Each scenario is run twice. First the operations are done one at a
+ * time and the latency of each is recorded. Then a burst of operations
+ * is run and the process CPU time and the number of memory allocations
+ * spent on it are measured. The throughput is reported per CPU second,
+ * so it does not depend on how fast the fake oFono can emit signals.
+ *
+ * Some hot paths are also measured in-process, without D-Bus, to show
+ * their cost per operation.
+ *
+ * The number of D-Bus match rules the process has added is reported
+ * after startup and with a call present.
+ */
+
+#include "config.h"
+
+#include <modem/service.h>
+#include <modem/modem.h>
+#include <modem/call.h>
+#include <modem/chars.h>
+#include <modem/sms.h>
+#include <modem/sms-codec.h>
+#include <modem/sms-reports.h>
+#include <modem/ofono.h>
+
+#include <dbus/dbus-glib.h>
+#include <dbus/dbus.h>
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_TIMEOUT (20 * G_USEC_PER_SEC)
+
+static GMainLoop *mainloop;
+static DBusGProxy *control;
+
+static guint expected, received;
+
+/* ---------------------------------------------------------------------- */
+/* Allocation counting
+ *
+ * g_mem_set_vtable() does nothing since GLib 2.46, and would miss the
+ * allocations made by libdbus and libc anyway. Instead, malloc(),
+ * calloc() and realloc() are defined here, which replaces them for the
+ * whole process, and the glibc implementations are called from them. */
+
+extern void *__libc_malloc (size_t n);
+extern void *__libc_calloc (size_t n_blocks, size_t n_block_bytes);
+extern void *__libc_realloc (void *mem, size_t n);
+
+static volatile gint n_allocs;
+
+void *
+malloc (size_t n)
+{
+  g_atomic_int_inc (&n_allocs);
+  return __libc_malloc (n);
+}
+
+void *
+calloc (size_t n_blocks, size_t n_block_bytes)
+{
+  g_atomic_int_inc (&n_allocs);
+  return __libc_calloc (n_blocks, n_block_bytes);
+}
+
+void *
+realloc (void *mem, size_t n)
+{
+  if (mem == NULL)
+    g_atomic_int_inc (&n_allocs);
+  return __libc_realloc (mem, n);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Match rule counting
+ *
+ * These replace the libdbus functions for the whole process, so the
+ * rules added by dbus-glib for each DBusGProxy are counted along with
+ * the ones added by the modem library. */
+
+static gint n_match_rules;
+
+void
+dbus_bus_add_match (DBusConnection *connection,
+                    char const *rule,
+                    DBusError *error)
+{
+  static void (*add_match) (DBusConnection *, char const *, DBusError *);
+
+  if (add_match == NULL)
+    add_match = dlsym (RTLD_NEXT, "dbus_bus_add_match");
+
+  add_match (connection, rule, error);
+
+  if (error == NULL || !dbus_error_is_set (error))
+    n_match_rules++;
+}
+
+void
+dbus_bus_remove_match (DBusConnection *connection,
+                       char const *rule,
+                       DBusError *error)
+{
+  static void (*remove_match) (DBusConnection *, char const *, DBusError *);
+
+  if (remove_match == NULL)
+    remove_match = dlsym (RTLD_NEXT, "dbus_bus_remove_match");
+
+  remove_match (connection, rule, error);
+
+  if (error == NULL || !dbus_error_is_set (error))
+    n_match_rules--;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static gint64
+cpu_time (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+  return (gint64)ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static void
+received_one (void)
+{
+  if (++received == expected)
+    g_main_loop_quit (mainloop);
+}
+
+static gboolean
+bench_timeout (gpointer dummy)
+{
+  g_main_loop_quit (mainloop);
+  return FALSE;
+}
+
+/* Run main loop until expected number of operations has completed */
+static gboolean
+bench_wait (void)
+{
+  guint timer;
+
+  if (received < expected)
+    {
+      timer = g_timeout_add (BENCH_TIMEOUT / 1000, bench_timeout, NULL);
+      g_main_loop_run (mainloop);
+      g_source_remove (timer);
+    }
+
+  return received >= expected;
+}
+
+static void
+emit (char const *kind, guint count)
+{
+  dbus_g_proxy_call_no_reply (control, "Emit",
+      G_TYPE_STRING, kind,
+      G_TYPE_UINT, count,
+      G_TYPE_INVALID);
+}
+
+static gint
+compare_gint64 (gconstpointer a, gconstpointer b)
+{
+  gint64 const *x = a, *y = b;
+
+  return *x < *y ? -1 : *x > *y;
+}
+
+typedef void BenchStart (guint count);
+
+static void
+bench_run (char const *name,
+           BenchStart *start,
+           guint n_samples,
+           guint n_burst)
+{
+  GArray *samples = g_array_sized_new (FALSE, FALSE, sizeof (gint64),
+      n_samples);
+  gint64 t0, cpu;
+  gint allocs;
+  guint i;
+
+  /* Warm up caches and free lists */
+  received = 0, expected = 10;
+  start (10);
+  if (!bench_wait ())
+    goto timeout;
+
+  for (i = 0; i < n_samples; i++)
+    {
+      gint64 t;
+
+      received = 0, expected = 1;
+      t0 = g_get_monotonic_time ();
+      start (1);
+      if (!bench_wait ())
+        goto timeout;
+      t = g_get_monotonic_time () - t0;
+      g_array_append_val (samples, t);
+    }
+
+  g_array_sort (samples, compare_gint64);
+
+  received = 0, expected = n_burst;
+  allocs = g_atomic_int_get (&n_allocs);
+  cpu = cpu_time ();
+  start (n_burst);
+  if (!bench_wait ())
+    goto timeout;
+  cpu = cpu_time () - cpu;
+  allocs = g_atomic_int_get (&n_allocs) - allocs;
+
+  printf ("%-12s %10.0f ops/cpu-s  p50 %6" G_GINT64_FORMAT " us"
+      "  p99 %6" G_GINT64_FORMAT " us  %6.1f allocs/op\n",
+      name,
+      cpu > 0 ? n_burst * (double)G_USEC_PER_SEC / cpu : 0.0,
+      g_array_index (samples, gint64, samples->len / 2),
+      g_array_index (samples, gint64, samples->len * 99 / 100),
+      (double)allocs / n_burst);
+
+  g_array_free (samples, TRUE);
+  return;
+
+ timeout:
+  printf ("%-12s timed out (%u of %u)\n", name, received, expected);
+  g_array_free (samples, TRUE);
+}
+
+/* In-process loop, reporting CPU time and allocations per operation */
+static void
+bench_loop (char const *name,
+            void (*func) (gpointer),
+            gpointer data,
+            guint n)
+{
+  gint64 cpu;
+  gint allocs;
+  guint i;
+
+  for (i = 0; i < 100; i++)
+    func (data);
+
+  allocs = g_atomic_int_get (&n_allocs);
+  cpu = cpu_time ();
+  for (i = 0; i < n; i++)
+    func (data);
+  cpu = cpu_time () - cpu;
+  allocs = g_atomic_int_get (&n_allocs) - allocs;
+
+  printf ("%-12s %10.0f ops/cpu-s  %8.0f ns/op  %6.1f allocs/op\n",
+      name,
+      cpu > 0 ? n * (double)G_USEC_PER_SEC / cpu : 0.0,
+      cpu * 1000.0 / n,
+      (double)allocs / n);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Scenarios */
+
+static void
+on_properties_updated (gpointer object, char const * const *names,
+    gpointer dummy)
+{
+  received_one ();
+}
+
+static void
+start_property_storm (guint count)
+{
+  emit ("property", count);
+}
+
+static void
+on_incoming_call (ModemCallService *service, ModemCall *ci,
+    char const *remote, gpointer dummy)
+{
+  received_one ();
+}
+
+static void
+start_call_churn (guint count)
+{
+  emit ("call", count);
+}
+
+static void
+on_incoming_message (ModemSMSService *sms, char const *message,
+    ModemSMSInfo const *info, gpointer dummy)
+{
+  received_one ();
+}
+
+/* Info dict of an incoming message, as oFono sends it */
+static GHashTable *
+sms_info_dict (void)
+{
+  GHashTable *dict = g_hash_table_new_full (g_str_hash, g_str_equal,
+      NULL, (GDestroyNotify) g_boxed_free);
+  char const * const keys[] = { "Sender", "SentTime", "LocalSentTime" };
+  char const * const values[] = {
+    "+358401234567", "2011-01-01T12:00:00+0200", "2011-01-01T12:00:00+0200"
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (keys); i++)
+    {
+      GValue value = { 0 };
+
+      g_value_init (&value, G_TYPE_STRING);
+      g_value_set_static_string (&value, values[i]);
+      g_hash_table_insert (dict, (gpointer) keys[i],
+          g_boxed_copy (G_TYPE_VALUE, &value));
+      g_value_unset (&value);
+    }
+
+  return dict;
+}
+
+static void
+loop_sms_info (gpointer dict)
+{
+  ModemSMSInfo info[1];
+
+  modem_sms_parse_info (info, dict);
+}
+
+/* What every incoming message used to cost with debugging disabled */
+static void
+loop_sms_dump (gpointer dict)
+{
+  GHashTableIter iter[1];
+  gpointer key, value;
+
+  g_hash_table_iter_init (iter, dict);
+  while (g_hash_table_iter_next (iter, &key, &value))
+    g_free (g_strdup_value_contents (value));
+}
+
+static void
+bench_sms_info (guint n)
+{
+  GHashTable *dict = sms_info_dict ();
+
+  bench_loop ("sms-info", loop_sms_info, dict, n);
+  bench_loop ("sms-dump", loop_sms_dump, dict, n);
+
+  g_hash_table_destroy (dict);
+}
+
+/* Typical outgoing messages: plain ASCII, and Cyrillic needing UCS-2 */
+static char const sms_text_ascii[] =
+  "Hi! The meeting moved to 3pm, room B2. Bring the slides and the "
+  "printouts, see you there. Call me at +358401234567 if you are late.";
+static char const sms_text_ucs2[] =
+  "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82! "
+  "\xd0\x92\xd1\x81\xd1\x82\xd1\x80\xd0\xb5\xd1\x87\xd0\xb0 "
+  "\xd0\xb2 3 \xd1\x87\xd0\xb0\xd1\x81\xd0\xb0, "
+  "\xd0\xba\xd0\xbe\xd0\xbc\xd0\xbd\xd0\xb0\xd1\x82\xd0\xb0 B2.";
+
+static void
+loop_sms_length (gpointer text)
+{
+  ModemSMSLength length[1];
+
+  modem_sms_length (text, length);
+}
+
+static void
+loop_gsm7_encode (gpointer text)
+{
+  gsize length;
+
+  g_free (modem_sms_gsm7_encode (text, &length));
+}
+
+static void
+loop_gsm7_pack (gpointer text)
+{
+  guint8 packed[sizeof sms_text_ascii];
+
+  modem_sms_gsm7_pack (text, sizeof sms_text_ascii - 1, packed);
+}
+
+static void
+bench_sms_codec (guint n)
+{
+  bench_loop ("gsm7-length", loop_sms_length, (gpointer) sms_text_ascii, n);
+  bench_loop ("gsm7-encode", loop_gsm7_encode, (gpointer) sms_text_ascii, n);
+  bench_loop ("gsm7-pack", loop_gsm7_pack, (gpointer) sms_text_ascii, n);
+  bench_loop ("ucs2-length", loop_sms_length, (gpointer) sms_text_ucs2, n);
+}
+
+/* Status report for each sent message, with 64 messages pending */
+static void
+loop_sms_report (gpointer reports)
+{
+  static guint serial;
+  char path[64], *token, *destination;
+
+  g_snprintf (path, sizeof path, "/phonesim/message_%u", serial);
+  modem_sms_reports_add (reports, path, "+358401234567", 0);
+
+  g_snprintf (path, sizeof path, "/phonesim/message_%u", serial - 64);
+  if (modem_sms_reports_match (reports, path, (serial - 64) & 0xff, TRUE,
+          0, &token, &destination))
+    g_free (token), g_free (destination);
+
+  serial++;
+}
+
+static void
+bench_sms_reports (guint n)
+{
+  ModemSMSReports *reports = modem_sms_reports_new (512, 3600);
+
+  bench_loop ("sms-report", loop_sms_report, reports, n);
+
+  modem_sms_reports_free (reports);
+}
+
+/* A mix of addresses dialed, two of them not valid */
+static char const * const dial_addresses[] = {
+  "+358718008000", "*31#+358718008000", "0401234567p1234#",
+  "urn:service:sos", "+35871800800012345678901", "112",
+};
+
+static void
+loop_address_parse (gpointer dummy)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (dial_addresses); i++)
+    modem_address_parse (dial_addresses[i], NULL);
+}
+
+static void
+bench_addresses (guint n)
+{
+  bench_loop ("address-mix", loop_address_parse, NULL, n);
+}
+
+static void
+start_sms_flood (guint count)
+{
+  emit ("sms", count);
+}
+
+static ModemCall *active_call;
+
+static void
+reply_to_send_tones (ModemCall *ci, ModemRequest *request, GError *error,
+    gpointer dummy)
+{
+  received_one ();
+}
+
+static void
+start_send_tones (guint count)
+{
+  guint i;
+
+  for (i = 0; i < count; i++)
+    modem_call_send_dtmf (active_call, "1", reply_to_send_tones, NULL);
+}
+
+static void
+on_created_call (ModemCallService *service, ModemCall *ci,
+    char const *remote, gpointer dummy)
+{
+  active_call = ci;
+  received_one ();
+}
+
+/* ---------------------------------------------------------------------- */
+
+static gboolean
+check_modem_ready (gpointer _service)
+{
+  Modem *modem = modem_service_find_by_path (_service, "/bench");
+
+  if (modem && modem_is_ready (modem))
+    {
+      g_main_loop_quit (mainloop);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  ModemService *service;
+  Modem *modem;
+  ModemCallService *calls;
+  ModemSMSService *sms;
+  guint n_burst = 10000, n_samples = 1000;
+  guint timer;
+
+  if (argc > 1)
+    n_burst = strtoul (argv[1], NULL, 0);
+  if (n_burst < 100)
+    n_burst = 100;
+  if (n_samples > n_burst)
+    n_samples = n_burst;
+
+  g_type_init ();
+
+  bench_sms_info (10 * n_burst);
+  bench_sms_codec (10 * n_burst);
+  bench_sms_reports (10 * n_burst);
+  bench_addresses (10 * n_burst);
+
+  mainloop = g_main_loop_new (NULL, FALSE);
+
+  control = dbus_g_proxy_new_for_name (dbus_g_bus_get (DBUS_BUS_SYSTEM, NULL),
+      OFONO_BUS_NAME, "/", "org.ofono.Bench");
+
+  service = modem_service ();
+  modem_service_refresh (service);
+
+  timer = g_timeout_add (100, check_modem_ready, service);
+  g_main_loop_run (mainloop);
+  g_source_remove (timer);
+
+  modem = modem_service_find_by_path (service, "/bench");
+  if (modem == NULL || !modem_is_ready (modem))
+    {
+      fprintf (stderr, "bench-modem: fake oFono modem did not show up\n");
+      return 1;
+    }
+
+  printf ("modem startup %" G_GUINT64_FORMAT " us\n",
+      modem_get_startup_time (modem));
+  printf ("match rules  %d after startup\n", n_match_rules);
+
+  calls = (ModemCallService *)
+    modem_get_interface (modem, MODEM_OFACE_CALL_MANAGER);
+  sms = (ModemSMSService *) modem_get_interface (modem, MODEM_OFACE_SMS);
+
+  g_signal_connect (modem, "properties-updated",
+      G_CALLBACK (on_properties_updated), NULL);
+  bench_run ("property", start_property_storm, n_samples, n_burst);
+  g_signal_handlers_disconnect_by_func (modem, on_properties_updated, NULL);
+
+  if (calls)
+    {
+      g_signal_connect (calls, "incoming",
+          G_CALLBACK (on_incoming_call), NULL);
+      bench_run ("call-churn", start_call_churn, n_samples, n_burst);
+      g_signal_handlers_disconnect_by_func (calls, on_incoming_call, NULL);
+
+      g_signal_connect (calls, "created",
+          G_CALLBACK (on_created_call), NULL);
+      received = 0, expected = 1;
+      emit ("active-call", 1);
+      bench_wait ();
+      g_signal_handlers_disconnect_by_func (calls, on_created_call, NULL);
+
+      /* dbus-glib adds a rule for the DBusGProxy of each call */
+      printf ("match rules  %d with one call\n", n_match_rules);
+
+      if (active_call)
+        bench_run ("send-tones", start_send_tones, n_samples, n_burst);
+    }
+
+  if (sms)
+    {
+      g_signal_connect (sms, "incoming-message",
+          G_CALLBACK (on_incoming_message), NULL);
+      bench_run ("sms-flood", start_sms_flood, n_samples, n_burst);
+      g_signal_handlers_disconnect_by_func (sms, on_incoming_message, NULL);
+    }
+
+  return 0;
+}
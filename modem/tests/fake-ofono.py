@@ -0,0 +1,228 @@
+#!/usr/bin/env python
+#
+# fake-ofono.py - scripted oFono for benchmarking the modem library
+#
+# Copyright (C) 2011 Nokia Corporation
+#
+# This work is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This work is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this work; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+"""Fake oFono with a single modem at /bench.
+
+The modem has VoiceCallManager and MessageManager interfaces. Signal
+bursts are triggered through the org.ofono.Bench interface on "/":
+
+  Emit(s kind, u count)
+     kind is "property" (Modem PropertyChanged), "call" (CallAdded
+     followed by CallRemoved), "sms" (IncomingMessage) or "active-call"
+     (a single CallAdded of an active call at /bench/active).
+
+The fake runs on the bus given in DBUS_SYSTEM_BUS_ADDRESS.
+"""
+
+import sys
+
+import dbus
+import dbus.service
+from dbus.mainloop.glib import DBusGMainLoop
+
+try:
+    from gi.repository import GLib as gobject
+except ImportError:
+    import gobject
+
+OFONO = 'org.ofono'
+MODEM_PATH = '/bench'
+
+MANAGER = 'org.ofono.Manager'
+MODEM = 'org.ofono.Modem'
+CALL_MANAGER = 'org.ofono.VoiceCallManager'
+SMS = 'org.ofono.MessageManager'
+BENCH = 'org.ofono.Bench'
+
+
+def modem_properties():
+    return dbus.Dictionary({
+        'Powered': dbus.Boolean(True),
+        'Online': dbus.Boolean(True),
+        'Name': dbus.String('Bench'),
+        'Manufacturer': dbus.String('Fake'),
+        'Model': dbus.String('Bench'),
+        'Revision': dbus.String('1'),
+        'Serial': dbus.String('123456789012345'),
+        'Features': dbus.Array(['sms'], signature='s'),
+        'Interfaces': dbus.Array([CALL_MANAGER, SMS], signature='s'),
+        }, signature='sv')
+
+
+class Manager(dbus.service.Object):
+    @dbus.service.method(MANAGER, in_signature='', out_signature='a(oa{sv})')
+    def GetModems(self):
+        return [(dbus.ObjectPath(MODEM_PATH), modem_properties())]
+
+    @dbus.service.signal(MANAGER, signature='oa{sv}')
+    def ModemAdded(self, path, properties):
+        pass
+
+    @dbus.service.signal(MANAGER, signature='o')
+    def ModemRemoved(self, path):
+        pass
+
+
+class Modem(dbus.service.Object):
+    online = True
+
+    @dbus.service.method(MODEM, in_signature='', out_signature='a{sv}')
+    def GetProperties(self):
+        return modem_properties()
+
+    @dbus.service.method(MODEM, in_signature='sv', out_signature='')
+    def SetProperty(self, name, value):
+        pass
+
+    @dbus.service.signal(MODEM, signature='sv')
+    def PropertyChanged(self, name, value):
+        pass
+
+    def toggle_online(self):
+        self.online = not self.online
+        self.PropertyChanged('Online', dbus.Boolean(self.online))
+
+
+class CallManager(dbus.service.Object):
+    serial = 0
+
+    @dbus.service.method(CALL_MANAGER, in_signature='', out_signature='a{sv}')
+    def GetProperties(self):
+        return dbus.Dictionary({
+            'EmergencyNumbers': dbus.Array(['112', '911'], signature='s'),
+            }, signature='sv')
+
+    @dbus.service.method(CALL_MANAGER, in_signature='',
+                         out_signature='a(oa{sv})')
+    def GetCalls(self):
+        return dbus.Array([], signature='(oa{sv})')
+
+    @dbus.service.method(CALL_MANAGER, in_signature='s', out_signature='')
+    def SendTones(self, tones):
+        pass
+
+    @dbus.service.method(CALL_MANAGER, in_signature='', out_signature='')
+    def StopTones(self):
+        pass
+
+    @dbus.service.signal(CALL_MANAGER, signature='oa{sv}')
+    def CallAdded(self, path, properties):
+        pass
+
+    @dbus.service.signal(CALL_MANAGER, signature='o')
+    def CallRemoved(self, path):
+        pass
+
+    def add_call(self, path, state):
+        self.CallAdded(dbus.ObjectPath(path), dbus.Dictionary({
+            'LineIdentification': dbus.String('+358401234567'),
+            'State': dbus.String(state),
+            'Multiparty': dbus.Boolean(False),
+            }, signature='sv'))
+
+    def churn(self):
+        self.serial += 1
+        path = '%s/voicecall%u' % (MODEM_PATH, self.serial)
+        self.add_call(path, 'incoming')
+        self.CallRemoved(dbus.ObjectPath(path))
+
+
+class MessageManager(dbus.service.Object):
+    @dbus.service.method(SMS, in_signature='', out_signature='a{sv}')
+    def GetProperties(self):
+        return dbus.Dictionary({
+            'ServiceCenterAddress': dbus.String('+358401111111'),
+            'UseDeliveryReports': dbus.Boolean(False),
+            'Bearer': dbus.String('cs-preferred'),
+            'Alphabet': dbus.String('default'),
+            }, signature='sv')
+
+    @dbus.service.method(SMS, in_signature='', out_signature='a(oa{sv})')
+    def GetMessages(self):
+        return dbus.Array([], signature='(oa{sv})')
+
+    @dbus.service.signal(SMS, signature='sa{sv}')
+    def IncomingMessage(self, message, info):
+        pass
+
+    @dbus.service.signal(SMS, signature='sa{sv}')
+    def ImmediateMessage(self, message, info):
+        pass
+
+    serial = 0
+
+    def incoming(self):
+        # Each message differs so that none is dropped as a duplicate
+        self.serial += 1
+        self.IncomingMessage('Benchmark message %u' % self.serial,
+                             dbus.Dictionary({
+                'Sender': dbus.String('+358401234567'),
+                'SentTime': dbus.String('2011-01-01T12:00:00+0200'),
+                'LocalSentTime': dbus.String('2011-01-01T12:00:00+0200'),
+                }, signature='sv'))
+
+
+class Bench(dbus.service.Object):
+    def __init__(self, bus, modem, calls, sms):
+        dbus.service.Object.__init__(self, bus, '/')
+        self.kinds = {
+            'property': modem.toggle_online,
+            'call': calls.churn,
+            'sms': sms.incoming,
+            'active-call': lambda: calls.add_call(MODEM_PATH + '/active',
+                                                  'active'),
+            }
+
+    @dbus.service.method(BENCH, in_signature='su', out_signature='')
+    def Emit(self, kind, count):
+        emit = self.kinds[kind]
+        for i in range(count):
+            emit()
+
+
+class Root(Manager, Bench):
+    def __init__(self, bus, modem, calls, sms):
+        Bench.__init__(self, bus, modem, calls, sms)
+
+
+def main():
+    DBusGMainLoop(set_as_default=True)
+
+    bus = dbus.SystemBus()
+
+    # All modem interfaces share the object path, so register a single
+    # object implementing them all. dbus-python looks up the method by
+    # interface through the MRO, so each GetProperties gets dispatched
+    # to the right base class.
+    class ModemObject(Modem, CallManager, MessageManager):
+        pass
+
+    modem = ModemObject(bus, MODEM_PATH)
+    Root(bus, modem, modem, modem)
+
+    bus.request_name(OFONO)
+
+    sys.stdout.write('fake oFono ready\n')
+    sys.stdout.flush()
+
+    gobject.MainLoop().run()
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,33 @@
+#!/bin/sh
+#
+# run-bench.sh - run bench-modem against fake oFono
+#
+# Run from with-session-bus.sh, the session bus is used as the system
+# bus for both the fake oFono and the benchmark.
+#
+
+set -e
+
+srcdir=${srcdir:-.}
+PYTHON=${PYTHON:-python}
+
+DBUS_SYSTEM_BUS_ADDRESS="$DBUS_SESSION_BUS_ADDRESS"
+export DBUS_SYSTEM_BUS_ADDRESS
+
+$PYTHON $srcdir/fake-ofono.py > fake-ofono.log 2>&1 &
+fake=$!
+trap 'kill $fake 2>/dev/null || :' EXIT
+
+i=0
+until grep -q ready fake-ofono.log; do
+  i=`expr $i + 1`
+  if test $i -gt 100 || ! kill -0 $fake 2>/dev/null; then
+    echo "run-bench: fake oFono did not start" >&2
+    cat fake-ofono.log >&2
+    exit 1
+  fi
+  sleep 0.1
+done
+
+# Route GSlice allocations through malloc so that they are counted
+G_SLICE=always-malloc ./bench-modem "$@"
@@ -0,0 +1,183 @@
+/*
+ * test-modem-call-events.c - Test cases for call state transition log
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or(at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "modem/call.h"
+#include "modem/call-events.h"
+
+#include "test-modem.h"
+
+#include <string.h>
+
+#define CALL1 "/phonesim/voicecall01"
+#define CALL2 "/phonesim/voicecall02"
+
+#define MS (1000)
+
+static void
+collect(ModemCallEvent const *event, gpointer user_data)
+{
+  g_ptr_array_add(user_data, (gpointer) event);
+}
+
+START_TEST(test_call_events_outgoing)
+{
+  ModemCallEvents *events = modem_call_events_new(16);
+  ModemCallEventsStats stats[1];
+  GPtrArray *log = g_ptr_array_new();
+  ModemCallEvent const *e;
+
+  modem_call_events_log(events, CALL1, MODEM_CALL_STATE_DIALING, 0, 0,
+      1000 * MS);
+  modem_call_events_log(events, CALL1, MODEM_CALL_STATE_ALERTING, 0, 0,
+      3500 * MS);
+  /* Same state again is not logged */
+  modem_call_events_log(events, CALL1, MODEM_CALL_STATE_ALERTING, 0, 0,
+      3600 * MS);
+  modem_call_events_log(events, CALL1, MODEM_CALL_STATE_ACTIVE, 0, 0,
+      9500 * MS);
+  modem_call_events_log_release(events, CALL1, 20000 * MS);
+  modem_call_events_log(events, CALL1, MODEM_CALL_STATE_DISCONNECTED, 1, 16,
+      20300 * MS);
+  modem_call_events_log(events, CALL1, MODEM_CALL_STATE_INVALID, 0, 0,
+      20400 * MS);
+
+  modem_call_events_foreach(events, collect, log);
+  fail_unless(log->len == 6);
+
+  e = g_ptr_array_index(log, 0);
+  fail_unless(strcmp(e->path, CALL1) == 0);
+  fail_unless(e->old_state == MODEM_CALL_STATE_INVALID);
+  fail_unless(e->new_state == MODEM_CALL_STATE_DIALING);
+  fail_unless(e->time == 1000 * MS);
+
+  e = g_ptr_array_index(log, 3);
+  fail_unless(e->old_state == MODEM_CALL_STATE_ACTIVE);
+  fail_unless(e->new_state == MODEM_CALL_EVENT_RELEASE);
+  fail_unless(strcmp(modem_call_event_state_name(e->new_state),
+          "RELEASE") == 0);
+
+  e = g_ptr_array_index(log, 4);
+  fail_unless(e->old_state == MODEM_CALL_STATE_ACTIVE);
+  fail_unless(e->new_state == MODEM_CALL_STATE_DISCONNECTED);
+  fail_unless(e->causetype == 1 && e->cause == 16);
+
+  modem_call_events_get_stats(events, stats);
+  fail_unless(stats->logged == 6);
+  fail_unless(stats->dropped == 0);
+
+  fail_unless(stats->post_dial.count == 1);
+  fail_unless(stats->post_dial.total == 2500 * MS);
+  /* 2.5 seconds is below 4096 ms */
+  fail_unless(stats->post_dial.buckets[12] == 1);
+
+  fail_unless(stats->answer.count == 1);
+  fail_unless(stats->answer.max == 6000 * MS);
+
+  /* From Hangup to CallRemoved */
+  fail_unless(stats->teardown.count == 1);
+  fail_unless(stats->teardown.total == 400 * MS);
+
+  g_ptr_array_free(log, TRUE);
+  modem_call_events_free(events);
+}
+END_TEST
+
+START_TEST(test_call_events_incoming)
+{
+  ModemCallEvents *events = modem_call_events_new(16);
+  ModemCallEventsStats stats[1];
+
+  modem_call_events_log(events, CALL1, MODEM_CALL_STATE_ACTIVE, 0, 0, 0);
+  modem_call_events_log(events, CALL2, MODEM_CALL_STATE_WAITING, 0, 0,
+      100 * MS);
+  modem_call_events_log(events, CALL1, MODEM_CALL_STATE_HELD, 0, 0,
+      2100 * MS);
+  modem_call_events_log(events, CALL2, MODEM_CALL_STATE_ACTIVE, 0, 0,
+      2150 * MS);
+  /* Remote hangs up */
+  modem_call_events_log(events, CALL2, MODEM_CALL_STATE_DISCONNECTED, 0, 0,
+      5000 * MS);
+  modem_call_events_log(events, CALL2, MODEM_CALL_STATE_INVALID, 0, 0,
+      5000 * MS);
+  /* Unknown call is not logged */
+  modem_call_events_log_release(events, CALL2, 5001 * MS);
+
+  modem_call_events_get_stats(events, stats);
+  fail_unless(stats->logged == 6);
+  fail_unless(stats->post_dial.count == 0);
+  fail_unless(stats->answer.count == 1);
+  fail_unless(stats->answer.total == 2050 * MS);
+  fail_unless(stats->teardown.count == 1);
+  fail_unless(stats->teardown.buckets[0] == 1);
+
+  modem_call_events_free(events);
+}
+END_TEST
+
+START_TEST(test_call_events_wrap)
+{
+  ModemCallEvents *events = modem_call_events_new(3);
+  ModemCallEventsStats stats[1];
+  GPtrArray *log = g_ptr_array_new();
+  ModemCallEvent const *e;
+  guint i;
+
+  /* Size is rounded up to 4 */
+  for (i = 0; i < 5; i++)
+    modem_call_events_log(events, CALL1,
+        i & 1 ? MODEM_CALL_STATE_HELD : MODEM_CALL_STATE_ACTIVE, 0, 0, i);
+
+  modem_call_events_foreach(events, collect, log);
+  fail_unless(log->len == 4);
+
+  /* Oldest first */
+  for (i = 0; i < 4; i++)
+    {
+      e = g_ptr_array_index(log, i);
+      fail_unless(e->time == i + 1);
+    }
+
+  modem_call_events_get_stats(events, stats);
+  fail_unless(stats->logged == 5);
+  fail_unless(stats->dropped == 1);
+
+  g_ptr_array_free(log, TRUE);
+  modem_call_events_free(events);
+}
+END_TEST
+
+static TCase *
+tcase_for_call_events(void)
+{
+  TCase *tc = tcase_create("Test for call state transition log");
+
+  tcase_add_test(tc, test_call_events_outgoing);
+  tcase_add_test(tc, test_call_events_incoming);
+  tcase_add_test(tc, test_call_events_wrap);
+
+  return tc;
+}
+
+struct test_cases modem_call_events_tcases[] = {
+  DECLARE_TEST_CASE (tcase_for_call_events),
+  LAST_TEST_CASE
+};
@@ -86,6 +86,27 @@ START_TEST(test_modem_call_validate_address)
 }
 END_TEST
 
+START_TEST(test_modem_call_split_address)
+{
+  char *address, *dialstring = NULL;
+  ModemClirOverride clir = MODEM_CLIR_OVERRIDE_DEFAULT;
+
+  modem_call_split_address("*31#+358718008000p123", &address, &dialstring,
+    &clir);
+  fail_unless(strcmp(address, "+358718008000") == 0);
+  fail_unless(strcmp(dialstring, "p123") == 0);
+  fail_unless(clir == MODEM_CLIR_OVERRIDE_DISABLED);
+  g_free(address), g_free(dialstring), dialstring = NULL;
+
+  /* Upper case A-C stay in the number */
+  modem_call_split_address("#31#12ABCw34", &address, &dialstring, &clir);
+  fail_unless(strcmp(address, "12ABC") == 0);
+  fail_unless(strcmp(dialstring, "w34") == 0);
+  fail_unless(clir == MODEM_CLIR_OVERRIDE_ENABLED);
+  g_free(address), g_free(dialstring), dialstring = NULL;
+}
+END_TEST
+
 static TCase *
 tcase_for_modem_call_address_validator(void)
 {
@@ -94,6 +115,7 @@ tcase_for_modem_call_address_validator(void)
   tcase_add_checked_fixture(tc, g_type_init, NULL);
 
   tcase_add_test(tc, test_modem_call_validate_address);
+  tcase_add_test(tc, test_modem_call_split_address);
 
   tcase_set_timeout(tc, 5);
   return tc;
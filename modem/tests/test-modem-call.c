@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <modem/ofono.h>
+#include <modem/oface.h>
 #include <modem/call.h>
 #include <modem/errors.h>
 #include <modem/service.h>
@@ -125,6 +126,75 @@ START_TEST(modem_call_properties)
 }
 END_TEST
 
+static void
+on_properties_updated(ModemOface *oface,
+                      char const * const *names,
+                      gpointer user_data)
+{
+  guint *n_names = user_data;
+
+  fail_unless(names != NULL);
+  fail_unless(*n_names == 0);
+
+  *n_names = g_strv_length((char **)names);
+}
+
+START_TEST(modem_call_property_table)
+{
+  ModemCall *ci = g_object_new(MODEM_TYPE_CALL,
+      "object-path", "/path",
+      "call-service", NULL,
+      NULL);
+  ModemOfaceClass *klass = MODEM_OFACE_GET_CLASS(ci);
+  GParamSpec *pspec;
+  GHashTable *properties;
+  GValue remote_value[1] = {{ 0 }}, multiparty_value[1] = {{ 0 }};
+  char *remote = NULL;
+  gboolean member = FALSE;
+  guint n_updated = 0;
+
+  pspec = modem_oface_class_find_property(klass, "LineIdentification");
+  fail_unless(pspec != NULL);
+  fail_unless(strcmp(pspec->name, "remote") == 0);
+  /* Second lookup hits the table */
+  fail_unless(modem_oface_class_find_property(klass,
+          "LineIdentification") == pspec);
+
+  fail_unless(modem_oface_class_find_property(klass, "Icon") == NULL);
+  fail_unless(modem_oface_class_find_property(klass, "Icon") == NULL);
+  fail_unless(modem_oface_class_find_property(klass, "NoSuchThing") == NULL);
+
+  g_value_init(remote_value, G_TYPE_STRING);
+  g_value_set_static_string(remote_value, "99001");
+  g_value_init(multiparty_value, G_TYPE_BOOLEAN);
+  g_value_set_boolean(multiparty_value, TRUE);
+
+  properties = g_hash_table_new(g_str_hash, g_str_equal);
+  g_hash_table_insert(properties, "LineIdentification", remote_value);
+  g_hash_table_insert(properties, "Multiparty", multiparty_value);
+  g_hash_table_insert(properties, "Icon", remote_value);
+
+  g_signal_connect(ci, "properties-updated",
+      G_CALLBACK(on_properties_updated), &n_updated);
+
+  modem_oface_update_properties(MODEM_OFACE(ci), properties);
+
+  /* One signal for the whole batch, unmapped "Icon" not included */
+  fail_unless(n_updated == 2);
+
+  g_object_get(ci, "remote", &remote, "multiparty", &member, NULL);
+
+  fail_unless(remote && strcmp(remote, "99001") == 0);
+  fail_unless(member == TRUE);
+
+  g_free(remote);
+  g_hash_table_destroy(properties);
+  g_value_unset(remote_value);
+  g_value_unset(multiparty_value);
+  g_object_unref(ci);
+}
+END_TEST
+
 static TCase *
 modem_call_tcase(void)
 {
@@ -133,6 +203,7 @@ modem_call_tcase(void)
   tcase_add_checked_fixture(tc, setup, teardown);
 
   tcase_add_test(tc, modem_call_properties);
+  tcase_add_test(tc, modem_call_property_table);
 
   tcase_set_timeout(tc, 5);
   return tc;
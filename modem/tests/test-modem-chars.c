@@ -0,0 +1,103 @@
+/*
+ * test-modem-chars.c - Test cases for phone number character classes
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "modem/chars.h"
+
+#include "test-modem.h"
+
+#include <string.h>
+
+START_TEST(test_chars_classes)
+{
+  int c;
+
+  for (c = 0; c < 256; c++) {
+    fail_unless(MODEM_CHAR_IS(c, MODEM_CHAR_DIGIT) ==
+      (c >= '0' && c <= '9'));
+    fail_unless(MODEM_CHAR_IS(c, MODEM_CHAR_TONE) ==
+      (c != 0 && strchr("0123456789*#ABCDabcd", c) != NULL));
+    fail_unless(MODEM_CHAR_IS(c, MODEM_CHAR_ADDRESS) ==
+      (c != 0 && strchr("0123456789*#abc", c) != NULL));
+    fail_unless(MODEM_CHAR_IS(c, MODEM_CHAR_DIAL) ==
+      (c != 0 && strchr("0123456789*#abcpPwW", c) != NULL));
+    fail_unless(MODEM_CHAR_IS(c, MODEM_CHAR_FILLER) ==
+      (c != 0 && strchr(" .()-", c) != NULL));
+  }
+
+  /* Sign extension */
+  fail_if(MODEM_CHAR_IS((char)0xb0, MODEM_CHAR_DIGIT));
+}
+END_TEST
+
+START_TEST(test_chars_parse)
+{
+  ModemAddressParts parts[1];
+
+  fail_unless(modem_address_parse("+358718008000", parts) == NULL);
+  fail_unless(parts->clir == 0);
+  fail_unless(parts->number_len == strlen("+358718008000"));
+  fail_unless(parts->dialstring == NULL);
+
+  fail_unless(modem_address_parse("*31#+358718008000p123#", parts) == NULL);
+  fail_unless(parts->clir == '*');
+  fail_unless(strncmp(parts->number, "+358718008000", parts->number_len) == 0);
+  fail_unless(parts->number_len == strlen("+358718008000"));
+  fail_unless(strcmp(parts->dialstring, "p123#") == 0);
+
+  fail_unless(modem_address_parse("#31#12w34", parts) == NULL);
+  fail_unless(parts->clir == '#');
+  fail_unless(parts->number_len == 2);
+  fail_unless(strcmp(parts->dialstring, "w34") == 0);
+
+  fail_unless(modem_address_parse(NULL, parts) != NULL);
+  fail_unless(modem_address_parse("", NULL) != NULL);
+  fail_unless(modem_address_parse("+", NULL) != NULL);
+  fail_unless(modem_address_parse("*31##31#+1", NULL) != NULL);
+  fail_unless(modem_address_parse("123#", NULL) != NULL);
+  fail_unless(modem_address_parse("123p", NULL) != NULL);
+  fail_unless(modem_address_parse("123pd", NULL) != NULL);
+  fail_unless(modem_address_parse("12 34", NULL) != NULL);
+  fail_unless(modem_address_parse("123456789012345678901", NULL) != NULL);
+  fail_unless(modem_address_parse("+12345678901234567890", NULL) == NULL);
+
+  /* Parts are returned also for invalid addresses */
+  fail_unless(modem_address_parse("12 34", parts) != NULL);
+  fail_unless(parts->number_len == 2);
+  fail_unless(strcmp(parts->dialstring, " 34") == 0);
+}
+END_TEST
+
+static TCase *
+tcase_for_chars(void)
+{
+  TCase *tc = tcase_create("Test for phone number character classes");
+
+  tcase_add_test(tc, test_chars_classes);
+  tcase_add_test(tc, test_chars_parse);
+
+  return tc;
+}
+
+struct test_cases modem_chars_tcases[] = {
+  DECLARE_TEST_CASE(tcase_for_chars),
+  LAST_TEST_CASE
+};
@@ -0,0 +1,129 @@
+/*
+ * test-modem-dtmf.c - Test cases for paced DTMF dial strings
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "modem/dtmf.h"
+
+#include "test-modem.h"
+
+#include <string.h>
+
+#define STEP(steps, i) (&g_array_index((steps), ModemDTMFStep, (i)))
+
+START_TEST(test_dtmf_plan_chunks)
+{
+  GArray *steps;
+  guint interval = MODEM_DTMF_DURATION + MODEM_DTMF_GAP;
+
+  steps = modem_dtmf_plan("1234567890*#", 0, 0, NULL);
+  fail_unless(steps != NULL);
+  fail_unless(steps->len == 2);
+  fail_unless(strcmp(STEP(steps, 0)->tones, "12345678") == 0);
+  fail_unless(STEP(steps, 0)->offset == 0);
+  fail_unless(strcmp(STEP(steps, 1)->tones, "90*#") == 0);
+  fail_unless(STEP(steps, 1)->offset == 8 * interval);
+  g_array_free(steps, TRUE);
+
+  /* Second stage dialing starts with a pause */
+  steps = modem_dtmf_plan("p12,,3", 0, 0, NULL);
+  fail_unless(steps != NULL);
+  fail_unless(steps->len == 2);
+  fail_unless(strcmp(STEP(steps, 0)->tones, "12") == 0);
+  fail_unless(STEP(steps, 0)->offset == MODEM_DTMF_PAUSE);
+  fail_unless(strcmp(STEP(steps, 1)->tones, "3") == 0);
+  fail_unless(STEP(steps, 1)->offset == 3 * MODEM_DTMF_PAUSE + 2 * interval);
+  g_array_free(steps, TRUE);
+}
+END_TEST
+
+START_TEST(test_dtmf_plan_timing)
+{
+  GArray *steps;
+  guint i;
+
+  steps = modem_dtmf_plan("123P4", 150, 50, NULL);
+  fail_unless(steps != NULL);
+  fail_unless(steps->len == 4);
+
+  for (i = 0; i < 3; i++)
+    {
+      fail_unless(strlen(STEP(steps, i)->tones) == 1);
+      fail_unless(STEP(steps, i)->tones[0] == "123"[i]);
+      fail_unless(STEP(steps, i)->offset == i * 200);
+    }
+
+  fail_unless(STEP(steps, 3)->offset == 600 + MODEM_DTMF_PAUSE);
+  g_array_free(steps, TRUE);
+
+  /* Zero duration or pause selects the default */
+  steps = modem_dtmf_plan("12", 0, 400, NULL);
+  fail_unless(steps->len == 2);
+  fail_unless(STEP(steps, 1)->offset == MODEM_DTMF_DURATION + 400);
+  g_array_free(steps, TRUE);
+}
+END_TEST
+
+START_TEST(test_dtmf_plan_wait)
+{
+  GArray *steps;
+  char const *rest = "";
+
+  /* Tones up to the wait are sent */
+  steps = modem_dtmf_plan("12w34W5", 0, 0, &rest);
+  fail_unless(steps != NULL);
+  fail_unless(steps->len == 1);
+  fail_unless(strcmp(STEP(steps, 0)->tones, "12") == 0);
+  fail_unless(rest != NULL && strcmp(rest, "34W5") == 0);
+  g_array_free(steps, TRUE);
+
+  steps = modem_dtmf_plan("p1", 0, 0, &rest);
+  fail_unless(steps != NULL);
+  fail_unless(rest == NULL);
+  g_array_free(steps, TRUE);
+}
+END_TEST
+
+START_TEST(test_dtmf_plan_invalid)
+{
+  fail_if(modem_dtmf_plan("", 0, 0, NULL));
+  fail_if(modem_dtmf_plan("pp", 0, 0, NULL));
+  fail_if(modem_dtmf_plan("w12", 0, 0, NULL));
+  fail_if(modem_dtmf_plan("12e", 0, 0, NULL));
+}
+END_TEST
+
+static TCase *
+tcase_for_dtmf(void)
+{
+  TCase *tc = tcase_create("Test for paced DTMF");
+
+  tcase_add_test(tc, test_dtmf_plan_chunks);
+  tcase_add_test(tc, test_dtmf_plan_timing);
+  tcase_add_test(tc, test_dtmf_plan_wait);
+  tcase_add_test(tc, test_dtmf_plan_invalid);
+
+  return tc;
+}
+
+struct test_cases modem_dtmf_tcases[] = {
+  DECLARE_TEST_CASE(tcase_for_dtmf),
+  LAST_TEST_CASE
+};
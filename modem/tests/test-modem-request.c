@@ -326,6 +326,112 @@ START_TEST(notify_in_call_request)
 END_TEST
 
 
+START_TEST(request_pool)
+{
+  GObject *object = g_object_new(G_TYPE_OBJECT, NULL);
+  DBusGProxy *proxy;
+  ModemRequest *request;
+  ModemRequestStats before[1], after[1];
+  guint i;
+
+  proxy = dbus_g_proxy_new_for_name (dbus_g_bus_get (DBUS_BUS_SYSTEM, NULL),
+      OFONO_BUS_NAME,
+      "/",
+      MODEM_OFACE_MANAGER);
+
+  /* Warm up the free list */
+  request = _modem_request_new(object, proxy, G_CALLBACK(callback), NULL);
+  modem_request_cancel(request);
+
+  modem_request_get_stats(before);
+
+  for (i = 0; i < 100; i++)
+    {
+      request = _modem_request_new(object, proxy, G_CALLBACK(callback), NULL);
+      modem_request_add_notifys(request, notified, request, NULL);
+      fail_unless(modem_request_object(request) == object);
+      modem_request_cancel(request);
+      fail_unless(notify_data == request);
+    }
+
+  modem_request_get_stats(after);
+
+  fail_unless(after->allocated == before->allocated);
+  fail_unless(after->overflows == before->overflows);
+  fail_unless(after->reused - before->reused == 100);
+
+  g_object_unref(object);
+  g_object_unref(proxy);
+}
+END_TEST
+
+static void
+count_pending(char const *label, char const *method, guint64 age,
+  gpointer user_data)
+{
+  if (strcmp(method, "invalid") == 0 && strstr(label, "/invalid/server"))
+    (*(guint *)user_data)++;
+}
+
+static void
+count_latency(char const *label, char const *method,
+  guint count, guint64 total, guint64 max,
+  guint const buckets[MODEM_REQUEST_N_BUCKETS],
+  gpointer user_data)
+{
+  guint i, n = 0;
+
+  if (strcmp(method, "invalid") || !strstr(label, "/invalid/server"))
+    return;
+
+  for (i = 0; i < MODEM_REQUEST_N_BUCKETS; i++)
+    n += buckets[i];
+
+  fail_unless(n == count);
+  fail_unless(max <= total);
+
+  *(guint *)user_data += count;
+}
+
+START_TEST(request_registry)
+{
+  GObject *object = g_object_new(G_TYPE_OBJECT, NULL);
+  DBusGProxy *proxy = dbus_g_proxy_new_for_name(
+    dbus_g_bus_get(DBUS_BUS_SYSTEM, NULL),
+    "com.nokia.invalid.server", "/invalid/server",
+    "com.nokia.invalid.Server");
+  guint pending = 0, completed = 0;
+
+  modem_request_begin(object, proxy, "invalid", reply_to_invalid,
+    G_CALLBACK(callback), NULL,
+    G_TYPE_STRING, "kuik", G_TYPE_INVALID);
+
+  modem_request_foreach_pending(NULL, count_pending, &pending);
+  fail_unless(pending == 1);
+
+  g_main_loop_run(mainloop);
+  g_clear_error(&return_error);
+
+  pending = 0;
+  modem_request_foreach_pending(NULL, count_pending, &pending);
+  fail_unless(pending == 0);
+
+  modem_request_foreach_latency(NULL, count_latency, &completed);
+  fail_unless(completed == 1);
+
+  /* Only objects below the path */
+  completed = 0;
+  modem_request_foreach_latency("/invalid", count_latency, &completed);
+  fail_unless(completed == 1);
+  completed = 0;
+  modem_request_foreach_latency("/invalid/serv", count_latency, &completed);
+  fail_unless(completed == 0);
+
+  g_object_unref(object);
+  g_object_unref(proxy);
+}
+END_TEST
+
 static TCase *
 tcase_for_modem_request(void)
 {
@@ -335,6 +441,8 @@ tcase_for_modem_request(void)
   tcase_add_test(tc, make_call_request);
   tcase_add_test(tc, make_request_to_invalid);
   tcase_add_test(tc, notify_in_call_request);
+  tcase_add_test(tc, request_pool);
+  tcase_add_test(tc, request_registry);
   tcase_set_timeout(tc, 5);
   return tc;
 }
@@ -0,0 +1,181 @@
+/*
+ * test-modem-sms-codec.c - Test cases for SMS text encoding
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "modem/sms-codec.h"
+
+#include "test-modem.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static char *
+repeat(char const *s, guint n)
+{
+  GString *str = g_string_new("");
+
+  while (n-- > 0)
+    g_string_append(str, s);
+
+  return g_string_free(str, FALSE);
+}
+
+START_TEST(test_codec_length)
+{
+  ModemSMSLength l;
+  char *text, *head;
+
+  fail_unless(modem_sms_length("", &l));
+  fail_unless(l.alphabet == MODEM_SMS_ALPHABET_GSM7);
+  fail_unless(l.units == 0 && l.segments == 1 && l.remaining == 160);
+
+  /* Long enough to go through the block kernel */
+  fail_unless(modem_sms_length("Hello, world! How are you today?", &l));
+  fail_unless(l.alphabet == MODEM_SMS_ALPHABET_GSM7);
+  fail_unless(l.units == 32 && l.segments == 1);
+
+  /* Extension characters take two septets */
+  fail_unless(modem_sms_length("[price: 5\xe2\x82\xac]", &l));
+  fail_unless(l.alphabet == MODEM_SMS_ALPHABET_GSM7);
+  fail_unless(l.units == 14);
+
+  /* Characters from the default alphabet outside ASCII */
+  fail_unless(modem_sms_length("\xc3\xa4iti \xce\xa9 @ $", &l));
+  fail_unless(l.alphabet == MODEM_SMS_ALPHABET_GSM7);
+  fail_unless(l.units == 10);
+
+  text = repeat("a", 160);
+  fail_unless(modem_sms_length(text, &l));
+  fail_unless(l.segments == 1 && l.remaining == 0);
+  g_free(text);
+
+  text = repeat("a", 161);
+  fail_unless(modem_sms_length(text, &l));
+  fail_unless(l.segments == 2 && l.remaining == 2 * 153 - 161);
+  g_free(text);
+
+  /* Escaped character is not split between segments */
+  head = repeat("a", 152);
+  text = g_strconcat(head, "{", "bbbbbbbb", NULL);
+  fail_unless(modem_sms_length(text, &l));
+  fail_unless(l.units == 162);
+  fail_unless(l.segments == 2 && l.remaining == 153 - 10);
+  g_free(text), g_free(head);
+
+  /* Cyrillic needs UCS-2 */
+  fail_unless(modem_sms_length(
+      "\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82", &l));
+  fail_unless(l.alphabet == MODEM_SMS_ALPHABET_UCS2);
+  fail_unless(l.units == 6 && l.segments == 1 && l.remaining == 64);
+
+  text = repeat("\xd0\x96", 71);
+  fail_unless(modem_sms_length(text, &l));
+  fail_unless(l.segments == 2 && l.remaining == 2 * 67 - 71);
+  g_free(text);
+
+  /* Surrogate pair is not split between segments */
+  head = repeat("\xd0\x96", 66);
+  text = g_strconcat(head, "\xf0\x9f\x98\x80",
+    "\xd0\x96\xd0\x96\xd0\x96\xd0\x96", NULL);
+  fail_unless(modem_sms_length(text, &l));
+  fail_unless(l.alphabet == MODEM_SMS_ALPHABET_UCS2);
+  fail_unless(l.units == 72);
+  fail_unless(l.segments == 2 && l.remaining == 67 - 6);
+  g_free(text), g_free(head);
+
+  fail_if(modem_sms_length("\xff", &l));
+}
+END_TEST
+
+START_TEST(test_codec_gsm7)
+{
+  char const *text = "Hello {world} \xe2\x82\xac 10, \xc3\x9c" "ber @home";
+  guint8 *septets, *unpacked;
+  guint8 packed[64];
+  gsize length, n;
+  char *decoded;
+
+  septets = modem_sms_gsm7_encode(text, &length);
+  fail_unless(septets != NULL);
+  fail_unless(length == 33);
+  fail_unless(septets[6] == 0x1b && septets[7] == 0x28);
+  fail_unless(septets[length - 5] == 0x00); /* @ */
+
+  decoded = modem_sms_gsm7_decode(septets, length);
+  fail_unless(strcmp(decoded, text) == 0);
+  g_free(decoded);
+
+  n = modem_sms_gsm7_pack(septets, length, packed);
+  fail_unless(n == (length * 7 + 7) / 8);
+
+  unpacked = g_malloc(length);
+  modem_sms_gsm7_unpack(packed, length, unpacked);
+  fail_unless(memcmp(unpacked, septets, length) == 0);
+  g_free(unpacked);
+  g_free(septets);
+
+  /* Example from 3GPP TS 23.038 */
+  septets = modem_sms_gsm7_encode("hellohello", &length);
+  n = modem_sms_gsm7_pack(septets, length, packed);
+  fail_unless(n == 9);
+  fail_unless(memcmp(packed, "\xe8\x32\x9b\xfd\x46\x97\xd9\xec\x37", 9) == 0);
+  g_free(septets);
+
+  fail_if(modem_sms_gsm7_encode("\xd0\x96", &length));
+}
+END_TEST
+
+START_TEST(test_codec_ucs2)
+{
+  char const *text = "\xd0\x96 \xf0\x9f\x98\x80";
+  guint8 *ucs2;
+  gsize length;
+  char *decoded;
+
+  ucs2 = modem_sms_ucs2_encode(text, &length);
+  fail_unless(ucs2 != NULL);
+  fail_unless(length == 8);
+  fail_unless(memcmp(ucs2, "\x04\x16\x00\x20\xd8\x3d\xde\x00", 8) == 0);
+
+  decoded = modem_sms_ucs2_decode(ucs2, length);
+  fail_unless(strcmp(decoded, text) == 0);
+  g_free(decoded);
+  g_free(ucs2);
+}
+END_TEST
+
+static TCase *
+tcase_for_sms_codec(void)
+{
+  TCase *tc = tcase_create("Test for SMS text encoding");
+
+  tcase_add_test(tc, test_codec_length);
+  tcase_add_test(tc, test_codec_gsm7);
+  tcase_add_test(tc, test_codec_ucs2);
+
+  return tc;
+}
+
+struct test_cases modem_sms_codec_tcases[] = {
+  DECLARE_TEST_CASE(tcase_for_sms_codec),
+  LAST_TEST_CASE
+};
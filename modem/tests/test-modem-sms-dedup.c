@@ -0,0 +1,141 @@
+/*
+ * test-modem-sms-dedup.c - Test cases for received SMS index
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "modem/sms-dedup.h"
+
+#include "test-modem.h"
+
+#include <glib/gstdio.h>
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+START_TEST(test_dedup_key)
+{
+  guint64 a, b, c;
+
+  a = modem_sms_dedup_key("+358401234567", "2011-01-01T12:00:00+0200", "hi");
+  b = modem_sms_dedup_key("+358401234567", "2011-01-01T12:00:01+0200", "hi");
+  c = modem_sms_dedup_key("+358401234567", "2011-01-01T12:00:00+0200", "hi");
+
+  fail_if(a == b);
+  fail_unless(a == c);
+
+  /* Field boundaries matter */
+  fail_if(modem_sms_dedup_key("ab", "c", "") ==
+    modem_sms_dedup_key("a", "bc", ""));
+  fail_if(modem_sms_dedup_key(NULL, NULL, "x") ==
+    modem_sms_dedup_key(NULL, "x", NULL));
+}
+END_TEST
+
+START_TEST(test_dedup_window)
+{
+  ModemSMSDedup *dedup = modem_sms_dedup_new(16, 100);
+
+  fail_if(modem_sms_dedup_check(dedup, 1, 1000));
+  fail_unless(modem_sms_dedup_check(dedup, 1, 1050));
+  /* Seeing it again moves the window forward */
+  fail_unless(modem_sms_dedup_check(dedup, 1, 1150));
+  fail_if(modem_sms_dedup_check(dedup, 1, 1251));
+  fail_unless(modem_sms_dedup_size(dedup) == 1);
+
+  modem_sms_dedup_free(dedup);
+}
+END_TEST
+
+START_TEST(test_dedup_lru)
+{
+  ModemSMSDedup *dedup = modem_sms_dedup_new(3, 1000);
+
+  fail_if(modem_sms_dedup_check(dedup, 1, 0));
+  fail_if(modem_sms_dedup_check(dedup, 2, 0));
+  fail_if(modem_sms_dedup_check(dedup, 3, 0));
+  /* 1 becomes most recently seen, so 2 gets evicted */
+  fail_unless(modem_sms_dedup_check(dedup, 1, 1));
+  fail_if(modem_sms_dedup_check(dedup, 4, 1));
+  fail_unless(modem_sms_dedup_size(dedup) == 3);
+
+  fail_unless(modem_sms_dedup_check(dedup, 1, 2));
+  fail_unless(modem_sms_dedup_check(dedup, 3, 2));
+  fail_unless(modem_sms_dedup_check(dedup, 4, 2));
+  fail_if(modem_sms_dedup_check(dedup, 2, 2));
+
+  modem_sms_dedup_free(dedup);
+}
+END_TEST
+
+START_TEST(test_dedup_persist)
+{
+  ModemSMSDedup *dedup;
+  char *path;
+  int fd;
+  struct stat st;
+  gint64 now = time(NULL);
+  guint64 key = modem_sms_dedup_key("+358401234567", NULL, "persistent");
+
+  fd = g_file_open_tmp("test-modem-sms-dedup-XXXXXX", &path, NULL);
+  fail_unless(fd >= 0);
+  close(fd);
+  fail_unless(g_chmod(path, 0644) == 0);
+
+  dedup = modem_sms_dedup_new(16, 3600);
+  fail_if(modem_sms_dedup_check(dedup, key, now));
+  fail_if(modem_sms_dedup_check(dedup, 42, now - 7200));
+  fail_unless(modem_sms_dedup_save(dedup, path, NULL));
+  modem_sms_dedup_free(dedup);
+  fail_unless(g_stat(path, &st) == 0);
+  fail_unless((st.st_mode & 0777) == 0600);
+
+  dedup = modem_sms_dedup_new(16, 3600);
+  fail_unless(modem_sms_dedup_load(dedup, path, NULL));
+  /* Expired entry is not loaded */
+  fail_unless(modem_sms_dedup_size(dedup) == 1);
+  fail_unless(modem_sms_dedup_check(dedup, key, now));
+  modem_sms_dedup_free(dedup);
+
+  g_unlink(path);
+  g_free(path);
+}
+END_TEST
+
+static TCase *
+tcase_for_sms_dedup(void)
+{
+  TCase *tc = tcase_create("Test for received SMS index");
+
+  tcase_add_test(tc, test_dedup_key);
+  tcase_add_test(tc, test_dedup_window);
+  tcase_add_test(tc, test_dedup_lru);
+  tcase_add_test(tc, test_dedup_persist);
+
+  return tc;
+}
+
+struct test_cases modem_sms_dedup_tcases[] = {
+  DECLARE_TEST_CASE(tcase_for_sms_dedup),
+  LAST_TEST_CASE
+};
@@ -0,0 +1,108 @@
+/*
+ * test-modem-sms-info.c - Test cases for parsing incoming SMS information
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include <modem/sms.h>
+
+#include "test-modem.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+START_TEST(test_sms_parse_time)
+{
+  /* 2011-01-01T10:00:00Z */
+  gint64 const t = 1293876000;
+
+  fail_unless(modem_sms_parse_time("2011-01-01T12:00:00+0200") == t);
+  fail_unless(modem_sms_parse_time("2011-01-01T12:00:00+02:00") == t);
+  fail_unless(modem_sms_parse_time("2011-01-01T04:30:00-0530") == t);
+  fail_unless(modem_sms_parse_time("2011-01-01T10:00:00Z") == t);
+  fail_unless(modem_sms_parse_time("2000-02-29T00:00:00+0000") == 951782400);
+
+  fail_unless(modem_sms_parse_time(NULL) == 0);
+  fail_unless(modem_sms_parse_time("") == 0);
+  fail_unless(modem_sms_parse_time("garbage") == 0);
+
+  /* Without offset, taken as local time */
+  fail_unless(modem_sms_parse_time("2011-01-01T12:00:00") != 0);
+}
+END_TEST
+
+static void
+insert_string(GHashTable *dict, char const *key, char const *s)
+{
+  GValue *value = g_slice_new0(GValue);
+
+  g_value_init(value, G_TYPE_STRING);
+  g_value_set_static_string(value, s);
+  g_hash_table_insert(dict, (gpointer)key, value);
+}
+
+static void
+free_value(gpointer value)
+{
+  g_value_unset(value);
+  g_slice_free(GValue, value);
+}
+
+START_TEST(test_sms_parse_info)
+{
+  GHashTable *dict;
+  ModemSMSInfo info[1];
+
+  dict = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free_value);
+
+  modem_sms_parse_info(info, dict);
+  fail_unless(info->dict == dict);
+  fail_unless(info->sender == NULL);
+  fail_unless(info->sent_time == NULL);
+  fail_unless(info->sent == 0);
+  fail_unless(info->received != 0);
+
+  insert_string(dict, "Sender", "+358401234567");
+  insert_string(dict, "SentTime", "2011-01-01T12:00:00+0200");
+
+  modem_sms_parse_info(info, dict);
+  fail_unless(strcmp(info->sender, "+358401234567") == 0);
+  fail_unless(strcmp(info->sent_time, "2011-01-01T12:00:00+0200") == 0);
+  fail_unless(info->sent == 1293876000);
+
+  g_hash_table_destroy(dict);
+}
+END_TEST
+
+static TCase *
+tcase_for_sms_info(void)
+{
+  TCase *tc = tcase_create("Test for parsing incoming SMS information");
+
+  tcase_add_test(tc, test_sms_parse_time);
+  tcase_add_test(tc, test_sms_parse_info);
+
+  return tc;
+}
+
+struct test_cases modem_sms_info_tcases[] = {
+  DECLARE_TEST_CASE(tcase_for_sms_info),
+  LAST_TEST_CASE
+};
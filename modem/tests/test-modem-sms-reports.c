@@ -0,0 +1,174 @@
+/*
+ * test-modem-sms-reports.c - Test cases for status report matching
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include "modem/sms-reports.h"
+
+#include "test-modem.h"
+
+#include <string.h>
+
+#define PATH1 "/phonesim/message_01"
+#define PATH2 "/phonesim/message_02"
+#define PATH3 "/phonesim/message_03"
+
+START_TEST(test_reports_by_path)
+{
+  ModemSMSReports *reports = modem_sms_reports_new(16, 3600);
+  ModemSMSReportsStats stats[1];
+  char *path = NULL, *destination = NULL;
+
+  modem_sms_reports_add(reports, PATH1, "+358401234567", 1000);
+  modem_sms_reports_add(reports, PATH2, "+358407654321", 1000);
+  fail_unless(modem_sms_reports_pending(reports) == 2);
+
+  fail_unless(modem_sms_reports_match(reports, PATH2, -1, TRUE, 1005,
+      &path, &destination));
+  fail_unless(strcmp(path, PATH2) == 0);
+  fail_unless(strcmp(destination, "+358407654321") == 0);
+  g_free(path), g_free(destination);
+
+  /* Final report forgets the message */
+  fail_if(modem_sms_reports_match(reports, PATH2, -1, TRUE, 1006,
+      &path, &destination));
+  fail_unless(modem_sms_reports_pending(reports) == 1);
+
+  modem_sms_reports_get_stats(reports, stats);
+  fail_unless(stats->pending == 1);
+  fail_unless(stats->matched == 1);
+  fail_unless(stats->unmatched == 1);
+  /* 5 seconds is in [4, 8) */
+  fail_unless(stats->latency[3] == 1);
+
+  modem_sms_reports_free(reports);
+}
+END_TEST
+
+START_TEST(test_reports_by_reference)
+{
+  ModemSMSReports *reports = modem_sms_reports_new(16, 3600);
+  ModemSMSReportsStats stats[1];
+  char *path = NULL, *destination = NULL;
+
+  modem_sms_reports_add(reports, PATH1, "+358401234567", 1000);
+  modem_sms_reports_add(reports, PATH2, "+358407654321", 1000);
+
+  /* Reference is not known yet */
+  fail_if(modem_sms_reports_match(reports, NULL, 42, TRUE, 1001,
+      &path, &destination));
+
+  /* SMSC still trying; the report gives both path and reference */
+  fail_unless(modem_sms_reports_match(reports, PATH1, 42, FALSE, 1002,
+      &path, &destination));
+  g_free(path), g_free(destination);
+
+  fail_unless(modem_sms_reports_match(reports, NULL, 42, TRUE, 1000 + 300,
+      &path, &destination));
+  fail_unless(strcmp(path, PATH1) == 0);
+  fail_unless(strcmp(destination, "+358401234567") == 0);
+  g_free(path), g_free(destination);
+
+  fail_if(modem_sms_reports_match(reports, NULL, 42, TRUE, 1301,
+      &path, &destination));
+
+  modem_sms_reports_get_stats(reports, stats);
+  fail_unless(stats->pending == 1);
+  fail_unless(stats->matched == 1);
+  fail_unless(stats->temporary == 1);
+  fail_unless(stats->unmatched == 2);
+  /* 300 seconds is in [256, 512) */
+  fail_unless(stats->latency[9] == 1);
+
+  modem_sms_reports_free(reports);
+}
+END_TEST
+
+START_TEST(test_reports_bounded)
+{
+  ModemSMSReports *reports = modem_sms_reports_new(2, 100);
+  ModemSMSReportsStats stats[1];
+  char *path = NULL, *destination = NULL;
+
+  modem_sms_reports_add(reports, PATH1, "1", 1000);
+  fail_unless(modem_sms_reports_match(reports, PATH1, 7, FALSE, 1000,
+      &path, &destination));
+  g_free(path), g_free(destination);
+
+  modem_sms_reports_add(reports, PATH2, "2", 1010);
+  /* Oldest is evicted, along with its reference */
+  modem_sms_reports_add(reports, PATH3, "3", 1020);
+  fail_unless(modem_sms_reports_pending(reports) == 2);
+  fail_if(modem_sms_reports_match(reports, NULL, 7, TRUE, 1020,
+      &path, &destination));
+
+  /* PATH2 expires, PATH3 does not */
+  fail_unless(modem_sms_reports_expire(reports, 1115) == 1);
+  fail_unless(modem_sms_reports_pending(reports) == 1);
+
+  modem_sms_reports_get_stats(reports, stats);
+  fail_unless(stats->evicted == 1);
+  fail_unless(stats->expired == 1);
+
+  /* Adding the same path again replaces it */
+  modem_sms_reports_add(reports, PATH3, "4", 1116);
+  fail_unless(modem_sms_reports_pending(reports) == 1);
+  fail_unless(modem_sms_reports_match(reports, PATH3, -1, TRUE, 1116,
+      &path, &destination));
+  fail_unless(strcmp(destination, "4") == 0);
+  g_free(path), g_free(destination);
+
+  modem_sms_reports_get_stats(reports, stats);
+  fail_unless(stats->latency[0] == 1);
+
+  modem_sms_reports_free(reports);
+}
+END_TEST
+
+START_TEST(test_reports_tp_st)
+{
+  fail_unless(MODEM_SMS_TP_ST_IS_COMPLETED(0x00));
+  fail_unless(MODEM_SMS_TP_ST_IS_COMPLETED(0x02));
+  fail_unless(MODEM_SMS_TP_ST_IS_TRYING(0x20));
+  fail_unless(MODEM_SMS_TP_ST_IS_TRYING(0x25));
+  fail_unless(MODEM_SMS_TP_ST_IS_PERMANENT(0x41));
+  fail_if(MODEM_SMS_TP_ST_IS_TRYING(0x62));
+  fail_if(MODEM_SMS_TP_ST_IS_PERMANENT(0x62));
+  fail_if(MODEM_SMS_TP_ST_IS_COMPLETED(0x62));
+}
+END_TEST
+
+static TCase *
+tcase_for_sms_reports(void)
+{
+  TCase *tc = tcase_create("Test for status report matching");
+
+  tcase_add_test(tc, test_reports_by_path);
+  tcase_add_test(tc, test_reports_by_reference);
+  tcase_add_test(tc, test_reports_bounded);
+  tcase_add_test(tc, test_reports_tp_st);
+
+  return tc;
+}
+
+struct test_cases modem_sms_reports_tcases[] = {
+  DECLARE_TEST_CASE(tcase_for_sms_reports),
+  LAST_TEST_CASE
+};
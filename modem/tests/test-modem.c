@@ -47,10 +47,17 @@ main(int argc, char *argv[])
 
   filter_add_tcases(suite, modem_requests_tcases, args->tests);
   /*filter_add_tcases(suite, modem_sms_tcases, args->tests);*/
+  filter_add_tcases(suite, modem_sms_dedup_tcases, args->tests);
+  filter_add_tcases(suite, modem_sms_info_tcases, args->tests);
+  filter_add_tcases(suite, modem_sms_codec_tcases, args->tests);
+  filter_add_tcases(suite, modem_sms_reports_tcases, args->tests);
   filter_add_tcases(suite, modem_sim_tcases, args->tests);
   filter_add_tcases(suite, modem_tones_tcases, args->tests);
   filter_add_tcases(suite, modem_call_service_tcases, args->tests);
   filter_add_tcases(suite, modem_call_tcases, args->tests);
+  filter_add_tcases(suite, modem_call_events_tcases, args->tests);
+  filter_add_tcases(suite, modem_chars_tcases, args->tests);
+  filter_add_tcases(suite, modem_dtmf_tcases, args->tests);
 
   runner = srunner_create(suite);
 
@@ -26,10 +26,17 @@
 
 extern struct test_cases modem_call_service_tcases[];
 extern struct test_cases modem_call_tcases[];
+extern struct test_cases modem_call_events_tcases[];
+extern struct test_cases modem_chars_tcases[];
+extern struct test_cases modem_dtmf_tcases[];
 extern struct test_cases modem_requests_tcases[];
 extern struct test_cases modem_tones_tcases[];
 extern struct test_cases modem_sms_tcases[];
 extern struct test_cases modem_sim_tcases[];
+extern struct test_cases modem_sms_dedup_tcases[];
+extern struct test_cases modem_sms_info_tcases[];
+extern struct test_cases modem_sms_codec_tcases[];
+extern struct test_cases modem_sms_reports_tcases[];
 
 #endif
 
@@ -1573,6 +1573,14 @@ ring_conference_get_channels(RingConferenceChannel const *self)
   return list;
 }
 
+RingInitialMembers const *
+ring_conference_channel_get_initial_members(RingConferenceChannel const *self)
+{
+  g_return_val_if_fail(RING_IS_CONFERENCE_CHANNEL(self), NULL);
+
+  return self->priv->initial_members;
+}
+
 gboolean
 ring_conference_channel_check_initial_members(RingConferenceChannel const *channel,
   RingInitialMembers const *maybe)
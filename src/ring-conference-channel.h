@@ -88,6 +88,9 @@ void ring_conference_channel_emit_channel_removed(
 
 void ring_conference_channel_emit_initial(RingConferenceChannel *channel);
 
+RingInitialMembers const *ring_conference_channel_get_initial_members (
+    RingConferenceChannel const *);
+
 gboolean ring_conference_channel_check_initial_members (
     RingConferenceChannel const *,
     RingInitialMembers const *);
@@ -72,6 +72,8 @@ struct _RingConferenceManagerPrivate
   ModemCallService *call_service;
 
   GHashTable *channels;
+  /* Initial member object path => conferences */
+  RingChannelIndex *members;
 
   unsigned dispose_has_run:1, :0;
 
@@ -124,6 +126,8 @@ ring_conference_manager_init (RingConferenceManager *self)
 
   self->priv->channels = g_hash_table_new_full (g_str_hash, g_str_equal,
       NULL, conference_removed);
+  self->priv->members = ring_channel_index_new (g_str_hash, g_str_equal,
+      (GBoxedCopyFunc) g_strdup, g_free);
 }
 
 static void
@@ -163,6 +167,7 @@ ring_conference_manager_finalize (GObject *object)
   RingConferenceManagerPrivate *priv = self->priv;
 
   g_hash_table_destroy (priv->channels);
+  ring_channel_index_free (priv->members);
 }
 
 static void
@@ -290,6 +295,7 @@ on_connection_status_changed (TpBaseConnection *conn,
   if (status == TP_CONNECTION_STATUS_DISCONNECTED)
     {
       g_hash_table_remove_all (priv->channels);
+      ring_channel_index_remove_all (priv->members);
     }
 }
 
@@ -420,21 +426,56 @@ conference_manager_find_existing (RingConferenceManager const *self,
                                        RingInitialMembers *initial)
 {
   RingConferenceManagerPrivate const *priv = self->priv;
-  GHashTableIter i[1];
-  gpointer existing = NULL;
-
-  g_hash_table_iter_init (i, priv->channels);
+  GSList const *l;
 
-  while (g_hash_table_iter_next (i, NULL, &existing))
+  if (initial->len == 0)
     {
-      if (initial->len == 0 ||
-          ring_conference_channel_check_initial_members (existing, initial))
+      GHashTableIter i[1];
+      gpointer existing = NULL;
+
+      g_hash_table_iter_init (i, priv->channels);
+
+      if (g_hash_table_iter_next (i, NULL, &existing))
         return existing;
+
+      return NULL;
+    }
+
+  /* Only conferences started with the first member can match */
+  for (l = ring_channel_index_lookup_all (priv->members, initial->odata[0]);
+       l;
+       l = l->next)
+    {
+      if (ring_conference_channel_check_initial_members (l->data, initial))
+        return l->data;
     }
 
   return NULL;
 }
 
+static void
+conference_manager_index (RingConferenceManager *self,
+                          RingConferenceChannel *channel,
+                          gboolean add)
+{
+  RingInitialMembers const *initial;
+  guint i;
+
+  initial = ring_conference_channel_get_initial_members (channel);
+  if (initial == NULL)
+    return;
+
+  for (i = 0; i < initial->len; i++)
+    {
+      if (add)
+        ring_channel_index_add (self->priv->members,
+            initial->odata[i], channel);
+      else
+        ring_channel_index_remove (self->priv->members,
+            initial->odata[i], channel);
+    }
+}
+
 static char *
 conference_manager_new_object_path (RingConferenceManager const *self)
 {
@@ -494,6 +535,8 @@ on_conference_channel_closed (GObject *_channel, RingConferenceManager *self)
 {
   gchar *object_path;
 
+  conference_manager_index (self, RING_CONFERENCE_CHANNEL (_channel), FALSE);
+
   g_object_get (_channel, "object-path", &object_path, NULL);
   g_hash_table_remove (self->priv->channels, object_path);
   tp_channel_manager_emit_channel_closed (self, object_path);
@@ -526,6 +569,7 @@ conference_manager_emit_new_channel (RingConferenceManager *self,
 	  channel, channel->nick, G_OBJECT_TYPE_NAME (channel));
 
       g_hash_table_insert (priv->channels, object_path, channel);
+      conference_manager_index (self, channel, TRUE);
 
       tp_channel_manager_emit_new_channel (self,
           TP_EXPORTABLE_CHANNEL (channel), requests);
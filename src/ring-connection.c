@@ -47,6 +47,7 @@
 #include <telepathy-glib/intset.h>
 #include <telepathy-glib/svc-generic.h>
 #include <telepathy-glib/svc-connection.h>
+#include <telepathy-glib/util.h>
 
 #include "ring-extensions/ring-extensions.h"
 
@@ -54,7 +55,9 @@
 #include "modem/modem.h"
 #include "modem/sim.h"
 #include "modem/call.h"
+#include "modem/call-events.h"
 #include "modem/sms.h"
+#include "modem/request.h"
 
 #include <dbus/dbus-glib.h>
 
@@ -73,6 +76,8 @@ struct _RingConnectionPrivate
   guint sms_valid;
   guint anon_modes;
   guint anon_supported_modes;
+  guint request_timeout;
+  guint sms_send_window;
 
   RingMediaManager *media;
   RingTextManager *text;
@@ -87,6 +92,7 @@ struct _RingConnectionPrivate
     gulong modem_removed;
     gulong modem_interface_added;
     gulong modem_interface_removed;
+    gulong modem_ready;
     gulong imsi_notify;
   } signals;
 
@@ -116,6 +122,9 @@ enum {
   PROP_MODEM,
   PROP_SIM_SERVICE,
 
+  PROP_REQUEST_TIMEOUT,         /**< Modem request timeout in milliseconds */
+  PROP_SMS_SEND_WINDOW,         /**< Max. number of SMSes sent at once */
+
   N_PROPS
 };
 
@@ -124,11 +133,12 @@ static void ring_connection_class_init_base_connection(TpBaseConnectionClass *);
 static void ring_connection_capabilities_iface_init(gpointer, gpointer);
 static void ring_connection_add_contact_capabilities(GObject *object,
   GArray const *handles, GHashTable *returns);
-/*static void ring_connection_stored_messages_iface_init(gpointer, gpointer);*/
+static void ring_connection_stored_messages_iface_init(gpointer, gpointer);
+static void ring_connection_debug_iface_init(gpointer, gpointer);
 
 static TpDBusPropertiesMixinPropImpl ring_connection_service_point_properties[],
   ring_connection_cellular_properties[],
-/*ring_connection_stored_messages_properties[],*/
+  ring_connection_stored_messages_properties[],
   ring_connection_anon_properties[];
 
 static gboolean ring_connection_cellular_properties_setter(GObject *object,
@@ -160,11 +170,10 @@ G_DEFINE_TYPE_WITH_CODE (RingConnection,
     NULL);
   G_IMPLEMENT_INTERFACE(TP_TYPE_SVC_CONNECTION_INTERFACE_ANONYMITY,
     NULL);
-#if nomore
-  /* XXX: waiting for upstream tp-glib to get this */
-  G_IMPLEMENT_INTERFACE(RTCOM_TYPE_TP_SVC_CONNECTION_INTERFACE_STORED_MESSAGES,
+  G_IMPLEMENT_INTERFACE(RING_TYPE_SVC_CONNECTION_INTERFACE_DEBUG,
+    ring_connection_debug_iface_init);
+  G_IMPLEMENT_INTERFACE(RING_TYPE_SVC_CONNECTION_INTERFACE_STORED_MESSAGES,
     ring_connection_stored_messages_iface_init);
-#endif
   );
 
 static char const * const ring_connection_interfaces_always_present[] = {
@@ -174,9 +183,8 @@ static char const * const ring_connection_interfaces_always_present[] = {
   TP_IFACE_CONNECTION_INTERFACE_SERVICE_POINT,
   TP_IFACE_CONNECTION_INTERFACE_CELLULAR,
   TP_IFACE_CONNECTION_INTERFACE_ANONYMITY,
-#if nomore
-  RTCOM_TP_IFACE_CONNECTION_INTERFACE_STORED_MESSAGES,
-#endif
+  RING_IFACE_CONNECTION_INTERFACE_DEBUG,
+  RING_IFACE_CONNECTION_INTERFACE_STORED_MESSAGES,
   NULL
 };
 
@@ -331,6 +339,8 @@ ring_connection_set_property(GObject *obj,
         g_object_unref (priv->modem);
       p = g_value_get_pointer (value);
       priv->modem = p ? g_object_ref (p) : NULL;
+      if (priv->modem && priv->request_timeout)
+        modem_set_request_timeout (priv->modem, priv->request_timeout);
       break;
 
     case PROP_SIM_SERVICE:
@@ -340,6 +350,19 @@ ring_connection_set_property(GObject *obj,
       priv->sim = p ? g_object_ref (p) : NULL;
       break;
 
+    case PROP_REQUEST_TIMEOUT:
+      priv->request_timeout = g_value_get_uint (value);
+      if (priv->modem)
+        modem_set_request_timeout (priv->modem, priv->request_timeout);
+      break;
+
+    case PROP_SMS_SEND_WINDOW:
+      priv->sms_send_window = g_value_get_uint (value);
+      if (priv->text)
+        g_object_set_property (G_OBJECT (priv->text),
+            "sms-send-window", value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, property_id, pspec);
       break;
@@ -372,10 +395,9 @@ ring_connection_get_property(GObject *obj,
       g_value_set_boxed(value, priv->modem_path);
       break;
     case PROP_STORED_MESSAGES:
-#if nomore
-      g_value_take_boxed(value,
+      if (priv->text)
+        g_value_take_boxed(value,
           ring_text_manager_list_stored_messages (priv->text));
-#endif
       break;
 
     case PROP_KNOWN_SERVICE_POINTS:
@@ -401,6 +423,14 @@ ring_connection_get_property(GObject *obj,
       g_value_set_object (value, priv->sim);
       break;
 
+    case PROP_REQUEST_TIMEOUT:
+      g_value_set_uint (value, priv->request_timeout);
+      break;
+
+    case PROP_SMS_SEND_WINDOW:
+      g_value_set_uint (value, priv->sms_send_window);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(obj, property_id, pspec);
       break;
@@ -498,6 +528,18 @@ ring_connection_class_init(RingConnectionClass *ring_connection_class)
           "The SIM manager from the modem",
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class,
+      PROP_REQUEST_TIMEOUT,
+      g_param_spec_uint ("request-timeout",
+          "Modem request timeout",
+          "Timeout in milliseconds for replies to oFono requests, "
+          "0 for D-Bus default",
+          0, G_MAXINT, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class,
+      PROP_SMS_SEND_WINDOW, ring_param_spec_sms_send_window ());
+
   ring_connection_class_init_base_connection(
     TP_BASE_CONNECTION_CLASS(ring_connection_class));
 
@@ -534,14 +576,12 @@ ring_connection_dbus_property_interfaces[] = {
     tp_dbus_properties_mixin_setter_gobject_properties,
     ring_connection_anon_properties,
   },
-#if nomore
   {
-    RTCOM_TP_IFACE_CONNECTION_INTERFACE_STORED_MESSAGES,
+    RING_IFACE_CONNECTION_INTERFACE_STORED_MESSAGES,
     tp_dbus_properties_mixin_getter_gobject_properties,
     NULL,
     ring_connection_stored_messages_properties,
   },
-#endif
   { NULL }
 };
 
@@ -628,6 +668,23 @@ param_filter_anon_modes(TpCMParamSpec const *paramspec,
   return FALSE;
 }
 
+static gboolean
+param_filter_sms_send_window (TpCMParamSpec const *paramspec,
+  GValue *value,
+  GError **error)
+{
+  guint window = g_value_get_uint (value);
+
+  if (1 <= window && window <= RING_TEXT_MANAGER_MAX_SEND_WINDOW)
+    return TRUE;
+
+  g_set_error (error, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
+      "Account parameter '%s' must be between 1 and %u",
+      paramspec->name, RING_TEXT_MANAGER_MAX_SEND_WINDOW);
+
+  return FALSE;
+}
+
 static gboolean
 param_filter_valid_object_path (TpCMParamSpec const *paramspec,
   GValue *value,
@@ -704,6 +761,22 @@ TpCMParamSpec ring_connection_params[] = {
     .setter_data = "modem-path",
   },
 
+  { "request-timeout",
+    DBUS_TYPE_UINT32_AS_STRING, G_TYPE_UINT,
+    0,
+    GUINT_TO_POINTER(0),
+    .setter_data = "request-timeout",
+  },
+
+  { "sms-send-window",
+    DBUS_TYPE_UINT32_AS_STRING, G_TYPE_UINT,
+    0,
+    GUINT_TO_POINTER(1),
+    0,
+    param_filter_sms_send_window,
+    .setter_data = "sms-send-window",
+  },
+
   /* Deprecated... */
   { "account", DBUS_TYPE_STRING_AS_STRING, G_TYPE_STRING, },
 
@@ -891,6 +964,7 @@ ring_connection_create_channel_managers(TpBaseConnection *base)
       "sms-service-centre", priv->smsc,
       "sms-validity-period", priv->sms_valid,
       "sms-reduced-charset", priv->sms_reduced_charset,
+      "sms-send-window", priv->sms_send_window,
       NULL);
   g_ptr_array_add(channel_managers, priv->text);
 
@@ -987,6 +1061,28 @@ ring_connection_get_modem_interface (RingConnection *self, char const *name)
   return modem_get_interface (self->priv->modem, name);
 }
 
+/* Wait until all modem interfaces have replied before becoming connected */
+static void
+ring_connection_modem_ready (Modem *modem,
+                             gpointer _self)
+{
+  RingConnection *self = RING_CONNECTION (_self);
+  TpBaseConnection *base = TP_BASE_CONNECTION (_self);
+
+  ring_signal_disconnect (modem, &self->priv->signals.modem_ready);
+
+  DEBUG ("modem %s ready in %" G_GUINT64_FORMAT " ms",
+      modem_get_modem_path (modem), modem_get_startup_time (modem) / 1000);
+
+  if (base->status != TP_CONNECTION_STATUS_CONNECTING &&
+      base->status != TP_INTERNAL_CONNECTION_STATUS_NEW)
+    return;
+
+  tp_base_connection_change_status (base,
+      TP_CONNECTION_STATUS_CONNECTED,
+      TP_CONNECTION_STATUS_REASON_REQUESTED);
+}
+
 static void
 ring_connection_bind_modem (RingConnection *self,
                             Modem *modem)
@@ -1002,9 +1098,11 @@ ring_connection_bind_modem (RingConnection *self,
 
   g_object_set (self, "modem", modem, NULL);
 
-  tp_base_connection_change_status (base,
-      TP_CONNECTION_STATUS_CONNECTED,
-      TP_CONNECTION_STATUS_REASON_REQUESTED);
+  if (modem_is_ready (modem))
+    ring_connection_modem_ready (modem, self);
+  else
+    priv->signals.modem_ready = g_signal_connect (modem, "ready",
+        G_CALLBACK (ring_connection_modem_ready), self);
 }
 
 static gboolean
@@ -1253,6 +1351,7 @@ ring_connection_disconnected(TpBaseConnection *base)
   ring_signal_disconnect (modem_service (), &priv->signals.modem_removed);
   ring_signal_disconnect (priv->modem, &priv->signals.modem_interface_added);
   ring_signal_disconnect (priv->modem, &priv->signals.modem_interface_removed);
+  ring_signal_disconnect (priv->modem, &priv->signals.modem_ready);
   ring_signal_disconnect (priv->sim, &priv->signals.imsi_notify);
 
   g_object_set (self, "modem", NULL, NULL);
@@ -1423,65 +1522,310 @@ ring_connection_service_point_properties[] = {
 /* ---------------------------------------------------------------------- */
 /* Connection.Interface.StoredMessages */
 
-#if nomore
 static TpDBusPropertiesMixinPropImpl
 ring_connection_stored_messages_properties[] = {
   { "StoredMessages", "stored-messages" },
   { NULL }
 };
 
+static void
+ring_connection_stored_messages_error(DBusGMethodInvocation *context,
+  GError *error)
+{
+  GError not_available = {
+    TP_ERROR, TP_ERROR_NOT_AVAILABLE, "SMS service is not available"
+  };
+
+  dbus_g_method_return_error(context, error ? error : &not_available);
+
+  if (error)
+    g_error_free(error);
+}
+
 static void
 ring_connection_deliver_stored_messages(
-  RTComTpSvcConnectionInterfaceStoredMessages *iface,
+  RingSvcConnectionInterfaceStoredMessages *iface,
   char const **messages,
   DBusGMethodInvocation *context)
 {
-  ring_text_manager_deliver_stored_messages(
-    RING_CONNECTION(iface)->priv->text,
-    messages,
-    context);
+  RingConnectionPrivate *priv = RING_CONNECTION(iface)->priv;
+  GError *error = NULL;
+
+  if (priv->text &&
+    ring_text_manager_deliver_stored_messages(priv->text, messages, &error))
+    ring_svc_connection_interface_stored_messages_return_from_deliver_stored_messages(
+      context);
+  else
+    ring_connection_stored_messages_error(context, error);
 }
 
 static void
 ring_connection_expunge_messages(
-  RTComTpSvcConnectionInterfaceStoredMessages *iface,
+  RingSvcConnectionInterfaceStoredMessages *iface,
   char const **messages,
   DBusGMethodInvocation *context)
 {
-  ring_text_manager_expunge_messages(
-    RING_CONNECTION(iface)->priv->text,
-    messages,
-    context);
+  RingConnectionPrivate *priv = RING_CONNECTION(iface)->priv;
+  GError *error = NULL;
+
+  if (priv->text &&
+    ring_text_manager_expunge_messages(priv->text, messages, &error))
+    ring_svc_connection_interface_stored_messages_return_from_expunge_messages(
+      context);
+  else
+    ring_connection_stored_messages_error(context, error);
+}
+
+static void
+ring_connection_stored_messages_iface_init(gpointer g_iface, gpointer iface_data)
+{
+  RingSvcConnectionInterfaceStoredMessagesClass *klass = g_iface;
+
+#define IMPLEMENT(x)                                                    \
+  ring_svc_connection_interface_stored_messages_implement_##x(          \
+    klass, ring_connection_ ## x)
+
+  IMPLEMENT(deliver_stored_messages);
+  IMPLEMENT(expunge_messages);
+
+#undef IMPLEMENT
+}
+
+/* ---------------------------------------------------------------------- */
+/* com.Nokia.Telepathy.Connection.Interface.Debug */
+
+static void
+ring_connection_add_pending_request(char const *label,
+  char const *method,
+  guint64 age,
+  gpointer user_data)
+{
+  g_ptr_array_add(user_data,
+    tp_value_array_build(3,
+      G_TYPE_STRING, label,
+      G_TYPE_STRING, method,
+      G_TYPE_UINT, (guint)MIN(age / 1000, G_MAXUINT),
+      G_TYPE_INVALID));
+}
+
+static void
+ring_connection_get_pending_requests(RingSvcConnectionInterfaceDebug *iface,
+  DBusGMethodInvocation *context)
+{
+  RingConnection *self = RING_CONNECTION(iface);
+  GPtrArray *requests = g_ptr_array_new();
+
+  /* Requests of this connection go to objects below its modem */
+  if (self->priv->modem)
+    modem_request_foreach_pending(modem_get_modem_path(self->priv->modem),
+      ring_connection_add_pending_request, requests);
+
+  ring_svc_connection_interface_debug_return_from_get_pending_requests(
+    context, requests);
+
+  g_boxed_free(RING_ARRAY_TYPE_PENDING_REQUEST_LIST, requests);
+}
+
+static void
+ring_connection_add_request_latency(char const *label,
+  char const *method,
+  guint count,
+  guint64 total,
+  guint64 max,
+  guint const *buckets,
+  gpointer user_data)
+{
+  GArray *histogram;
+
+  histogram = g_array_sized_new(FALSE, FALSE, sizeof (guint),
+      MODEM_REQUEST_N_BUCKETS);
+  g_array_append_vals(histogram, buckets, MODEM_REQUEST_N_BUCKETS);
+
+  g_ptr_array_add(user_data,
+    tp_value_array_build(6,
+      G_TYPE_STRING, label,
+      G_TYPE_STRING, method,
+      G_TYPE_UINT, count,
+      G_TYPE_UINT, (guint)MIN(count ? total / count / 1000 : 0, G_MAXUINT),
+      G_TYPE_UINT, (guint)MIN(max / 1000, G_MAXUINT),
+      DBUS_TYPE_G_UINT_ARRAY, histogram,
+      G_TYPE_INVALID));
+
+  g_array_free(histogram, TRUE);
 }
 
 static void
-ring_connection_set_storage_state(
-  RTComTpSvcConnectionInterfaceStoredMessages *iface,
-  gboolean out_of_storage,
+ring_connection_get_request_latencies(RingSvcConnectionInterfaceDebug *iface,
   DBusGMethodInvocation *context)
 {
-  ring_text_manager_set_storage_state(
-    RING_CONNECTION(iface)->priv->text,
-    out_of_storage,
-    context);
+  RingConnection *self = RING_CONNECTION(iface);
+  GPtrArray *latencies = g_ptr_array_new();
+
+  if (self->priv->modem)
+    modem_request_foreach_latency(modem_get_modem_path(self->priv->modem),
+      ring_connection_add_request_latency, latencies);
+
+  /* Time to ring is reported like the latency of a request */
+  if (self->priv->media) {
+    RingMediaManagerRingStats stats[1];
+
+    ring_media_manager_get_ring_stats(self->priv->media, stats);
+    if (stats->count)
+      ring_connection_add_request_latency("ring", "CallAdded",
+        stats->count, stats->total, stats->max, stats->buckets, latencies);
+  }
+
+  ring_svc_connection_interface_debug_return_from_get_request_latencies(
+    context, latencies);
+
+  g_boxed_free(RING_ARRAY_TYPE_REQUEST_LATENCY_LIST, latencies);
 }
 
 static void
-ring_connection_stored_messages_iface_init(gpointer g_iface, gpointer iface_data)
+ring_connection_get_message_queue_statistics(
+  RingSvcConnectionInterfaceDebug *iface,
+  DBusGMethodInvocation *context)
+{
+  RingConnection *self = RING_CONNECTION(iface);
+  RingTextManagerSendStats stats[1];
+  GHashTable *statistics;
+
+  memset(stats, 0, sizeof stats);
+
+  if (self->priv->text)
+    ring_text_manager_get_send_stats(self->priv->text, stats);
+
+  statistics = tp_asv_new(
+    "Window", G_TYPE_UINT, stats->window,
+    "InFlight", G_TYPE_UINT, stats->in_flight,
+    "Queued", G_TYPE_UINT, stats->queued,
+    "MaxQueued", G_TYPE_UINT, stats->max_queued,
+    "Submitted", G_TYPE_UINT, stats->submitted,
+    "Sent", G_TYPE_UINT, stats->sent,
+    "Failed", G_TYPE_UINT, stats->failed,
+    "Rejected", G_TYPE_UINT, stats->rejected,
+    NULL);
+
+  ring_svc_connection_interface_debug_return_from_get_message_queue_statistics(
+    context, statistics);
+
+  g_hash_table_unref(statistics);
+}
+
+static void
+ring_connection_get_channel_lookup_statistics(
+  RingSvcConnectionInterfaceDebug *iface,
+  DBusGMethodInvocation *context)
+{
+  RingConnection *self = RING_CONNECTION(iface);
+  RingTextManagerLookupStats stats[1];
+  GHashTable *statistics;
+
+  memset(stats, 0, sizeof stats);
+
+  if (self->priv->text)
+    ring_text_manager_get_lookup_stats(self->priv->text, stats);
+
+  statistics = tp_asv_new(
+    "Addresses", G_TYPE_UINT, stats->addresses,
+    "AddressHits", G_TYPE_UINT, stats->address_hits,
+    "AddressMisses", G_TYPE_UINT, stats->address_misses,
+    "Channels", G_TYPE_UINT, stats->channels,
+    "ChannelHits", G_TYPE_UINT, stats->channel_hits,
+    "ChannelMisses", G_TYPE_UINT, stats->channel_misses,
+    NULL);
+
+  ring_svc_connection_interface_debug_return_from_get_channel_lookup_statistics(
+    context, statistics);
+
+  g_hash_table_unref(statistics);
+}
+
+typedef struct {
+  GPtrArray *events;
+  gint64 now;
+} RingConnectionCallEvents;
+
+static void
+ring_connection_add_call_event(ModemCallEvent const *event,
+  gpointer _data)
+{
+  RingConnectionCallEvents *data = _data;
+  gint64 age = data->now - event->time;
+
+  g_ptr_array_add(data->events,
+    tp_value_array_build(6,
+      G_TYPE_STRING, event->path,
+      G_TYPE_STRING, modem_call_event_state_name(event->old_state),
+      G_TYPE_STRING, modem_call_event_state_name(event->new_state),
+      G_TYPE_UINT, (guint)MIN(age / 1000, G_MAXUINT),
+      G_TYPE_UINT, (guint)event->causetype,
+      G_TYPE_UINT, (guint)event->cause,
+      G_TYPE_INVALID));
+}
+
+static void
+ring_connection_add_call_latency(char const *name,
+  ModemCallEventsLatency const *m,
+  GPtrArray *latencies)
 {
-  RTComTpSvcConnectionInterfaceStoredMessagesClass *klass = g_iface;
+  ring_connection_add_request_latency("call", name,
+    m->count, m->total, m->max, m->buckets, latencies);
+}
+
+static void
+ring_connection_get_call_events(RingSvcConnectionInterfaceDebug *iface,
+  DBusGMethodInvocation *context)
+{
+  RingConnection *self = RING_CONNECTION(iface);
+  RingConnectionCallEvents data = { g_ptr_array_new(), 0 };
+  GPtrArray *latencies = g_ptr_array_new();
+  ModemOface *oface;
+
+  oface = ring_connection_get_modem_interface(self, MODEM_OFACE_CALL_MANAGER);
+
+  if (oface) {
+    ModemCallEvents *events;
+    ModemCallEventsStats stats[1];
+
+    events = modem_call_service_get_events(MODEM_CALL_SERVICE(oface));
+
+    data.now = g_get_monotonic_time();
+    modem_call_events_foreach(events, ring_connection_add_call_event, &data);
+
+    modem_call_events_get_stats(events, stats);
+    ring_connection_add_call_latency("PostDialDelay",
+      &stats->post_dial, latencies);
+    ring_connection_add_call_latency("AnswerLatency",
+      &stats->answer, latencies);
+    ring_connection_add_call_latency("TeardownLatency",
+      &stats->teardown, latencies);
+  }
+
+  ring_svc_connection_interface_debug_return_from_get_call_events(
+    context, data.events, latencies);
+
+  g_boxed_free(RING_ARRAY_TYPE_CALL_EVENT_LIST, data.events);
+  g_boxed_free(RING_ARRAY_TYPE_REQUEST_LATENCY_LIST, latencies);
+}
+
+static void
+ring_connection_debug_iface_init(gpointer g_iface, gpointer iface_data)
+{
+  RingSvcConnectionInterfaceDebugClass *klass = g_iface;
 
 #define IMPLEMENT(x)                                                    \
-  rtcom_tp_svc_connection_interface_stored_messages_implement_##x(      \
+  ring_svc_connection_interface_debug_implement_##x(                    \
     klass, ring_connection_ ## x)
 
-  IMPLEMENT(deliver_stored_messages);
-  IMPLEMENT(expunge_messages);
-  IMPLEMENT(set_storage_state);
+  IMPLEMENT(get_pending_requests);
+  IMPLEMENT(get_request_latencies);
+  IMPLEMENT(get_message_queue_statistics);
+  IMPLEMENT(get_channel_lookup_statistics);
+  IMPLEMENT(get_call_events);
 
 #undef IMPLEMENT
 }
-#endif
 
 /* ---------------------------------------------------------------------- */
 /* Connection.Interface.Capabilities */
@@ -41,6 +41,7 @@
 #include "ring-util.h"
 
 #include "modem/call.h"
+#include "modem/dtmf.h"
 #include "modem/errors.h"
 #include "modem/tones.h"
 
@@ -98,6 +99,7 @@ struct _RingMediaChannelPrivate
 
   struct {
     char *string;       /* Dialstring */
+    ModemDTMF *sender;
     unsigned playing:1, canceled:1, stopped:1, :0;
   } dial;
 
@@ -328,6 +330,7 @@ ring_media_channel_finalize(GObject *object)
   ring_streamed_media_mixin_finalize (object);
 
   g_free(priv->dial.string);
+  modem_dtmf_free(priv->dial.sender);
 
   G_OBJECT_CLASS(ring_media_channel_parent_class)->finalize(object);
 
@@ -541,7 +544,14 @@ ring_media_channel_close(RingMediaChannel *self)
     ring_media_channel_emit_closed(self);
   }
   else if (!priv->close_timer) {
-    priv->close_timer = g_timeout_add(32000,
+    /* Do not wait for a hung modem longer than its request timeout */
+    guint timeout = 32000;
+
+    if (self->call_instance &&
+        modem_request_get_timeout(self->call_instance) != 0)
+      timeout = modem_request_get_timeout(self->call_instance);
+
+    priv->close_timer = g_timeout_add(timeout,
                         (GSourceFunc)ring_media_channel_emit_closed, self);
   }
 }
@@ -586,6 +596,8 @@ static void ring_sending_dial_string(RingMediaChannel *, char const *);
 
 static ModemCallReply ring_media_channel_dtmf_start_tone_replied;
 static ModemCallReply ring_media_channel_dtmf_stop_tone_replied;
+static ModemDTMFNotify ring_media_channel_dialstring_sent;
+static gboolean ring_media_channel_cancel_dialstring(RingMediaChannel *self);
 
 static char const ring_media_channel_dtmf_events[16] = "0123456789*#ABCD";
 
@@ -624,9 +636,9 @@ ring_media_channel_dtmf_start_tone(TpSvcChannelInterfaceDTMF *iface,
   }
   else {
     ModemRequest *request;
+    gboolean dialing = ring_media_channel_cancel_dialstring(self);
 
-    if (priv->dtmf.digit || priv->dtmf.request ||
-      (priv->dial.string && priv->dial.string[0])) {
+    if (dialing || priv->dtmf.digit || priv->dtmf.request) {
       request = modem_call_stop_dtmf(self->call_instance,
                 ring_media_channel_dtmf_stop_tone_replied, self);
       ring_media_channel_queue_request(self, request);
@@ -718,6 +730,8 @@ ring_media_channel_dtmf_stop_tone(TpSvcChannelInterfaceDTMF *iface,
   else {
     ModemRequest *request;
 
+    ring_media_channel_cancel_dialstring(self);
+
     request = modem_call_stop_dtmf(self->call_instance,
               ring_media_channel_dtmf_stop_tone_replied, self);
 
@@ -1174,9 +1188,6 @@ ring_media_channel_send_dialstring(RingMediaChannel *self,
   DEBUG("(%u, \"%s\", %u, %u) for %s",
     id, dialstring, duration, pause, self->nick);
 
-  (void)duration;
-  (void)pause;
-
   if (ring_streamed_media_mixin_is_audio_stream (self, id)) {
     g_set_error(error, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
       "Invalid stream");
@@ -1193,15 +1204,54 @@ ring_media_channel_send_dialstring(RingMediaChannel *self,
       "Already sending a dial string");
     return FALSE;
   }
-  else if (modem_call_send_dtmf(self->call_instance, dialstring, NULL, NULL) < 0) {
+
+  if (priv->dial.sender == NULL)
+    priv->dial.sender = modem_dtmf_new(self->call_instance);
+
+  if (!modem_dtmf_send(priv->dial.sender, dialstring, duration, pause,
+      ring_media_channel_dialstring_sent, self)) {
     g_set_error(error, TP_ERROR, TP_ERROR_INVALID_ARGUMENT,
       "Bad dial string");
     return FALSE;
   }
-  else {
-    priv->dial.canceled = FALSE;
-    return TRUE;
-  }
+
+  priv->dial.string = g_strdup(dialstring);
+  priv->dial.canceled = FALSE;
+  return TRUE;
+}
+
+static void
+ring_media_channel_dialstring_sent(ModemDTMF *sender,
+  GError const *error,
+  gpointer _self)
+{
+  RingMediaChannel *self = RING_MEDIA_CHANNEL(_self);
+  RingMediaChannelPrivate *priv = self->priv;
+
+  if (error)
+    DEBUG("dial string \"%s\" failed: " GERROR_MSG_FMT " for %s",
+      priv->dial.string, GERROR_MSG_CODE(error), self->nick);
+  else
+    DEBUG("dial string \"%s\" sent for %s", priv->dial.string, self->nick);
+
+  g_free(priv->dial.string), priv->dial.string = NULL;
+}
+
+/* Stop sending the dial string, return TRUE if there was one */
+static gboolean
+ring_media_channel_cancel_dialstring(RingMediaChannel *self)
+{
+  RingMediaChannelPrivate *priv = self->priv;
+
+  if (priv->dial.sender == NULL || !modem_dtmf_cancel(priv->dial.sender))
+    return FALSE;
+
+  DEBUG("canceled dial string \"%s\" for %s", priv->dial.string, self->nick);
+
+  g_free(priv->dial.string), priv->dial.string = NULL;
+  priv->dial.canceled = TRUE;
+
+  return TRUE;
 }
 
 /* ====================================================================== */
@@ -1217,6 +1267,12 @@ ring_media_channel_set_call_instance (RingMediaChannel *self,
   if (ci == old)
     return;
 
+  /* Pending dial string is for the old call */
+  if (priv->dial.sender) {
+    modem_dtmf_free(priv->dial.sender), priv->dial.sender = NULL;
+    g_free(priv->dial.string), priv->dial.string = NULL;
+  }
+
   if (ci) {
     modem_call_set_handler(self->call_instance = MODEM_CALL (ci), self);
 
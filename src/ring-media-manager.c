@@ -60,6 +60,19 @@
 
 #include <string.h>
 
+/* Channel object path prefixes, see ring_media_manager_new_object_path() */
+typedef enum
+{
+  RING_MEDIA_PATH_INCOMING,
+  RING_MEDIA_PATH_OUTGOING,
+  RING_MEDIA_PATH_CREATED,
+  RING_MEDIA_N_PATHS
+} RingMediaPathType;
+
+static char const * const ring_media_path_types[RING_MEDIA_N_PATHS] = {
+  "incoming", "outgoing", "created"
+};
+
 static void channel_manager_iface_init(gpointer, gpointer);
 
 G_DEFINE_TYPE_WITH_CODE(
@@ -104,8 +117,11 @@ static gboolean ring_media_requestotron(RingMediaManager *,
   GHashTable *,
   RequestotronMethod what);
 
-static char *ring_media_manager_new_object_path(RingMediaManager const *self,
-  char const *type);
+static char *ring_media_manager_new_object_path(RingMediaManager *self,
+  RingMediaPathType type);
+
+static void ring_media_manager_prewarm(RingMediaManager *self);
+static void ring_media_manager_cancel_prewarm(RingMediaManager *self);
 
 static gboolean ring_media_manager_outgoing_call(RingMediaManager *self,
   gpointer request,
@@ -115,6 +131,9 @@ static gboolean ring_media_manager_outgoing_call(RingMediaManager *self,
   gboolean initial_audio);
 
 static void on_media_channel_closed(GObject *chan, RingMediaManager *self);
+static void on_media_channel_peer_changed(GObject *chan,
+  GParamSpec *dummy,
+  RingMediaManager *self);
 
 static void foreach_dispose (gpointer, gpointer, gpointer);
 
@@ -159,6 +178,21 @@ struct _RingMediaManagerPrivate
   ModemCallService *call_service;
   ModemTones *tones;
 
+  /* Peer handle => channels */
+  RingChannelIndex *peers;
+
+  /* Interned "<connection path>/<type>" */
+  char const *path_prefixes[RING_MEDIA_N_PATHS];
+
+  /* Work done at idle so that an incoming call rings sooner */
+  struct {
+    guint source;
+    gpointer channel_class;     /* Keeps class and interfaces initialized */
+    char *path;                 /* Next incoming object path */
+  } spare;
+
+  RingMediaManagerRingStats ring_stats;
+
   struct {
     gulong incoming, created, removed;
     gulong emergency_numbers, joined, user_connection;
@@ -174,6 +208,8 @@ ring_media_manager_init(RingMediaManager *self)
   self->priv = G_TYPE_INSTANCE_GET_PRIVATE(
     self, RING_TYPE_MEDIA_MANAGER, RingMediaManagerPrivate);
 
+  self->priv->peers = ring_channel_index_new (g_direct_hash, g_direct_equal,
+      NULL, NULL);
   self->priv->channels = g_hash_table_new_full (g_str_hash, g_str_equal,
       NULL, g_object_unref);
 
@@ -220,6 +256,10 @@ ring_media_manager_finalize(GObject *object)
 
   g_object_unref (priv->tones);
   g_hash_table_destroy (priv->channels);
+  ring_channel_index_free (priv->peers);
+
+  if (priv->spare.channel_class)
+    g_type_class_unref (priv->spare.channel_class);
 }
 
 static void
@@ -360,6 +400,8 @@ ring_media_manager_connected (RingMediaManager *self)
       G_CALLBACK(on_modem_call_emergency_numbers_changed), self);
 
   modem_call_service_resume (priv->call_service);
+
+  ring_media_manager_prewarm (self);
 }
 
 /** Disconnect from call service */
@@ -373,8 +415,11 @@ ring_media_manager_disconnect(RingMediaManager *self)
   ring_signal_disconnect (priv->call_service, &priv->signals.user_connection);
   ring_signal_disconnect (priv->call_service, &priv->signals.emergency_numbers);
 
+  ring_media_manager_cancel_prewarm (self);
+
   g_hash_table_foreach (priv->channels, foreach_dispose, NULL);
   g_hash_table_remove_all (priv->channels);
+  ring_channel_index_remove_all (priv->peers);
 
   if (priv->call_service)
     g_object_unref (priv->call_service);
@@ -778,11 +823,11 @@ ring_media_manager_validate_initial_members(RingMediaManager *self,
 }
 
 static char *
-ring_media_manager_new_object_path(RingMediaManager const *self,
-  char const *type)
+ring_media_manager_new_object_path(RingMediaManager *self,
+  RingMediaPathType type)
 {
-  RingMediaManagerPrivate const *priv = self->priv;
-  char const *base_path = TP_BASE_CONNECTION(priv->connection)->object_path;
+  RingMediaManagerPrivate *priv = self->priv;
+  char const *prefix = priv->path_prefixes[type];
 
   static unsigned media_index;
   static unsigned media_index_init;
@@ -792,9 +837,17 @@ ring_media_manager_new_object_path(RingMediaManager const *self,
     media_index_init = 1;
   }
 
+  if (prefix == NULL) {
+    char *s = g_strdup_printf("%s/%s",
+              TP_BASE_CONNECTION(priv->connection)->object_path,
+              ring_media_path_types[type]);
+    prefix = priv->path_prefixes[type] = g_intern_string(s);
+    g_free(s);
+  }
+
   /* Find an unique D-Bus object_path */
   for (;;) {
-    char *path = g_strdup_printf("%s/%s%u", base_path, type, ++media_index);
+    char *path = g_strdup_printf("%s%u", prefix, ++media_index);
     if (!g_hash_table_lookup(priv->channels, path)) {
       return path;
     }
@@ -802,6 +855,109 @@ ring_media_manager_new_object_path(RingMediaManager const *self,
   }
 }
 
+/* ---------------------------------------------------------------------- */
+/* Incoming call fast path
+ *
+ * The channel for an incoming call cannot be created before the call
+ * arrives, as its handle and object path are fixed when constructing
+ * it. Instead, the channel classes are initialized and the object path
+ * for the next incoming call is made beforehand, at idle priority.
+ */
+
+static gboolean
+ring_media_manager_prewarm_cb(gpointer _self)
+{
+  RingMediaManager *self = RING_MEDIA_MANAGER(_self);
+  RingMediaManagerPrivate *priv = self->priv;
+
+  priv->spare.source = 0;
+
+  if (priv->spare.channel_class == NULL)
+    priv->spare.channel_class = g_type_class_ref(RING_TYPE_CALL_CHANNEL);
+
+  if (priv->spare.path == NULL &&
+    TP_BASE_CONNECTION(priv->connection)->object_path != NULL)
+    priv->spare.path = ring_media_manager_new_object_path(self,
+                       RING_MEDIA_PATH_INCOMING);
+
+  return FALSE;
+}
+
+static void
+ring_media_manager_prewarm(RingMediaManager *self)
+{
+  RingMediaManagerPrivate *priv = self->priv;
+
+  if (priv->spare.source == 0)
+    priv->spare.source = g_idle_add_full(G_PRIORITY_LOW,
+                         ring_media_manager_prewarm_cb, self, NULL);
+}
+
+static void
+ring_media_manager_cancel_prewarm(RingMediaManager *self)
+{
+  RingMediaManagerPrivate *priv = self->priv;
+
+  if (priv->spare.source)
+    g_source_remove(priv->spare.source);
+  priv->spare.source = 0;
+
+  g_free(priv->spare.path);
+  priv->spare.path = NULL;
+}
+
+/* Take the object path made beforehand, if it is still unused */
+static char *
+ring_media_manager_take_incoming_path(RingMediaManager *self)
+{
+  RingMediaManagerPrivate *priv = self->priv;
+  char *path = priv->spare.path;
+
+  priv->spare.path = NULL;
+  ring_media_manager_prewarm(self);
+
+  if (path && !g_hash_table_lookup(priv->channels, path))
+    return path;
+
+  g_free(path);
+  return ring_media_manager_new_object_path(self, RING_MEDIA_PATH_INCOMING);
+}
+
+/* Record time from CallAdded to NewChannels */
+static void
+ring_media_manager_record_ring_latency(RingMediaManager *self,
+  gint64 added)
+{
+  RingMediaManagerRingStats *stats = &self->priv->ring_stats;
+  guint64 latency;
+  guint i;
+
+  if (added == 0)
+    return;
+
+  latency = g_get_monotonic_time() - added;
+
+  DEBUG("CallAdded to NewChannels in %" G_GUINT64_FORMAT " us", latency);
+
+  stats->count++;
+  stats->total += latency;
+  if (latency > stats->max)
+    stats->max = latency;
+
+  /* Bucket 0 is below 1 ms, bucket i is below 2**i ms */
+  for (i = 0; i < MODEM_REQUEST_N_BUCKETS - 1; i++)
+    if (latency < (G_GUINT64_CONSTANT(1000) << i))
+      break;
+  stats->buckets[i]++;
+}
+
+void
+ring_media_manager_get_ring_stats(RingMediaManager const *self,
+  RingMediaManagerRingStats *return_stats)
+{
+  *return_stats = self->priv->ring_stats;
+}
+
 static const gchar*
 get_nick(TpBaseChannel *channel)
 {
@@ -822,16 +978,21 @@ ring_media_manager_emit_new_channel(RingMediaManager *self,
 
   if (error == NULL) {
     char *object_path = NULL;
+    TpHandle peer = 0;
 
     g_signal_connect(
       channel, "closed", G_CALLBACK(on_media_channel_closed), self);
+    g_signal_connect(
+      channel, "notify::peer", G_CALLBACK(on_media_channel_peer_changed), self);
 
-    g_object_get(channel, "object-path", &object_path, NULL);
+    g_object_get(channel, "object-path", &object_path, "peer", &peer, NULL);
 
     DEBUG("got new channel %p nick %s type %s",
 	  channel, get_nick (channel), G_OBJECT_TYPE_NAME (channel));
 
     g_hash_table_insert(priv->channels, object_path, channel);
+    if (peer)
+      ring_channel_index_add(priv->peers, GUINT_TO_POINTER(peer), channel);
 
     tp_channel_manager_emit_new_channel(self,
       TP_EXPORTABLE_CHANNEL(channel), requests);
@@ -866,7 +1027,8 @@ ring_media_manager_outgoing_call(RingMediaManager *self,
 {
   RingMediaManagerPrivate *priv = self->priv;
   TpHandleType htype = target ? TP_HANDLE_TYPE_CONTACT : TP_HANDLE_TYPE_NONE;
-  char *object_path = ring_media_manager_new_object_path(self, "outgoing");
+  char *object_path = ring_media_manager_new_object_path(self,
+    RING_MEDIA_PATH_OUTGOING);
   RingCallChannel *channel;
   TpHandle initiator;
 
@@ -902,10 +1064,17 @@ ring_media_manager_outgoing_call(RingMediaManager *self,
 static void
 on_media_channel_closed(GObject *chan, RingMediaManager *self)
 {
+  g_signal_handlers_disconnect_by_func(chan,
+    on_media_channel_peer_changed, self);
+
   if (self->priv->channels != NULL) {
     gchar *object_path;
+    TpHandle peer = 0;
 
-    g_object_get (chan, "object-path", &object_path, NULL);
+    g_object_get (chan, "object-path", &object_path, "peer", &peer, NULL);
+    if (peer)
+      ring_channel_index_remove (self->priv->peers,
+          GUINT_TO_POINTER (peer), chan);
     g_hash_table_remove (self->priv->channels, object_path);
     tp_channel_manager_emit_channel_closed (self, object_path);
     g_free (object_path);
@@ -923,23 +1092,26 @@ ring_media_manager_lookup(RingMediaManager *self,
     return NULL;
 }
 
+/* The peer of a call channel is set only once, when it becomes known */
+static void
+on_media_channel_peer_changed(GObject *chan,
+  GParamSpec *dummy,
+  RingMediaManager *self)
+{
+  TpHandle peer = 0;
+
+  g_object_get(chan, "peer", &peer, NULL);
+  if (peer)
+    ring_channel_index_add(self->priv->peers, GUINT_TO_POINTER(peer), chan);
+}
+
 /** Find a RingMediaChannel by peer handle. */
 static gpointer
 ring_media_manager_lookup_by_peer(RingMediaManager *self,
   TpHandle handle)
 {
-  GHashTableIter i[1];
-  gpointer channel;
-
-  for (g_hash_table_iter_init(i, self->priv->channels);
-       g_hash_table_iter_next(i, NULL, &channel);) {
-    TpHandle peer = 0;
-    g_object_get(channel, "peer", &peer, NULL);
-    if (handle == peer)
-      return channel;
-  }
-
-  return NULL;
+  return ring_channel_index_lookup(self->priv->peers,
+    GUINT_TO_POINTER(handle));
 }
 
 
@@ -981,7 +1153,7 @@ on_modem_call_incoming(ModemCallService *call_service,
   }
 
   /* Incoming call - pass call and handle ownership to new media channel */
-  char *object_path = ring_media_manager_new_object_path(self, "incoming");
+  char *object_path = ring_media_manager_take_incoming_path(self);
 
   channel = (RingCallChannel *)
     g_object_new(RING_TYPE_CALL_CHANNEL,
@@ -1002,6 +1174,8 @@ on_modem_call_incoming(ModemCallService *call_service,
   g_free(object_path);
 
   ring_media_manager_emit_new_channel(self, NULL, channel, NULL);
+  ring_media_manager_record_ring_latency(self,
+    modem_call_service_time_call_added(call_service));
   ring_media_channel_set_state(RING_MEDIA_CHANNEL(channel),
     MODEM_CALL_STATE_INCOMING, 0, 0);
 }
@@ -1045,7 +1219,8 @@ on_modem_call_created(ModemCallService *call_service,
 
   sos = modem_call_get_emergency_service(priv->call_service, destination);
 
-  char *object_path = ring_media_manager_new_object_path(self, "created");
+  char *object_path = ring_media_manager_new_object_path(self,
+    RING_MEDIA_PATH_CREATED);
 
   channel = (RingCallChannel *)
     g_object_new(RING_TYPE_CALL_CHANNEL,
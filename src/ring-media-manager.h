@@ -35,6 +35,7 @@ G_END_DECLS
 #include <ring-emergency-service.h>
 #include <ring-util.h>
 #include "modem/call.h"
+#include "modem/request.h"
 
 G_BEGIN_DECLS
 
@@ -79,6 +80,17 @@ gboolean ring_media_manager_validate_initial_members(RingMediaManager *self,
   RingInitialMembers *initial,
   GError **error);
 
+/* Time from CallAdded to NewChannels for incoming calls */
+typedef struct {
+  guint count;
+  guint64 total;                /* Microseconds */
+  guint64 max;                  /* Microseconds */
+  guint buckets[MODEM_REQUEST_N_BUCKETS];
+} RingMediaManagerRingStats;
+
+void ring_media_manager_get_ring_stats(RingMediaManager const *self,
+  RingMediaManagerRingStats *return_stats);
+
 G_END_DECLS
 
 #endif
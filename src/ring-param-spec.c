@@ -22,6 +22,7 @@
 #include "config.h"
 #include "ring-param-spec.h"
 #include "ring-connection.h"
+#include "ring-text-manager.h"
 #include "modem/oface.h"
 #include "modem/sms.h"
 
@@ -62,6 +63,19 @@ GParamSpec *ring_param_spec_sms_reduced_charset(void)
       G_PARAM_STATIC_STRINGS);
 }
 
+GParamSpec *ring_param_spec_sms_send_window(void)
+{
+  return
+    g_param_spec_uint("sms-send-window",
+      "SMS send window",
+      "Maximum number of outgoing SMSes "
+      "submitted to the modem at once",
+      1, RING_TEXT_MANAGER_MAX_SEND_WINDOW,
+      1,        /* default - modem sends one at a time anyway */
+      G_PARAM_READWRITE | G_PARAM_CONSTRUCT |
+      G_PARAM_STATIC_STRINGS);
+}
+
 GParamSpec *ring_param_spec_smsc(void)
 {
   return
@@ -30,6 +30,7 @@ GParamSpec *ring_param_spec_imsi (guint flags);
 GParamSpec *ring_param_spec_sms_valid(void);
 GParamSpec *ring_param_spec_smsc(void);
 GParamSpec *ring_param_spec_sms_reduced_charset(void);
+GParamSpec *ring_param_spec_sms_send_window(void);
 
 GParamSpec *ring_param_spec_connection(void);
 
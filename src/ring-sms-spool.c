@@ -0,0 +1,645 @@
+/*
+ * ring-sms-spool.c - Persistent spool for outgoing SMS
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * The spool is an append-only file divided into fixed-size slots. The
+ * first slot holds the file header. A queued message is written as a
+ * record taking one or more consecutive slots, and a message that has
+ * been sent (or has failed) is marked done by appending a one-slot
+ * record with the same id. The records are checksummed, so a record
+ * torn by a crash ends the scan on the next startup.
+ *
+ * The file is memory-mapped and appended to in place. The dirty pages
+ * are synced from a timer, so a burst of messages costs one msync().
+ * The same timer rewrites the file without the done records once they
+ * take up most of it.
+ */
+
+#include "config.h"
+
+#define DEBUG_FLAG RING_DEBUG_SMS
+#include "ring-debug.h"
+
+#include "ring-sms-spool.h"
+
+#include <glib/gstdio.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RING_SMS_SPOOL_MAGIC "RingSpl1"
+
+#define SLOT_SIZE (128)
+#define GROW_SLOTS (512)              /* Grow mapping 64 KiB at a time */
+#define SYNC_INTERVAL (100)           /* Milliseconds */
+#define COMPACT_SLOTS (GROW_SLOTS / 2)
+
+enum {
+  RECORD_QUEUED = 0x51554555,   /* "QUEU" */
+  RECORD_DONE = 0x444f4e45,     /* "DONE" */
+};
+
+typedef struct {
+  char magic[8];
+  guint32 slot_size;
+} RingSMSSpoolHeader;
+
+typedef struct {
+  guint32 type;
+  guint32 id;
+  guint32 n_slots;
+  guint32 flags;
+  guint32 length;               /* destination NUL text NUL token NUL */
+  guint32 checksum;
+  char payload[];
+} RingSMSSpoolRecord;
+
+struct _RingSMSSpool
+{
+  char *path;
+  int fd;
+  guint8 *map;
+  gsize size;                   /* Bytes mapped */
+  gsize end;                    /* Offset of next record */
+  gsize dirty;                  /* Offset of first unsynced byte */
+
+  /* id => offset of the queued record */
+  GHashTable *live;
+  guint live_slots, dead_slots;
+  guint next_id;
+
+  guint sync_source;
+};
+
+static gboolean ring_sms_spool_map (RingSMSSpool *, GError **);
+static void ring_sms_spool_unmap (RingSMSSpool *);
+static gboolean ring_sms_spool_sync_cb (gpointer);
+
+/* ---------------------------------------------------------------------- */
+
+static guint32
+record_checksum (RingSMSSpoolRecord const *record)
+{
+  /* FNV-1a over fields before checksum and the payload */
+  guint8 const *p = (guint8 const *)record;
+  guint32 hash = 2166136261U;
+  gsize i;
+
+  for (i = 0; i < G_STRUCT_OFFSET (RingSMSSpoolRecord, checksum); i++)
+    hash = (hash ^ p[i]) * 16777619U;
+
+  p = (guint8 const *)record->payload;
+  for (i = 0; i < record->length; i++)
+    hash = (hash ^ p[i]) * 16777619U;
+
+  return hash;
+}
+
+static guint
+record_slots (gsize length)
+{
+  return (sizeof (RingSMSSpoolRecord) + length + SLOT_SIZE - 1) / SLOT_SIZE;
+}
+
+static RingSMSSpoolRecord *
+record_at (RingSMSSpool const *spool, gsize offset)
+{
+  return (RingSMSSpoolRecord *)(spool->map + offset);
+}
+
+/* Return TRUE if there is a complete, valid record at offset */
+static gboolean
+record_is_valid (RingSMSSpool const *spool, gsize offset)
+{
+  RingSMSSpoolRecord const *record = record_at (spool, offset);
+
+  if (offset + sizeof *record > spool->size)
+    return FALSE;
+  if (record->type != RECORD_QUEUED && record->type != RECORD_DONE)
+    return FALSE;
+  if (record->n_slots == 0 ||
+      record->n_slots > (spool->size - offset) / SLOT_SIZE)
+    return FALSE;
+  if (record->n_slots != record_slots (record->length))
+    return FALSE;
+
+  return record->checksum == record_checksum (record);
+}
+
+/* ---------------------------------------------------------------------- */
+
+RingSMSSpool *
+ring_sms_spool_open (char const *path,
+                     GError **error)
+{
+  RingSMSSpool *spool = g_slice_new0 (RingSMSSpool);
+
+  spool->path = g_strdup (path);
+  spool->fd = -1;
+  spool->live = g_hash_table_new (NULL, NULL);
+  spool->next_id = 1;
+
+  if (!ring_sms_spool_map (spool, error))
+    {
+      ring_sms_spool_close (spool);
+      return NULL;
+    }
+
+  DEBUG ("%s: %u queued messages", path, g_hash_table_size (spool->live));
+
+  return spool;
+}
+
+void
+ring_sms_spool_close (RingSMSSpool *spool)
+{
+  if (spool == NULL)
+    return;
+
+  if (spool->sync_source)
+    g_source_remove (spool->sync_source);
+
+  ring_sms_spool_sync (spool);
+  ring_sms_spool_unmap (spool);
+
+  g_hash_table_destroy (spool->live);
+  g_free (spool->path);
+
+  g_slice_free (RingSMSSpool, spool);
+}
+
+static gboolean
+ring_sms_spool_resize (RingSMSSpool *spool,
+                       gsize size,
+                       GError **error)
+{
+  gpointer map;
+
+  if (ftruncate (spool->fd, size) < 0)
+    goto error;
+
+  map = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, spool->fd, 0);
+  if (map == MAP_FAILED)
+    goto error;
+
+  if (spool->map)
+    munmap (spool->map, spool->size);
+
+  spool->map = map;
+  spool->size = size;
+
+  return TRUE;
+
+ error:
+  g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+      "%s: %s", spool->path, g_strerror (errno));
+  return FALSE;
+}
+
+static gboolean
+ring_sms_spool_map (RingSMSSpool *spool,
+                    GError **error)
+{
+  RingSMSSpoolHeader *header;
+  struct stat st;
+  gsize offset;
+
+  spool->fd = g_open (spool->path, O_RDWR | O_CREAT, 0600);
+  if (spool->fd < 0 || fstat (spool->fd, &st) < 0)
+    {
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+          "%s: %s", spool->path, g_strerror (errno));
+      return FALSE;
+    }
+
+  /* Earlier versions replaced the file with the default mode */
+  if ((st.st_mode & 077) != 0 && fchmod (spool->fd, 0600) < 0)
+    DEBUG ("%s: fchmod: %s", spool->path, g_strerror (errno));
+
+  if (!ring_sms_spool_resize (spool,
+          MAX ((gsize)st.st_size, GROW_SLOTS * SLOT_SIZE), error))
+    return FALSE;
+
+  header = (RingSMSSpoolHeader *)spool->map;
+
+  if (st.st_size == 0)
+    {
+      memcpy (header->magic, RING_SMS_SPOOL_MAGIC, sizeof header->magic);
+      header->slot_size = SLOT_SIZE;
+      spool->dirty = 0;
+    }
+  else if (memcmp (header->magic, RING_SMS_SPOOL_MAGIC, sizeof header->magic)
+      || header->slot_size != SLOT_SIZE)
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+          "%s: not a message spool", spool->path);
+      return FALSE;
+    }
+
+  for (offset = SLOT_SIZE; record_is_valid (spool, offset);)
+    {
+      RingSMSSpoolRecord *record = record_at (spool, offset);
+      gpointer value;
+
+      if (record->id >= spool->next_id)
+        spool->next_id = record->id + 1;
+
+      if (record->type == RECORD_QUEUED)
+        {
+          g_hash_table_insert (spool->live,
+              GUINT_TO_POINTER (record->id), GSIZE_TO_POINTER (offset));
+          spool->live_slots += record->n_slots;
+        }
+      else if (g_hash_table_lookup_extended (spool->live,
+              GUINT_TO_POINTER (record->id), NULL, &value))
+        {
+          guint n_slots = record_at (spool, GPOINTER_TO_SIZE (value))->n_slots;
+
+          g_hash_table_remove (spool->live, GUINT_TO_POINTER (record->id));
+          spool->live_slots -= n_slots;
+          spool->dead_slots += n_slots + record->n_slots;
+        }
+      else
+        {
+          spool->dead_slots += record->n_slots;
+        }
+
+      offset += record->n_slots * SLOT_SIZE;
+    }
+
+  spool->end = offset;
+  if (st.st_size != 0)
+    spool->dirty = spool->end;
+
+  return TRUE;
+}
+
+static void
+ring_sms_spool_unmap (RingSMSSpool *spool)
+{
+  if (spool->map)
+    munmap (spool->map, spool->size);
+  spool->map = NULL;
+  spool->size = 0;
+
+  if (spool->fd >= 0)
+    close (spool->fd);
+  spool->fd = -1;
+
+  g_hash_table_remove_all (spool->live);
+  spool->live_slots = spool->dead_slots = 0;
+  spool->end = spool->dirty = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static RingSMSSpoolRecord *
+ring_sms_spool_reserve (RingSMSSpool *spool,
+                        guint n_slots)
+{
+  gsize needed = spool->end + (n_slots + 1) * SLOT_SIZE;
+  GError *error = NULL;
+  RingSMSSpoolRecord *record;
+
+  if (needed > spool->size)
+    {
+      needed = (needed + GROW_SLOTS * SLOT_SIZE - 1)
+        / (GROW_SLOTS * SLOT_SIZE) * (GROW_SLOTS * SLOT_SIZE);
+
+      if (!ring_sms_spool_resize (spool, needed, &error))
+        {
+          DEBUG ("%s", error->message);
+          g_error_free (error);
+          return NULL;
+        }
+    }
+
+  record = record_at (spool, spool->end);
+  /* Clear leftovers from a torn record, including the next record type */
+  memset (record, 0, (n_slots + 1) * SLOT_SIZE);
+
+  return record;
+}
+
+static void
+ring_sms_spool_commit (RingSMSSpool *spool,
+                       RingSMSSpoolRecord *record,
+                       guint32 type)
+{
+  record->n_slots = record_slots (record->length);
+  record->type = type;
+  record->checksum = record_checksum (record);
+
+  spool->dirty = MIN (spool->dirty, spool->end);
+  spool->end += record->n_slots * SLOT_SIZE;
+
+  if (spool->sync_source == 0)
+    spool->sync_source =
+      g_timeout_add (SYNC_INTERVAL, ring_sms_spool_sync_cb, spool);
+}
+
+/** Store a message in spool.
+ *
+ * @return identifier of the message in spool, or 0 if it could not be stored
+ */
+guint
+ring_sms_spool_append (RingSMSSpool *spool,
+                       char const *destination,
+                       char const *text,
+                       char const *token,
+                       guint flags)
+{
+  RingSMSSpoolRecord *record;
+  gsize dlen, tlen, klen;
+
+  if (spool == NULL)
+    return 0;
+
+  dlen = strlen (destination) + 1;
+  tlen = strlen (text) + 1;
+  klen = strlen (token) + 1;
+
+  record = ring_sms_spool_reserve (spool, record_slots (dlen + tlen + klen));
+  if (record == NULL)
+    return 0;
+
+  record->id = spool->next_id++;
+  if (spool->next_id == 0)
+    spool->next_id = 1;
+  record->flags = flags;
+  record->length = dlen + tlen + klen;
+  memcpy (record->payload, destination, dlen);
+  memcpy (record->payload + dlen, text, tlen);
+  memcpy (record->payload + dlen + tlen, token, klen);
+
+  g_hash_table_insert (spool->live,
+      GUINT_TO_POINTER (record->id), GSIZE_TO_POINTER (spool->end));
+  spool->live_slots += record_slots (record->length);
+
+  ring_sms_spool_commit (spool, record, RECORD_QUEUED);
+
+  return record->id;
+}
+
+/** Mark a message in spool as done. */
+void
+ring_sms_spool_remove (RingSMSSpool *spool,
+                       guint id)
+{
+  RingSMSSpoolRecord *record;
+  gpointer value;
+  guint n_slots;
+
+  if (spool == NULL || id == 0)
+    return;
+
+  if (!g_hash_table_lookup_extended (spool->live,
+          GUINT_TO_POINTER (id), NULL, &value))
+    return;
+
+  n_slots = record_at (spool, GPOINTER_TO_SIZE (value))->n_slots;
+
+  record = ring_sms_spool_reserve (spool, 1);
+  if (record == NULL)
+    return;
+
+  g_hash_table_remove (spool->live, GUINT_TO_POINTER (id));
+  spool->live_slots -= n_slots;
+  spool->dead_slots += n_slots + 1;
+
+  record->id = id;
+  ring_sms_spool_commit (spool, record, RECORD_DONE);
+}
+
+/** Number of messages in spool */
+guint
+ring_sms_spool_size (RingSMSSpool const *spool)
+{
+  return spool ? g_hash_table_size (spool->live) : 0;
+}
+
+/** Call func for each message in spool in the order they were stored. */
+void
+ring_sms_spool_foreach (RingSMSSpool *spool,
+                        RingSMSSpoolFunc *func,
+                        gpointer user_data)
+{
+  GArray *ids;
+  gsize offset;
+  guint i;
+
+  if (spool == NULL)
+    return;
+
+  /* func may remove messages, so collect the ids first */
+  ids = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  for (offset = SLOT_SIZE;
+       offset < spool->end;
+       offset += record_at (spool, offset)->n_slots * SLOT_SIZE)
+    {
+      RingSMSSpoolRecord *record = record_at (spool, offset);
+
+      if (record->type == RECORD_QUEUED &&
+          g_hash_table_lookup (spool->live, GUINT_TO_POINTER (record->id))
+          == GSIZE_TO_POINTER (offset))
+        g_array_append_val (ids, record->id);
+    }
+
+  for (i = 0; i < ids->len; i++)
+    {
+      guint id = g_array_index (ids, guint, i);
+      gpointer value = g_hash_table_lookup (spool->live,
+          GUINT_TO_POINTER (id));
+      RingSMSSpoolRecord *record;
+      char const *destination, *text, *token;
+
+      if (value == NULL)
+        continue;
+
+      record = record_at (spool, GPOINTER_TO_SIZE (value));
+      destination = record->payload;
+      text = destination + strlen (destination) + 1;
+      token = text + strlen (text) + 1;
+
+      /* Records written before tokens were stored end after the text */
+      if (token >= record->payload + record->length)
+        token = "";
+
+      func (id, destination, text, token, record->flags, user_data);
+    }
+
+  g_array_free (ids, TRUE);
+}
+
+/* ---------------------------------------------------------------------- */
+
+/** Write dirty pages to disk */
+void
+ring_sms_spool_sync (RingSMSSpool *spool)
+{
+  gsize page = sysconf (_SC_PAGESIZE);
+  gsize start;
+
+  if (spool == NULL || spool->map == NULL || spool->dirty >= spool->end)
+    return;
+
+  start = spool->dirty / page * page;
+
+  if (msync (spool->map + start, spool->end - start, MS_SYNC) < 0)
+    DEBUG ("%s: msync: %s", spool->path, g_strerror (errno));
+
+  spool->dirty = spool->end;
+}
+
+/* Replace the spool file with @content.
+ *
+ * The new file is written under a temporary name, synced and renamed
+ * over the old one, like g_file_set_contents() does, but it is created
+ * with mode 0600 as the spool file itself is.
+ */
+static gboolean
+ring_sms_spool_replace (RingSMSSpool *spool,
+                        GString const *content,
+                        GError **error)
+{
+  char *tmp = g_strdup_printf ("%s.new", spool->path);
+  gsize done;
+  int fd, saved;
+
+  fd = g_open (tmp, O_WRONLY | O_CREAT | O_EXCL, 0600);
+  if (fd < 0 && errno == EEXIST)
+    {
+      /* Left over by a crash during an earlier compaction */
+      g_unlink (tmp);
+      fd = g_open (tmp, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    }
+  if (fd < 0)
+    goto failed;
+
+  for (done = 0; done < content->len;)
+    {
+      gssize n = write (fd, content->str + done, content->len - done);
+
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        goto failed;
+      done += n;
+    }
+
+  if (fsync (fd) < 0)
+    goto failed;
+
+  if (close (fd) < 0)
+    {
+      fd = -1;
+      goto failed;
+    }
+  fd = -1;
+
+  if (g_rename (tmp, spool->path) < 0)
+    goto failed;
+
+  g_free (tmp);
+  return TRUE;
+
+ failed:
+  saved = errno;
+  if (fd >= 0)
+    close (fd);
+  g_unlink (tmp);
+  g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved),
+      "%s: %s", tmp, g_strerror (saved));
+  g_free (tmp);
+  return FALSE;
+}
+
+/** Rewrite spool file without the messages that are done. */
+gboolean
+ring_sms_spool_compact (RingSMSSpool *spool,
+                        GError **error)
+{
+  GString *content;
+  RingSMSSpoolHeader header = { RING_SMS_SPOOL_MAGIC, SLOT_SIZE };
+  gsize offset;
+  gboolean ok;
+
+  content = g_string_sized_new ((1 + spool->live_slots) * SLOT_SIZE);
+
+  g_string_append_len (content, (char const *)&header, sizeof header);
+  g_string_set_size (content, SLOT_SIZE);
+  memset (content->str + sizeof header, 0, SLOT_SIZE - sizeof header);
+
+  for (offset = SLOT_SIZE;
+       offset < spool->end;
+       offset += record_at (spool, offset)->n_slots * SLOT_SIZE)
+    {
+      RingSMSSpoolRecord *record = record_at (spool, offset);
+
+      if (record->type == RECORD_QUEUED &&
+          g_hash_table_lookup (spool->live, GUINT_TO_POINTER (record->id))
+          == GSIZE_TO_POINTER (offset))
+        g_string_append_len (content, (char const *)record,
+            record->n_slots * SLOT_SIZE);
+    }
+
+  ok = ring_sms_spool_replace (spool, content, error);
+
+  g_string_free (content, TRUE);
+
+  if (!ok)
+    return FALSE;
+
+  ring_sms_spool_unmap (spool);
+
+  return ring_sms_spool_map (spool, error);
+}
+
+static gboolean
+ring_sms_spool_sync_cb (gpointer _spool)
+{
+  RingSMSSpool *spool = _spool;
+  GError *error = NULL;
+
+  spool->sync_source = 0;
+
+  ring_sms_spool_sync (spool);
+
+  if (spool->dead_slots >= COMPACT_SLOTS &&
+      spool->dead_slots > spool->live_slots)
+    {
+      DEBUG ("%s: compacting %u done and %u queued slots", spool->path,
+          spool->dead_slots, spool->live_slots);
+
+      if (!ring_sms_spool_compact (spool, &error))
+        {
+          DEBUG ("%s", error->message);
+          g_error_free (error);
+        }
+    }
+
+  return FALSE;
+}
@@ -0,0 +1,57 @@
+/*
+ * ring-sms-spool.h - Persistent spool for outgoing SMS
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef RING_SMS_SPOOL_H
+#define RING_SMS_SPOOL_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _RingSMSSpool RingSMSSpool;
+
+typedef void RingSMSSpoolFunc (guint id,
+    char const *destination,
+    char const *text,
+    char const *token,
+    guint flags,
+    gpointer user_data);
+
+RingSMSSpool *ring_sms_spool_open (char const *path, GError **error);
+void ring_sms_spool_close (RingSMSSpool *spool);
+
+guint ring_sms_spool_append (RingSMSSpool *spool,
+    char const *destination,
+    char const *text,
+    char const *token,
+    guint flags);
+void ring_sms_spool_remove (RingSMSSpool *spool, guint id);
+
+guint ring_sms_spool_size (RingSMSSpool const *spool);
+void ring_sms_spool_foreach (RingSMSSpool *spool,
+    RingSMSSpoolFunc *func,
+    gpointer user_data);
+
+void ring_sms_spool_sync (RingSMSSpool *spool);
+gboolean ring_sms_spool_compact (RingSMSSpool *spool, GError **error);
+
+G_END_DECLS
+
+#endif /* RING_SMS_SPOOL_H */
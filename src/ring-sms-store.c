@@ -0,0 +1,833 @@
+/*
+ * ring-sms-store.c - Store for received SMS
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Received messages are kept in an append-only file until a client has
+ * saved them and expunges them. A message is written as one record, and
+ * each batch of expunged messages as another record listing their
+ * tokens. The records are checksummed, so a record torn by a crash ends
+ * the scan on the next startup and is cut off.
+ *
+ * Only the index is kept in memory: the messages by token, by sender
+ * and in the order they were received, each with the location of its
+ * record. The text is read from the file when it is needed. The file
+ * is synced from a timer, and rewritten without the expunged messages
+ * once they take up most of it.
+ */
+
+#include "config.h"
+
+#define DEBUG_FLAG RING_DEBUG_SMS
+#include "ring-debug.h"
+
+#include "ring-sms-store.h"
+
+#include <glib/gstdio.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RING_SMS_STORE_MAGIC "RingSto1"
+#define HEADER_SIZE (8)
+
+#define SYNC_INTERVAL (100)           /* Milliseconds */
+#define COMPACT_BYTES (64 * 1024)
+
+enum {
+  RECORD_STORED = 0x53544f52,   /* "STOR" */
+  RECORD_EXPUNGED = 0x45585055, /* "EXPU" */
+};
+
+typedef struct {
+  guint32 type;
+  guint32 length;               /* Payload following the record */
+  gint64 sent, received;
+  guint32 reserved;
+  guint32 checksum;
+} RingSMSStoreRecord;
+
+/* Stored payload is token NUL sender NUL text NUL,
+ * expunged payload is token NUL token NUL ... */
+
+typedef struct {
+  char *token;
+  char *sender;
+  gint64 sent, received;
+  goffset offset;               /* Record in file */
+  gsize size;                   /* Record with its payload */
+  GList by_order[1], by_sender[1];
+} RingSMSStoreEntry;
+
+struct _RingSMSStore
+{
+  char *path;
+  int fd;
+  goffset end;                  /* Offset of next record */
+
+  /* token => RingSMSStoreEntry */
+  GHashTable *by_token;
+  /* sender => GQueue of entries, oldest first */
+  GHashTable *by_sender;
+  /* All entries, oldest first */
+  GQueue order[1];
+
+  gsize live_bytes, dead_bytes;
+
+  guint sync_source;
+};
+
+static gboolean ring_sms_store_load (RingSMSStore *, GError **);
+static void ring_sms_store_unload (RingSMSStore *);
+static gboolean ring_sms_store_sync_cb (gpointer);
+
+/* ---------------------------------------------------------------------- */
+
+static guint32
+record_checksum (RingSMSStoreRecord const *record,
+                 char const *payload)
+{
+  /* FNV-1a over fields before checksum and the payload */
+  guint8 const *p = (guint8 const *)record;
+  guint32 hash = 2166136261U;
+  gsize i;
+
+  for (i = 0; i < G_STRUCT_OFFSET (RingSMSStoreRecord, checksum); i++)
+    hash = (hash ^ p[i]) * 16777619U;
+
+  p = (guint8 const *)payload;
+  for (i = 0; i < record->length; i++)
+    hash = (hash ^ p[i]) * 16777619U;
+
+  return hash;
+}
+
+/* Start a record; the payload is appended to the returned buffer */
+static GString *
+record_new (void)
+{
+  GString *buffer = g_string_sized_new (256);
+
+  g_string_set_size (buffer, sizeof (RingSMSStoreRecord));
+  memset (buffer->str, 0, sizeof (RingSMSStoreRecord));
+
+  return buffer;
+}
+
+static void
+record_append (GString *buffer,
+               char const *s)
+{
+  g_string_append_len (buffer, s, strlen (s) + 1);
+}
+
+static gboolean
+record_write (RingSMSStore *store,
+              GString *buffer,
+              guint32 type,
+              gint64 sent,
+              gint64 received)
+{
+  RingSMSStoreRecord record = { 0 };
+  gssize n;
+
+  record.type = type;
+  record.length = buffer->len - sizeof record;
+  record.sent = sent;
+  record.received = received;
+  record.checksum = record_checksum (&record, buffer->str + sizeof record);
+  memcpy (buffer->str, &record, sizeof record);
+
+  do
+    n = pwrite (store->fd, buffer->str, buffer->len, store->end);
+  while (n < 0 && errno == EINTR);
+
+  if (n != (gssize)buffer->len)
+    {
+      DEBUG ("%s: write: %s", store->path,
+          n < 0 ? g_strerror (errno) : "short write");
+      if (ftruncate (store->fd, store->end) < 0)
+        DEBUG ("%s: truncate: %s", store->path, g_strerror (errno));
+      return FALSE;
+    }
+
+  store->end += buffer->len;
+
+  if (store->sync_source == 0)
+    store->sync_source =
+      g_timeout_add (SYNC_INTERVAL, ring_sms_store_sync_cb, store);
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Index */
+
+static void
+entry_free (gpointer _entry)
+{
+  RingSMSStoreEntry *entry = _entry;
+
+  g_free (entry->token);
+  g_free (entry->sender);
+  g_slice_free (RingSMSStoreEntry, entry);
+}
+
+/* The links are part of the entries, so the queue must not free them */
+static void
+sender_queue_free (gpointer queue)
+{
+  g_slice_free (GQueue, queue);
+}
+
+static void
+ring_sms_store_index (RingSMSStore *store,
+                      RingSMSStoreEntry *entry)
+{
+  GQueue *queue;
+
+  queue = g_hash_table_lookup (store->by_sender, entry->sender);
+  if (queue == NULL)
+    {
+      queue = g_slice_new0 (GQueue);
+      g_hash_table_insert (store->by_sender, g_strdup (entry->sender), queue);
+    }
+
+  entry->by_order->data = entry;
+  entry->by_sender->data = entry;
+  g_queue_push_tail_link (store->order, entry->by_order);
+  g_queue_push_tail_link (queue, entry->by_sender);
+
+  g_hash_table_insert (store->by_token, entry->token, entry);
+
+  store->live_bytes += entry->size;
+}
+
+/* Remove entry from index and return its token */
+static char *
+ring_sms_store_forget (RingSMSStore *store,
+                       RingSMSStoreEntry *entry)
+{
+  GQueue *queue;
+  char *token;
+
+  queue = g_hash_table_lookup (store->by_sender, entry->sender);
+  g_queue_unlink (queue, entry->by_sender);
+  if (g_queue_is_empty (queue))
+    g_hash_table_remove (store->by_sender, entry->sender);
+
+  g_queue_unlink (store->order, entry->by_order);
+  g_hash_table_steal (store->by_token, entry->token);
+
+  store->live_bytes -= entry->size;
+  store->dead_bytes += entry->size;
+
+  token = entry->token, entry->token = NULL;
+  entry_free (entry);
+
+  return token;
+}
+
+/* ---------------------------------------------------------------------- */
+
+RingSMSStore *
+ring_sms_store_open (char const *path,
+                     GError **error)
+{
+  RingSMSStore *store = g_slice_new0 (RingSMSStore);
+
+  store->path = g_strdup (path);
+  store->fd = -1;
+  store->by_token = g_hash_table_new_full (g_str_hash, g_str_equal,
+      NULL, entry_free);
+  store->by_sender = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, sender_queue_free);
+  g_queue_init (store->order);
+
+  if (!ring_sms_store_load (store, error))
+    {
+      ring_sms_store_close (store);
+      return NULL;
+    }
+
+  DEBUG ("%s: %u stored messages", path, ring_sms_store_size (store));
+
+  return store;
+}
+
+void
+ring_sms_store_close (RingSMSStore *store)
+{
+  if (store == NULL)
+    return;
+
+  if (store->sync_source)
+    g_source_remove (store->sync_source);
+
+  ring_sms_store_sync (store);
+  ring_sms_store_unload (store);
+
+  g_hash_table_destroy (store->by_token);
+  g_hash_table_destroy (store->by_sender);
+  g_free (store->path);
+
+  g_slice_free (RingSMSStore, store);
+}
+
+/* Apply a valid record read from file */
+static void
+ring_sms_store_replay (RingSMSStore *store,
+                       RingSMSStoreRecord const *record,
+                       char const *payload,
+                       goffset offset)
+{
+  gsize size = sizeof *record + record->length;
+  char const *end = payload + record->length;
+  char const *s;
+
+  if (record->type == RECORD_STORED)
+    {
+      RingSMSStoreEntry *entry, *old;
+      char const *sender = payload + strlen (payload) + 1;
+
+      if (sender >= end || sender + strlen (sender) + 1 >= end)
+        {
+          store->dead_bytes += size;
+          return;
+        }
+
+      old = g_hash_table_lookup (store->by_token, payload);
+      if (old)
+        g_free (ring_sms_store_forget (store, old));
+
+      entry = g_slice_new0 (RingSMSStoreEntry);
+      entry->token = g_strdup (payload);
+      entry->sender = g_strdup (sender);
+      entry->sent = record->sent;
+      entry->received = record->received;
+      entry->offset = offset;
+      entry->size = size;
+
+      ring_sms_store_index (store, entry);
+    }
+  else
+    {
+      for (s = payload; s < end; s += strlen (s) + 1)
+        {
+          RingSMSStoreEntry *entry = g_hash_table_lookup (store->by_token, s);
+
+          if (entry)
+            g_free (ring_sms_store_forget (store, entry));
+        }
+
+      store->dead_bytes += size;
+    }
+}
+
+static gboolean
+ring_sms_store_load (RingSMSStore *store,
+                     GError **error)
+{
+  struct stat st;
+  char *content = NULL;
+  gsize offset, length;
+  gssize n;
+
+  store->fd = g_open (store->path, O_RDWR | O_CREAT, 0600);
+  if (store->fd < 0 || fstat (store->fd, &st) < 0)
+    goto error;
+
+  /* Earlier versions replaced the file with the default mode */
+  if ((st.st_mode & 077) != 0 && fchmod (store->fd, 0600) < 0)
+    DEBUG ("%s: fchmod: %s", store->path, g_strerror (errno));
+
+  length = st.st_size;
+
+  if (length == 0)
+    {
+      if (pwrite (store->fd, RING_SMS_STORE_MAGIC, HEADER_SIZE, 0)
+          != HEADER_SIZE)
+        goto error;
+      store->end = HEADER_SIZE;
+      return TRUE;
+    }
+
+  content = g_malloc (length);
+  n = pread (store->fd, content, length, 0);
+  if (n < 0)
+    goto error;
+  length = n;
+
+  if (length < HEADER_SIZE ||
+      memcmp (content, RING_SMS_STORE_MAGIC, HEADER_SIZE))
+    {
+      g_free (content);
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+          "%s: not a message store", store->path);
+      return FALSE;
+    }
+
+  for (offset = HEADER_SIZE; offset + sizeof (RingSMSStoreRecord) <= length;)
+    {
+      RingSMSStoreRecord record;
+      char const *payload = content + offset + sizeof record;
+
+      memcpy (&record, content + offset, sizeof record);
+
+      if (record.type != RECORD_STORED && record.type != RECORD_EXPUNGED)
+        break;
+      if (record.length == 0 ||
+          record.length > length - offset - sizeof record ||
+          payload[record.length - 1] != '\0')
+        break;
+      if (record.checksum != record_checksum (&record, payload))
+        break;
+
+      ring_sms_store_replay (store, &record, payload, offset);
+
+      offset += sizeof record + record.length;
+    }
+
+  g_free (content);
+
+  if (offset < length)
+    {
+      DEBUG ("%s: dropping %" G_GSIZE_FORMAT " bytes after offset %"
+          G_GSIZE_FORMAT, store->path, length - offset, offset);
+      if (ftruncate (store->fd, offset) < 0)
+        goto error;
+    }
+
+  store->end = offset;
+
+  return TRUE;
+
+ error:
+  g_free (content);
+  g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+      "%s: %s", store->path, g_strerror (errno));
+  return FALSE;
+}
+
+static void
+ring_sms_store_unload (RingSMSStore *store)
+{
+  if (store->fd >= 0)
+    close (store->fd);
+  store->fd = -1;
+
+  g_queue_init (store->order);
+  g_hash_table_remove_all (store->by_sender);
+  g_hash_table_remove_all (store->by_token);
+  store->live_bytes = store->dead_bytes = 0;
+  store->end = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+/** Store a received message under its token. */
+gboolean
+ring_sms_store_add (RingSMSStore *store,
+                    char const *token,
+                    char const *sender,
+                    char const *text,
+                    gint64 sent,
+                    gint64 received)
+{
+  RingSMSStoreEntry *entry, *old;
+  GString *buffer;
+  goffset offset;
+
+  if (store == NULL)
+    return FALSE;
+
+  g_return_val_if_fail (token != NULL && token[0], FALSE);
+  g_return_val_if_fail (sender != NULL, FALSE);
+  g_return_val_if_fail (text != NULL, FALSE);
+
+  buffer = record_new ();
+  record_append (buffer, token);
+  record_append (buffer, sender);
+  record_append (buffer, text);
+
+  offset = store->end;
+
+  if (!record_write (store, buffer, RECORD_STORED, sent, received))
+    {
+      g_string_free (buffer, TRUE);
+      return FALSE;
+    }
+
+  old = g_hash_table_lookup (store->by_token, token);
+  if (old)
+    g_free (ring_sms_store_forget (store, old));
+
+  entry = g_slice_new0 (RingSMSStoreEntry);
+  entry->token = g_strdup (token);
+  entry->sender = g_strdup (sender);
+  entry->sent = sent;
+  entry->received = received;
+  entry->offset = offset;
+  entry->size = buffer->len;
+
+  ring_sms_store_index (store, entry);
+
+  g_string_free (buffer, TRUE);
+
+  return TRUE;
+}
+
+gboolean
+ring_sms_store_contains (RingSMSStore const *store,
+                         char const *token)
+{
+  return store && g_hash_table_lookup (store->by_token, token) != NULL;
+}
+
+/** Read a stored message and call func with it.
+ *
+ * @retval FALSE if there is no such message
+ */
+gboolean
+ring_sms_store_get (RingSMSStore *store,
+                    char const *token,
+                    RingSMSStoreFunc *func,
+                    gpointer user_data)
+{
+  RingSMSStoreEntry *entry;
+  char *buffer, *payload, *text;
+  gssize n;
+
+  if (store == NULL)
+    return FALSE;
+
+  entry = g_hash_table_lookup (store->by_token, token);
+  if (entry == NULL)
+    return FALSE;
+
+  buffer = g_malloc (entry->size);
+
+  n = pread (store->fd, buffer, entry->size, entry->offset);
+  if (n != (gssize)entry->size)
+    {
+      DEBUG ("%s: read: %s", store->path,
+          n < 0 ? g_strerror (errno) : "short read");
+      g_free (buffer);
+      return FALSE;
+    }
+
+  payload = buffer + sizeof (RingSMSStoreRecord);
+  text = payload + strlen (entry->token) + 1 + strlen (entry->sender) + 1;
+
+  func (entry->token, entry->sender, text,
+      entry->sent, entry->received, user_data);
+
+  g_free (buffer);
+
+  return TRUE;
+}
+
+/** Remove messages from store.
+ *
+ * The messages are removed with one write, whatever their number.
+ *
+ * @return NULL-terminated array with the tokens of removed messages
+ */
+char **
+ring_sms_store_expunge (RingSMSStore *store,
+                        char const * const *tokens)
+{
+  GPtrArray *expunged = g_ptr_array_new ();
+  GString *buffer;
+  guint i;
+
+  if (store == NULL || tokens == NULL)
+    goto done;
+
+  buffer = record_new ();
+
+  for (i = 0; tokens[i]; i++)
+    {
+      RingSMSStoreEntry *entry = g_hash_table_lookup (store->by_token,
+          tokens[i]);
+
+      if (entry == NULL)
+        continue;
+
+      record_append (buffer, entry->token);
+      g_ptr_array_add (expunged, ring_sms_store_forget (store, entry));
+    }
+
+  if (expunged->len)
+    {
+      if (record_write (store, buffer, RECORD_EXPUNGED, 0, 0))
+        store->dead_bytes += buffer->len;
+      /* Otherwise they are found again when the file is next loaded */
+    }
+
+  g_string_free (buffer, TRUE);
+
+ done:
+  g_ptr_array_add (expunged, NULL);
+
+  return (char **)g_ptr_array_free (expunged, FALSE);
+}
+
+/** Remove all messages from sender.
+ *
+ * @return NULL-terminated array with the tokens of removed messages
+ */
+char **
+ring_sms_store_expunge_sender (RingSMSStore *store,
+                               char const *sender)
+{
+  char **tokens = ring_sms_store_list_sender (store, sender);
+  char **expunged = ring_sms_store_expunge (store,
+      (char const * const *)tokens);
+
+  g_strfreev (tokens);
+
+  return expunged;
+}
+
+/** Remove the oldest messages, so that at most @a max_size are left and
+ * none of them was received before @a received_before.
+ *
+ * @return NULL-terminated array with the tokens of removed messages
+ */
+char **
+ring_sms_store_expunge_old (RingSMSStore *store,
+                            guint max_size,
+                            gint64 received_before)
+{
+  GPtrArray *tokens = g_ptr_array_new_with_free_func (g_free);
+  char **expunged;
+  GList *link;
+  guint size = ring_sms_store_size (store);
+
+  if (store)
+    for (link = store->order->head; link; link = link->next, size--)
+      {
+        RingSMSStoreEntry *entry = link->data;
+
+        if (size <= max_size && entry->received >= received_before)
+          break;
+
+        g_ptr_array_add (tokens, g_strdup (entry->token));
+      }
+
+  g_ptr_array_add (tokens, NULL);
+
+  expunged = ring_sms_store_expunge (store,
+      (char const * const *)tokens->pdata);
+
+  g_ptr_array_free (tokens, TRUE);
+
+  return expunged;
+}
+
+/** Number of messages in store */
+guint
+ring_sms_store_size (RingSMSStore const *store)
+{
+  return store ? g_hash_table_size (store->by_token) : 0;
+}
+
+static char **
+list_tokens (GQueue const *queue)
+{
+  char **tokens;
+  GList *link;
+  guint i = 0;
+
+  tokens = g_new (char *, (queue ? queue->length : 0) + 1);
+
+  if (queue)
+    for (link = queue->head; link; link = link->next)
+      tokens[i++] = g_strdup (((RingSMSStoreEntry *)link->data)->token);
+
+  tokens[i] = NULL;
+
+  return tokens;
+}
+
+/** List tokens of stored messages, oldest first. */
+char **
+ring_sms_store_list (RingSMSStore const *store)
+{
+  return list_tokens (store ? store->order : NULL);
+}
+
+/** List tokens of messages from sender, oldest first. */
+char **
+ring_sms_store_list_sender (RingSMSStore const *store,
+                            char const *sender)
+{
+  return list_tokens (store
+      ? g_hash_table_lookup (store->by_sender, sender)
+      : NULL);
+}
+
+/* ---------------------------------------------------------------------- */
+
+/** Write stored messages to disk */
+void
+ring_sms_store_sync (RingSMSStore *store)
+{
+  if (store == NULL || store->fd < 0)
+    return;
+
+  if (fdatasync (store->fd) < 0)
+    DEBUG ("%s: fdatasync: %s", store->path, g_strerror (errno));
+}
+
+/* Replace the store file with @content.
+ *
+ * The new file is written under a temporary name, synced and renamed
+ * over the old one, like g_file_set_contents() does, but it is created
+ * with mode 0600 as the store file itself is.
+ */
+static gboolean
+ring_sms_store_replace (RingSMSStore *store,
+                        GString const *content,
+                        GError **error)
+{
+  char *tmp = g_strdup_printf ("%s.new", store->path);
+  gsize done;
+  int fd, saved;
+
+  fd = g_open (tmp, O_WRONLY | O_CREAT | O_EXCL, 0600);
+  if (fd < 0 && errno == EEXIST)
+    {
+      /* Left over by a crash during an earlier compaction */
+      g_unlink (tmp);
+      fd = g_open (tmp, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    }
+  if (fd < 0)
+    goto failed;
+
+  for (done = 0; done < content->len;)
+    {
+      gssize n = write (fd, content->str + done, content->len - done);
+
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0)
+        goto failed;
+      done += n;
+    }
+
+  if (fsync (fd) < 0)
+    goto failed;
+
+  if (close (fd) < 0)
+    {
+      fd = -1;
+      goto failed;
+    }
+  fd = -1;
+
+  if (g_rename (tmp, store->path) < 0)
+    goto failed;
+
+  g_free (tmp);
+  return TRUE;
+
+ failed:
+  saved = errno;
+  if (fd >= 0)
+    close (fd);
+  g_unlink (tmp);
+  g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved),
+      "%s: %s", tmp, g_strerror (saved));
+  g_free (tmp);
+  return FALSE;
+}
+
+/** Rewrite store file without the expunged messages. */
+gboolean
+ring_sms_store_compact (RingSMSStore *store,
+                        GError **error)
+{
+  GString *content;
+  GList *link;
+  gboolean ok;
+
+  content = g_string_sized_new (HEADER_SIZE + store->live_bytes);
+  g_string_append_len (content, RING_SMS_STORE_MAGIC, HEADER_SIZE);
+
+  for (link = store->order->head; link; link = link->next)
+    {
+      RingSMSStoreEntry *entry = link->data;
+      gsize len = content->len;
+
+      g_string_set_size (content, len + entry->size);
+
+      if (pread (store->fd, content->str + len, entry->size, entry->offset)
+          != (gssize)entry->size)
+        {
+          g_string_free (content, TRUE);
+          g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+              "%s: %s", store->path, g_strerror (errno));
+          return FALSE;
+        }
+    }
+
+  ok = ring_sms_store_replace (store, content, error);
+
+  g_string_free (content, TRUE);
+
+  if (!ok)
+    return FALSE;
+
+  ring_sms_store_unload (store);
+
+  return ring_sms_store_load (store, error);
+}
+
+static gboolean
+ring_sms_store_sync_cb (gpointer _store)
+{
+  RingSMSStore *store = _store;
+  GError *error = NULL;
+
+  store->sync_source = 0;
+
+  ring_sms_store_sync (store);
+
+  if (store->dead_bytes >= COMPACT_BYTES &&
+      store->dead_bytes > store->live_bytes)
+    {
+      DEBUG ("%s: compacting %" G_GSIZE_FORMAT " expunged and %"
+          G_GSIZE_FORMAT " stored bytes", store->path,
+          store->dead_bytes, store->live_bytes);
+
+      if (!ring_sms_store_compact (store, &error))
+        {
+          DEBUG ("%s", error->message);
+          g_error_free (error);
+        }
+    }
+
+  return FALSE;
+}
@@ -0,0 +1,72 @@
+/*
+ * ring-sms-store.h - Store for received SMS
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef RING_SMS_STORE_H
+#define RING_SMS_STORE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _RingSMSStore RingSMSStore;
+
+typedef void RingSMSStoreFunc (char const *token,
+    char const *sender,
+    char const *text,
+    gint64 sent,
+    gint64 received,
+    gpointer user_data);
+
+RingSMSStore *ring_sms_store_open (char const *path, GError **error);
+void ring_sms_store_close (RingSMSStore *store);
+
+gboolean ring_sms_store_add (RingSMSStore *store,
+    char const *token,
+    char const *sender,
+    char const *text,
+    gint64 sent,
+    gint64 received);
+
+gboolean ring_sms_store_contains (RingSMSStore const *store,
+    char const *token);
+gboolean ring_sms_store_get (RingSMSStore *store,
+    char const *token,
+    RingSMSStoreFunc *func,
+    gpointer user_data);
+
+char **ring_sms_store_expunge (RingSMSStore *store,
+    char const * const *tokens);
+char **ring_sms_store_expunge_sender (RingSMSStore *store,
+    char const *sender);
+char **ring_sms_store_expunge_old (RingSMSStore *store,
+    guint max_size,
+    gint64 received_before);
+
+guint ring_sms_store_size (RingSMSStore const *store);
+char **ring_sms_store_list (RingSMSStore const *store);
+char **ring_sms_store_list_sender (RingSMSStore const *store,
+    char const *sender);
+
+void ring_sms_store_sync (RingSMSStore *store);
+gboolean ring_sms_store_compact (RingSMSStore *store, GError **error);
+
+G_END_DECLS
+
+#endif /* RING_SMS_STORE_H */
@@ -41,6 +41,7 @@
 #include <telepathy-glib/svc-generic.h>
 
 #include <modem/sms.h>
+#include <modem/sms-codec.h>
 #include <modem/errors.h>
 #include <modem/call.h>
 
@@ -56,6 +57,7 @@
 #include <string.h>
 
 static void ring_text_channel_destroyable_iface_init(gpointer, gpointer);
+static void ring_text_channel_sms_length_iface_init(gpointer, gpointer);
 
 G_DEFINE_TYPE_WITH_CODE (RingTextChannel, ring_text_channel,
     TP_TYPE_BASE_CHANNEL,
@@ -64,6 +66,8 @@ G_DEFINE_TYPE_WITH_CODE (RingTextChannel, ring_text_channel,
     G_IMPLEMENT_INTERFACE (TP_TYPE_SVC_CHANNEL_INTERFACE_DESTROYABLE,
         ring_text_channel_destroyable_iface_init);
     G_IMPLEMENT_INTERFACE (TP_TYPE_SVC_CHANNEL_INTERFACE_SMS, NULL);
+    G_IMPLEMENT_INTERFACE (RING_TYPE_SVC_CHANNEL_INTERFACE_SMS_LENGTH,
+        ring_text_channel_sms_length_iface_init);
     G_IMPLEMENT_INTERFACE (TP_TYPE_SVC_CHANNEL_INTERFACE_MESSAGES,
         tp_message_mixin_messages_iface_init));
 
@@ -71,6 +75,7 @@ static const char * const ring_text_channel_interfaces[] = {
   TP_IFACE_CHANNEL_INTERFACE_DESTROYABLE,
   TP_IFACE_CHANNEL_INTERFACE_MESSAGES,
   TP_IFACE_CHANNEL_INTERFACE_SMS,
+  RING_IFACE_CHANNEL_INTERFACE_SMS_LENGTH,
   NULL
 };
 
@@ -82,6 +87,7 @@ enum
 
   PROP_SMS_FLASH,
   PROP_SMS_CHANNEL,
+  PROP_TEXT_MANAGER,
 
   N_PROPS
 };
@@ -90,7 +96,11 @@ struct _RingTextChannelPrivate
 {
   char *destination;
 
-  GQueue sending[1];
+  /* Not referenced, the manager disposes its channels */
+  RingTextManager *manager;
+
+  GQueue queued[1];             /* RingQueuedMessage waiting for manager */
+  GQueue sending[1];            /* ModemRequest submitted to modem */
 
   unsigned sms_flash:1;         /* c.n.T.Channel.Interface.SMS.Flash */
   unsigned :0;
@@ -109,6 +119,22 @@ static void ring_text_channel_set_receive_timestamps(RingTextChannel *self,
 #endif
 /* Sending */
 
+typedef struct {
+  TpMessage *msg;               /* NULL if resent from spool */
+  TpMessageSendingFlags flags;
+  guint spool_id;
+  char token[RING_TOKEN_LENGTH]; /* Message token kept in spool */
+  char *text;                   /* Message text if resent from spool */
+} RingQueuedMessage;
+
+static void ring_text_channel_flush_queued(RingTextChannel *self);
+static void ring_text_channel_flush_sending(RingTextChannel *self);
+static void ring_text_channel_delivery_report(RingTextChannel *self,
+  char const *token,
+  guint delivery_status,
+  gpointer sr,
+  GError const *error);
+
 static void modem_sms_request_send_reply(ModemSMSService *,
   ModemRequest *request,
   char const *token,
@@ -155,6 +181,7 @@ ring_text_channel_init(RingTextChannel *self)
 {
   self->priv = G_TYPE_INSTANCE_GET_PRIVATE(
     self, RING_TYPE_TEXT_CHANNEL, RingTextChannelPrivate);
+  g_queue_init(self->priv->queued);
   g_queue_init(self->priv->sending);
 }
 
@@ -249,6 +276,10 @@ ring_text_channel_set_property(GObject *object,
       priv->sms_flash = g_value_get_boolean(value);
       break;
 
+    case PROP_TEXT_MANAGER:
+      priv->manager = g_value_get_pointer(value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -261,8 +292,20 @@ ring_text_channel_dispose(GObject *object)
   RingTextChannel *self = RING_TEXT_CHANNEL (object);
   RingTextChannelPrivate *priv = self->priv;
 
-  while (!g_queue_is_empty (priv->sending))
-    modem_request_cancel (g_queue_pop_head (priv->sending));
+  if (priv->manager)
+    {
+      guint n_queued = g_queue_get_length (priv->queued);
+      guint n_sending = g_queue_get_length (priv->sending);
+
+      ring_text_channel_flush_queued (self);
+      ring_text_channel_flush_sending (self);
+      ring_text_manager_unschedule (priv->manager, self,
+          n_queued, n_sending);
+      priv->manager = NULL;
+    }
+
+  ring_text_channel_flush_queued (self);
+  ring_text_channel_flush_sending (self);
 
   ((GObjectClass *)ring_text_channel_parent_class)->dispose (object);
 }
@@ -334,6 +377,14 @@ ring_text_channel_class_init(RingTextChannelClass *klass)
           G_PARAM_READABLE |
           G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (object_class,
+      PROP_TEXT_MANAGER,
+      g_param_spec_pointer ("text-manager",
+          "Text channel manager",
+          "The manager scheduling outgoing messages of this channel",
+          G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY |
+          G_PARAM_STATIC_STRINGS));
+
   ring_text_base_channel_class_init (klass);
 
   if (properties_initialized)
@@ -434,6 +485,48 @@ ring_text_channel_destroyable_iface_init (gpointer iface,
 #undef IMPLEMENT
 }
 
+/* ====================================================================== */
+/* Channel.Interface.SMSLength */
+
+static char const *
+ring_text_channel_sms_encoding(ModemSMSLength const *length)
+{
+  return length->alphabet == MODEM_SMS_ALPHABET_GSM7 ? "gsm7" : "ucs2";
+}
+
+static void
+ring_text_channel_method_get_length(RingSvcChannelInterfaceSMSLength *iface,
+  char const *text,
+  DBusGMethodInvocation *context)
+{
+  ModemSMSLength length[1];
+
+  if (!modem_sms_length(text, length)) {
+    GError error[1] = {{
+        TP_ERROR, TP_ERROR_INVALID_ARGUMENT, "Text is not valid UTF-8"
+      }};
+    dbus_g_method_return_error(context, error);
+    return;
+  }
+
+  ring_svc_channel_interface_sms_length_return_from_get_length(context,
+    length->segments, length->units, length->remaining,
+    ring_text_channel_sms_encoding(length));
+}
+
+static void
+ring_text_channel_sms_length_iface_init (gpointer iface,
+                                         gpointer data)
+{
+  RingSvcChannelInterfaceSMSLengthClass *klass = iface;
+
+#define IMPLEMENT(x)                                    \
+  ring_svc_channel_interface_sms_length_implement_##x   \
+    (klass, ring_text_channel_method_ ## x)
+  IMPLEMENT(get_length);
+#undef IMPLEMENT
+}
+
 /* ---------------------------------------------------------------------- */
 /* message_mixin interface */
 
@@ -548,8 +641,8 @@ ring_text_channel_send(GObject *_self,
 #endif
   char const *type;
   char const *text;
-  ModemRequest *request;
-  GError *error;
+  RingQueuedMessage *queued;
+  GError *error, *busy = NULL;
 
   g_assert(tp_message_count_parts(msg) >= 1);
 
@@ -594,8 +687,21 @@ ring_text_channel_send(GObject *_self,
   text = my_message_mixin_get_string(msg, 1, "content", "");
 
   if (g_strcasecmp(type, text_plain) == 0) {
+    ModemSMSLength length[1];
+
     DEBUG("Send(destination = %s," /*class = %u,*/ "text = \"%s\")",
       priv->destination, /*sms_class,*/ text);
+
+    /* The sent message tells how many SMSes the text was sent as, like
+     * SMSLength.GetLength() does before sending */
+    if (modem_sms_length(text, length)) {
+      char const *encoding = ring_text_channel_sms_encoding(length);
+
+      tp_message_set_uint32(msg, 0, "sms-segments", length->segments);
+      tp_message_set_string(msg, 0, "sms-encoding", encoding);
+      DEBUG("%u %s units in %u segments",
+        length->units, encoding, length->segments);
+    }
   }
 #if nomore
   else if (g_strcasecmp(type, "text/x-vcard") == 0 ||
@@ -618,21 +724,195 @@ ring_text_channel_send(GObject *_self,
     g_set_error(&error, TP_ERROR, TP_ERROR_INVALID_ARGUMENT, "Unknown content type");
   }
 
-  request = modem_sms_request_send (sms_service,
-      priv->destination, text,
-      modem_sms_request_send_reply, self);
+  if (error) {
+    DEBUG("Send(%p) GError(%u, '%s, %s)",
+      msg, error->code, g_quark_to_string(error->domain), error->message);
+    tp_message_mixin_sent(_self, msg, flags, NULL, error);
+    g_error_free(error);
+    return;
+  }
+
+  if (priv->manager && !ring_text_manager_can_queue(priv->manager, &busy)) {
+    tp_message_mixin_sent(_self, msg, flags, NULL, busy);
+    g_error_free(busy);
+    return;
+  }
+
+  queued = g_slice_new0(RingQueuedMessage);
+  queued->msg = msg;
+  queued->flags = flags;
+  ring_generate_token(queued->token);
+  if (priv->manager)
+    queued->spool_id = ring_text_manager_spool(priv->manager,
+      priv->destination, text, queued->token, flags);
+  g_queue_push_tail(priv->queued, queued);
+
+  if (priv->manager)
+    ring_text_manager_schedule(priv->manager, self);
+  else
+    ring_text_channel_submit_queued(self);
+}
+
+/** Queue a message that was left unsent in spool. */
+void
+ring_text_channel_requeue(RingTextChannel *self,
+  guint spool_id,
+  char const *token,
+  char const *text,
+  guint flags)
+{
+  RingTextChannelPrivate *priv = self->priv;
+  RingQueuedMessage *queued;
+
+  queued = g_slice_new0(RingQueuedMessage);
+  queued->flags = flags;
+  queued->spool_id = spool_id;
+  if (token[0])
+    g_strlcpy(queued->token, token, sizeof queued->token);
+  else
+    ring_generate_token(queued->token);
+  queued->text = g_strdup(text);
+  g_queue_push_tail(priv->queued, queued);
+
+  if (priv->manager)
+    ring_text_manager_schedule(priv->manager, self);
+  else
+    ring_text_channel_submit_queued(self);
+}
+
+/* Report the result of a message resent from spool.
+ *
+ * The report uses the message token stored in spool with the message.
+ */
+static void
+ring_text_channel_report_spooled(RingTextChannel *self,
+  char const *token,
+  GError const *error)
+{
+  if (error == NULL)
+    ring_text_channel_outgoing_sms_complete(self, token);
+  else
+    ring_text_channel_outgoing_sms_error(self, token, error);
+}
+
+gboolean
+ring_text_channel_has_queued(RingTextChannel const *self)
+{
+  return !g_queue_is_empty(self->priv->queued);
+}
+
+/** Submit the oldest queued message to the modem.
+ *
+ * @retval TRUE if the message was submitted
+ * @retval FALSE if sending failed immediately
+ */
+gboolean
+ring_text_channel_submit_queued(RingTextChannel *self)
+{
+  RingTextChannelPrivate *priv = self->priv;
+  RingQueuedMessage *queued = g_queue_pop_head(priv->queued);
+  ModemSMSService *sms_service;
+  TpMessage *msg;
+  TpMessageSendingFlags flags;
+  guint spool_id;
+  char token[RING_TOKEN_LENGTH];
+  ModemRequest *request = NULL;
+
+  g_return_val_if_fail(queued != NULL, FALSE);
+
+  msg = queued->msg, flags = queued->flags, spool_id = queued->spool_id;
+  memcpy(token, queued->token, sizeof token);
+
+  sms_service = ring_text_channel_get_sms_service (self);
+  if (sms_service)
+    request = modem_sms_request_send (sms_service,
+        priv->destination,
+        msg ? my_message_mixin_get_string(msg, 1, "content", "")
+        : queued->text,
+        modem_sms_request_send_reply, self);
+
+  g_free(queued->text);
+  g_slice_free(RingQueuedMessage, queued);
 
   if (request == NULL) {
     GError failed = { TP_ERROR, TP_ERROR_NETWORK_ERROR,
                       "Modem connection failed" };
-    tp_message_mixin_sent(_self, msg, flags, NULL, &failed);
-    return;
+    if (msg)
+      tp_message_mixin_sent((GObject *)self, msg, flags, NULL, &failed);
+    else
+      ring_text_channel_report_spooled(self, token, &failed);
+    if (priv->manager)
+      ring_text_manager_unspool(priv->manager, spool_id);
+    return FALSE;
   }
 
   modem_request_add_data(request, "tp-message", msg);
   modem_request_add_data(request, "tp-flags", GUINT_TO_POINTER(flags));
+  modem_request_add_data(request, "spool-id", GUINT_TO_POINTER(spool_id));
+  modem_request_add_data_full(request, "spool-token", g_strdup(token), g_free);
 
   g_queue_push_tail(priv->sending, request);
+
+  return TRUE;
+}
+
+/* Fail messages that never made it to the modem */
+static void
+ring_text_channel_flush_queued(RingTextChannel *self)
+{
+  RingTextChannelPrivate *priv = self->priv;
+  RingQueuedMessage *queued;
+  GError cancelled = { TP_ERROR, TP_ERROR_CANCELLED,
+                       "Channel closed before message was sent" };
+
+  while ((queued = g_queue_pop_head(priv->queued))) {
+    if (queued->msg)
+      tp_message_mixin_sent((GObject *)self, queued->msg, queued->flags,
+        NULL, &cancelled);
+    if (priv->manager)
+      ring_text_manager_unspool(priv->manager, queued->spool_id);
+    g_free(queued->text);
+    g_slice_free(RingQueuedMessage, queued);
+  }
+}
+
+/* Resolve messages already submitted to the modem.
+ *
+ * The modem may or may not have sent them, so they are not left in
+ * spool to be resent. A message sent through this channel fails with
+ * an error saying that it may have been sent nevertheless. A message
+ * resent from spool gets a delivery report with unknown status under
+ * its spooled token.
+ */
+static void
+ring_text_channel_flush_sending(RingTextChannel *self)
+{
+  RingTextChannelPrivate *priv = self->priv;
+  ModemRequest *request;
+  GError unknown = {
+    TP_ERROR, TP_ERROR_CANCELLED,
+    "Channel closed before modem replied, message may have been sent"
+  };
+
+  while ((request = g_queue_pop_head(priv->sending))) {
+    TpMessage *msg = modem_request_get_data(request, "tp-message");
+    guint flags = GPOINTER_TO_UINT(modem_request_get_data(request, "tp-flags"));
+    guint spool_id = GPOINTER_TO_UINT(modem_request_get_data(request, "spool-id"));
+    char const *token = modem_request_get_data(request, "spool-token");
+
+    DEBUG("Send(%s) outcome unknown, channel closed", token);
+
+    if (msg)
+      tp_message_mixin_sent((GObject *)self, msg, flags, NULL, &unknown);
+    else
+      ring_text_channel_delivery_report(self, token,
+        TP_DELIVERY_STATUS_UNKNOWN, NULL, NULL);
+
+    if (priv->manager)
+      ring_text_manager_unspool(priv->manager, spool_id);
+
+    modem_request_cancel(request);
+  }
 }
 
 static void
@@ -647,10 +927,17 @@ modem_sms_request_send_reply(ModemSMSService *service,
   TpMessage *msg = modem_request_get_data(request, "tp-message");
   GError *error = NULL;
   guint flags = GPOINTER_TO_UINT(modem_request_get_data(request, "tp-flags"));
-  g_assert(msg);
+  guint spool_id = GPOINTER_TO_UINT(modem_request_get_data(request, "spool-id"));
+  char const *spool_token = modem_request_get_data(request, "spool-token");
 
   g_queue_remove(priv->sending, request);
 
+  if (msg == NULL) {
+    DEBUG("Resend(%s) token=\"%s\"", spool_token, token ? token : "");
+    ring_text_channel_report_spooled(self, spool_token, send_error);
+    goto done;
+  }
+
   if (!send_error) {
     DEBUG("Send(%p) token=\"%s\"", msg, token);
     tp_message_set_int64(msg, 0, "message-sent", (gint64)time(NULL));
@@ -668,6 +955,15 @@ modem_sms_request_send_reply(ModemSMSService *service,
   }
 
   tp_message_mixin_sent((GObject *)self, msg, flags, token, error);
+
+  if (error)
+    g_error_free(error);
+
+ done:
+  if (priv->manager) {
+    ring_text_manager_unspool(priv->manager, spool_id);
+    ring_text_manager_send_done(priv->manager, send_error == NULL);
+  }
 }
 
 /* ------------------------------------------------------------------------ */
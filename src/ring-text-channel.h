@@ -66,6 +66,14 @@ GType ring_text_channel_get_type (void);
 
 char *ring_text_channel_destination(char const *inspection);
 
+gboolean ring_text_channel_has_queued(RingTextChannel const *self);
+gboolean ring_text_channel_submit_queued(RingTextChannel *self);
+void ring_text_channel_requeue(RingTextChannel *self,
+  guint spool_id,
+  char const *token,
+  char const *text,
+  guint flags);
+
 #if nomore
 
 /* FIXME: the gpointers are temporary hacks */
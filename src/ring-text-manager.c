@@ -42,8 +42,12 @@
 
 #include "ring-connection.h"
 #include "ring-param-spec.h"
+#include "ring-sms-spool.h"
+#include "ring-sms-store.h"
 #include "ring-util.h"
 
+#include <ring-extensions/ring-extensions.h>
+
 #include <modem/sms.h>
 #include <modem/oface.h>
 
@@ -54,9 +58,18 @@
 #include <telepathy-glib/errors.h>
 #include <telepathy-glib/interfaces.h>
 
-#include <uuid/uuid.h>
+#include <glib/gstdio.h>
 
+#include <errno.h>
 #include <string.h>
+#include <time.h>
+
+/* Number of sender addresses with a cached handle */
+#define RING_TEXT_MANAGER_MAX_ADDRESSES (256)
+
+/* Key of channel in handle index */
+#define LOOKUP_KEY(handle, class0) \
+  GUINT_TO_POINTER (((handle) << 1) | ((class0) != 0))
 
 static void channel_manager_iface_init(gpointer, gpointer);
 
@@ -76,6 +89,7 @@ enum
   PROP_SMSC,                  /**< SMSC address */
   PROP_SMS_VALID,             /**< SMS validity period in seconds */
   PROP_SMS_REDUCED_CHARSET,   /**< SMS reduced character set */
+  PROP_SMS_SEND_WINDOW,       /**< Max. number of SMSes sent at once */
   N_PROPS
 };
 
@@ -89,16 +103,38 @@ struct _RingTextManagerPrivate
   /* object_path => RingTextChannel */
   GHashTable *channels;
 
+  /* Shortcuts for finding the channel of a message sender */
+  struct {
+    /* address => handle, holding a reference */
+    GHashTable *handles;
+    /* handle and class 0 flag => RingTextChannel */
+    GHashTable *channels;
+    RingTextManagerLookupStats stats;
+  } lookup;
+
   TpConnectionStatus status, cstatus;
 
   ModemSMSService *sms_service;
 
   guint sms_reduced_charset :1;
 
+  /* Outgoing SMS scheduler */
+  struct {
+    /* Channels with queued messages, served round-robin */
+    GQueue channels[1];
+    RingTextManagerSendStats stats;
+    /* Outgoing messages saved over restarts */
+    RingSMSSpool *spool;
+    unsigned replayed:1;
+  } send;
+
+  /* Received messages kept until a client expunges them or they get old */
+  RingSMSStore *store;
+
   struct {
     gulong incoming_message, immediate_message;
 #if nomore
-    gulong receiving_sms_deliver, receiving_sms_status_report;
+    gulong receiving_sms_deliver;
     gulong outgoing_sms_complete, outgoing_sms_error;
 #endif
     gulong status_changed;
@@ -119,6 +155,7 @@ static void on_connection_status_changed (TpBaseConnection *conn,
     RingTextManager *self);
 
 static void foreach_dispose (gpointer, gpointer, gpointer);
+static void forget_handles (RingTextManager *self);
 
 static gboolean ring_text_requestotron(RingTextManager *self,
   gpointer request,
@@ -136,6 +173,19 @@ static gboolean tp_asv_get_sms_channel (GHashTable *properties);
 
 static void on_text_channel_closed(RingTextChannel *, RingTextManager *);
 
+static RingTextChannel *get_text_channel(RingTextManager *self,
+  char const *address,
+  gboolean class0,
+  gboolean self_invoked);
+
+static char *ring_text_manager_state_file(RingTextManager *self,
+  char const *prefix);
+static void ring_text_manager_pump(RingTextManager *self);
+static void ring_text_manager_open_spool(RingTextManager *self);
+static void ring_text_manager_replay_spool(RingTextManager *self);
+static void ring_text_manager_open_store(RingTextManager *self);
+static void ring_text_manager_trim_store(RingTextManager *self);
+
 #if nomore
 static void on_sms_service_deliver(ModemSMSService *,
   SMSGDeliver *, gpointer _self);
@@ -148,21 +198,17 @@ static void on_sms_service_outgoing_error(ModemSMSService *,
   char const *destination,
   GError const *error,
   gpointer _self);
-static void on_sms_service_status_report(ModemSMSService *,
-  SMSGStatusReport *, gpointer _self);
 static void ring_text_manager_receive_deliver(
   RingTextManager *, SMSGDeliver *);
-static void ring_text_manager_receive_status_report(
-  RingTextManager *, SMSGStatusReport *);
 #endif
 
 static void on_incoming_message (ModemSMSService *,
     gchar const *message,
-    GHashTable *info,
+    ModemSMSInfo const *info,
     gpointer user_data);
 static void on_immediate_message (ModemSMSService *,
     gchar const *message,
-    GHashTable *info,
+    ModemSMSInfo const *info,
     gpointer user_data);
 
 /* ------------------------------------------------------------------------ */
@@ -189,6 +235,12 @@ ring_text_manager_init (RingTextManager *self)
 
   self->priv->channels = g_hash_table_new_full (g_str_hash, g_str_equal,
       NULL, g_object_unref);
+
+  self->priv->lookup.handles = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, NULL);
+  self->priv->lookup.channels = g_hash_table_new (NULL, NULL);
+
+  g_queue_init (self->priv->send.channels);
 }
 
 static void
@@ -203,6 +255,10 @@ ring_text_manager_dispose(GObject *object)
 
   g_hash_table_foreach (priv->channels, foreach_dispose, NULL);
   g_hash_table_remove_all (priv->channels);
+  g_hash_table_remove_all (priv->lookup.channels);
+  forget_handles (self);
+
+  g_assert (g_queue_is_empty (priv->send.channels));
 
   G_OBJECT_CLASS(ring_text_manager_parent_class)->dispose(object);
 }
@@ -214,8 +270,12 @@ ring_text_manager_finalize(GObject *object)
   RingTextManagerPrivate *priv = self->priv;
 
   /* Free any data held directly by the object here */
+  ring_sms_spool_close(priv->send.spool);
+  ring_sms_store_close(priv->store);
   g_free(priv->smsc);
   g_hash_table_destroy (priv->channels);
+  g_hash_table_destroy (priv->lookup.handles);
+  g_hash_table_destroy (priv->lookup.channels);
 
   G_OBJECT_CLASS(ring_text_manager_parent_class)->finalize(object);
 }
@@ -245,6 +305,9 @@ ring_text_manager_get_property(GObject *object,
     case PROP_SMS_REDUCED_CHARSET:
       g_value_set_boolean(value, priv->sms_reduced_charset);
       break;
+    case PROP_SMS_SEND_WINDOW:
+      g_value_set_uint(value, priv->send.stats.window);
+      break;
     case PROP_CAPABILITY_FLAGS:
       g_value_set_uint(value, priv->capability_flags);
       break;
@@ -289,6 +352,10 @@ ring_text_manager_set_property(GObject *object,
         g_object_set(priv->sms_service, "reduced-charset",
           priv->sms_reduced_charset, NULL);
       break;
+    case PROP_SMS_SEND_WINDOW:
+      priv->send.stats.window = g_value_get_uint(value);
+      ring_text_manager_pump(self);
+      break;
     case PROP_CAPABILITY_FLAGS:
       priv->capability_flags = g_value_get_uint(value) &
         RING_TEXT_CHANNEL_CAPABILITY_FLAGS;
@@ -322,6 +389,8 @@ ring_text_manager_class_init(RingTextManagerClass *klass)
   g_object_class_install_property(
     object_class, PROP_SMS_REDUCED_CHARSET,
     ring_param_spec_sms_reduced_charset());
+  g_object_class_install_property(
+    object_class, PROP_SMS_SEND_WINDOW, ring_param_spec_sms_send_window());
   g_object_class_install_property(object_class, PROP_CAPABILITY_FLAGS,
     ring_param_spec_type_specific_capability_flags(G_PARAM_CONSTRUCT,
       RING_TEXT_CHANNEL_CAPABILITY_FLAGS));
@@ -363,6 +432,7 @@ ring_text_manager_connected (RingTextManager *self)
 {
   RingTextManagerPrivate *priv = self->priv;
   ModemSMSService *sms = priv->sms_service;
+  char *path;
 
   priv->signals.incoming_message =
     modem_sms_connect_to_incoming_message (sms,
@@ -371,6 +441,14 @@ ring_text_manager_connected (RingTextManager *self)
     modem_sms_connect_to_immediate_message (sms,
         on_immediate_message, self);
 
+  path = ring_text_manager_state_file (self, "sms-received");
+  g_object_set (sms, "dedup-file", path, NULL);
+  g_free (path);
+
+  ring_text_manager_open_spool (self);
+  ring_text_manager_replay_spool (self);
+  ring_text_manager_open_store (self);
+
 #if nomore
   priv->signals.receiving_sms_deliver =
     modem_sms_connect_to_deliver (sms, on_sms_service_deliver, self);
@@ -382,10 +460,6 @@ ring_text_manager_connected (RingTextManager *self)
   priv->signals.outgoing_sms_error =
     modem_sms_connect_to_outgoing_error (sms,
         on_sms_service_outgoing_error, self);
-
-  priv->signals.receiving_sms_status_report =
-    modem_sms_connect_to_status_report (sms,
-        on_sms_service_status_report, self);
 #endif
 }
 
@@ -402,7 +476,6 @@ ring_text_manager_disconnect (RingTextManager *self)
   ring_signal_disconnect (sms, &priv->signals.receiving_sms_deliver);
   ring_signal_disconnect (sms, &priv->signals.outgoing_sms_complete);
   ring_signal_disconnect (sms, &priv->signals.outgoing_sms_error);
-  ring_signal_disconnect (sms, &priv->signals.receiving_sms_status_report);
 #endif
 
   if (priv->sms_service)
@@ -416,7 +489,11 @@ on_connection_status_changed (TpBaseConnection *conn,
                               guint reason,
                               RingTextManager *self)
 {
-  if (status == TP_CONNECTION_STATUS_DISCONNECTED)
+  if (status == TP_CONNECTION_STATUS_CONNECTED)
+    {
+      ring_text_manager_replay_spool (self);
+    }
+  else if (status == TP_CONNECTION_STATUS_DISCONNECTED)
     {
       ring_text_manager_dispose (G_OBJECT (self));
     }
@@ -434,6 +511,264 @@ foreach_dispose (gpointer key,
     }
 }
 
+/* ---------------------------------------------------------------------- */
+/* Outgoing SMS scheduler
+ *
+ * oFono sends the SMSes one at a time, so there is little point in
+ * submitting more than a few of them at once. The rest wait in the
+ * channels, and the channels take turns in submitting their messages
+ * so that a bulk send to one destination does not starve the others.
+ */
+
+/** Check if there is room for a new outgoing message. */
+gboolean
+ring_text_manager_can_queue (RingTextManager *self,
+                             GError **error)
+{
+  RingTextManagerSendStats *stats = &self->priv->send.stats;
+
+  if (stats->queued < RING_TEXT_MANAGER_MAX_QUEUED)
+    return TRUE;
+
+  stats->rejected++;
+
+  g_set_error (error, TP_ERROR, TP_ERROR_SERVICE_BUSY,
+      "Too many messages (%u) waiting to be sent", stats->queued);
+
+  return FALSE;
+}
+
+/** Channel has queued a message, submit it when there is room. */
+void
+ring_text_manager_schedule (RingTextManager *self,
+                            RingTextChannel *channel)
+{
+  RingTextManagerPrivate *priv = self->priv;
+  RingTextManagerSendStats *stats = &priv->send.stats;
+
+  if (++stats->queued > stats->max_queued)
+    stats->max_queued = stats->queued;
+
+  if (!g_queue_find (priv->send.channels, channel))
+    g_queue_push_tail (priv->send.channels, channel);
+
+  ring_text_manager_pump (self);
+}
+
+/** Channel has got a reply to a submitted message. */
+void
+ring_text_manager_send_done (RingTextManager *self,
+                             gboolean success)
+{
+  RingTextManagerSendStats *stats = &self->priv->send.stats;
+
+  g_return_if_fail (stats->in_flight > 0);
+
+  stats->in_flight--;
+
+  if (success)
+    stats->sent++;
+  else
+    stats->failed++;
+
+  ring_text_manager_pump (self);
+}
+
+/** Channel is going away, forget its queued and submitted messages. */
+void
+ring_text_manager_unschedule (RingTextManager *self,
+                              RingTextChannel *channel,
+                              guint n_queued,
+                              guint n_in_flight)
+{
+  RingTextManagerPrivate *priv = self->priv;
+  RingTextManagerSendStats *stats = &priv->send.stats;
+
+  g_queue_remove (priv->send.channels, channel);
+
+  g_return_if_fail (stats->queued >= n_queued);
+  g_return_if_fail (stats->in_flight >= n_in_flight);
+
+  stats->queued -= n_queued;
+  stats->failed += n_queued;
+  stats->in_flight -= n_in_flight;
+
+  ring_text_manager_pump (self);
+}
+
+static void
+ring_text_manager_pump (RingTextManager *self)
+{
+  RingTextManagerPrivate *priv = self->priv;
+  RingTextManagerSendStats *stats = &priv->send.stats;
+  RingTextChannel *channel;
+
+  while (stats->in_flight < stats->window &&
+      !g_queue_is_empty (priv->send.channels))
+    {
+      channel = g_queue_pop_head (priv->send.channels);
+
+      stats->queued--;
+
+      if (ring_text_channel_submit_queued (channel))
+        {
+          stats->submitted++;
+          stats->in_flight++;
+        }
+      else
+        {
+          stats->failed++;
+        }
+
+      if (ring_text_channel_has_queued (channel))
+        g_queue_push_tail (priv->send.channels, channel);
+    }
+
+  DEBUG ("sms queue: %u queued, %u in flight, "
+      "%u submitted, %u sent, %u failed, %u rejected",
+      stats->queued, stats->in_flight,
+      stats->submitted, stats->sent, stats->failed, stats->rejected);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Outgoing SMS spool
+ *
+ * Messages are kept in spool from the moment they are queued until
+ * the modem has replied to them or they have been cancelled, so the
+ * messages left over by a crash get sent when we start up again.
+ * A message still in flight when its channel is closed may already
+ * have been sent, so it is removed, too. Its sending fails with an
+ * error saying so, or, if it was resent from spool, it gets a delivery
+ * report with unknown status. The spool keeps the message token, so the
+ * reports on a resent message use the token it was queued with.
+ */
+
+/* Return path of a file keeping SMS state of this modem over restarts */
+static char *
+ring_text_manager_state_file (RingTextManager *self,
+                              char const *prefix)
+{
+  char const *modem_path;
+  char *name, *dir, *path;
+
+  modem_path = modem_oface_object_path (MODEM_OFACE (self->priv->sms_service));
+
+  name = g_strconcat (prefix, modem_path, NULL);
+  g_strdelimit (name, "/", '-');
+
+  dir = g_build_filename (g_get_user_data_dir (), "telepathy-ring", NULL);
+  if (g_mkdir_with_parents (dir, 0700) < 0)
+    DEBUG ("%s: %s", dir, g_strerror (errno));
+
+  path = g_build_filename (dir, name, NULL);
+
+  g_free (dir);
+  g_free (name);
+
+  return path;
+}
+
+static void
+ring_text_manager_open_spool (RingTextManager *self)
+{
+  RingTextManagerPrivate *priv = self->priv;
+  char *path;
+  GError *error = NULL;
+
+  if (priv->send.spool)
+    return;
+
+  path = ring_text_manager_state_file (self, "sms-spool");
+
+  priv->send.spool = ring_sms_spool_open (path, &error);
+  if (priv->send.spool == NULL)
+    {
+      DEBUG ("%s", error->message);
+      g_error_free (error);
+    }
+
+  g_free (path);
+}
+
+static void
+replay_spooled (guint id,
+                char const *destination,
+                char const *text,
+                char const *token,
+                guint flags,
+                gpointer _self)
+{
+  RingTextManager *self = RING_TEXT_MANAGER (_self);
+  RingTextChannel *channel;
+
+  DEBUG ("resending message %s to %s", token, destination);
+
+  channel = get_text_channel (self, destination, 0, 1);
+  if (channel)
+    ring_text_channel_requeue (channel, id, token, text, flags);
+  else
+    ring_sms_spool_remove (self->priv->send.spool, id);
+}
+
+/* Queue messages left in spool when we were last running */
+static void
+ring_text_manager_replay_spool (RingTextManager *self)
+{
+  RingTextManagerPrivate *priv = self->priv;
+  TpBaseConnection *base = TP_BASE_CONNECTION (priv->connection);
+
+  if (priv->send.spool == NULL || priv->send.replayed)
+    return;
+  /* New channels can be announced only when connected */
+  if (base->status != TP_CONNECTION_STATUS_CONNECTED)
+    return;
+
+  priv->send.replayed = TRUE;
+
+  ring_sms_spool_foreach (priv->send.spool, replay_spooled, self);
+}
+
+/** Save an outgoing message with its message @a token in spool.
+ *
+ * @return spool id of the message, or 0 if it was not saved
+ */
+guint
+ring_text_manager_spool (RingTextManager *self,
+                         char const *destination,
+                         char const *text,
+                         char const *token,
+                         guint flags)
+{
+  return ring_sms_spool_append (self->priv->send.spool,
+      destination, text, token, flags);
+}
+
+/** Remove a message that has been sent or has failed from spool. */
+void
+ring_text_manager_unspool (RingTextManager *self,
+                           guint id)
+{
+  ring_sms_spool_remove (self->priv->send.spool, id);
+}
+
+void
+ring_text_manager_get_send_stats (RingTextManager const *self,
+                                  RingTextManagerSendStats *return_stats)
+{
+  *return_stats = self->priv->send.stats;
+}
+
+void
+ring_text_manager_get_lookup_stats (RingTextManager const *self,
+                                    RingTextManagerLookupStats *return_stats)
+{
+  RingTextManagerPrivate const *priv = self->priv;
+
+  *return_stats = priv->lookup.stats;
+  return_stats->addresses = g_hash_table_size (priv->lookup.handles);
+  return_stats->channels = g_hash_table_size (priv->lookup.channels);
+}
+
 /* ---------------------------------------------------------------------- */
 /* Insert channel-type specific capabilities into array */
 
@@ -691,12 +1026,15 @@ ring_text_manager_request(RingTextManager *self,
       "initiator-handle", initiator,
       "requested", request != NULL,
       "sms-flash", class0,
+      "text-manager", self,
       NULL);
   g_free(object_path);
 
   g_object_get(channel, "object_path", &object_path, NULL);
 
   g_hash_table_insert(priv->channels, object_path, channel);
+  g_hash_table_insert(priv->lookup.channels,
+    LOOKUP_KEY(handle, class0), channel);
 
   g_signal_connect(channel, "closed", (GCallback)on_text_channel_closed, self);
 
@@ -716,13 +1054,14 @@ static void
 on_text_channel_closed(RingTextChannel *channel, RingTextManager *self)
 {
   char *object_path;
-  gboolean really_destroyed;
+  gboolean really_destroyed, class0;
   guint handle;
 
   g_object_get(channel,
     "object-path", &object_path,
     "channel-destroyed", &really_destroyed,
     "handle", &handle,
+    "sms-flash", &class0,
     NULL);
 
   if (self->priv->channels == NULL)
@@ -736,6 +1075,8 @@ on_text_channel_closed(RingTextChannel *channel, RingTextManager *self)
   if (self->priv->channels == NULL)
     ;
   else if (really_destroyed) {
+    g_hash_table_remove(self->priv->lookup.channels,
+      LOOKUP_KEY(handle, class0));
     g_hash_table_remove(self->priv->channels, object_path);
   }
   else {
@@ -750,40 +1091,97 @@ on_text_channel_closed(RingTextChannel *channel, RingTextManager *self)
   g_free(object_path);
 }
 
-static RingTextChannel *
-get_text_channel(RingTextManager *self,
-  char const *address,
-  gboolean class0,
-  gboolean self_invoked)
+/* Drop the cached address handles */
+static void
+forget_handles(RingTextManager *self)
 {
+  RingTextManagerPrivate *priv = self->priv;
   TpHandleRepoIface *repo;
-  RingTextChannel *channel = NULL;
-  TpHandle handle, initiator;
+  GHashTableIter i[1];
+  gpointer handle;
+
+  if (g_hash_table_size(priv->lookup.handles) == 0)
+    return;
+
+  repo = tp_base_connection_get_handles(
+    (TpBaseConnection *)priv->connection, TP_HANDLE_TYPE_CONTACT);
+
+  for (g_hash_table_iter_init(i, priv->lookup.handles);
+       g_hash_table_iter_next(i, NULL, &handle);)
+    tp_handle_unref(repo, GPOINTER_TO_UINT(handle));
+
+  g_hash_table_remove_all(priv->lookup.handles);
+}
+
+/* Find the handle of an address, normalizing it only on cache miss */
+static TpHandle
+lookup_handle(RingTextManager *self,
+  char const *address)
+{
+  RingTextManagerPrivate *priv = self->priv;
+  TpHandleRepoIface *repo;
+  TpHandle handle;
   GError *error = NULL;
 
-  g_return_val_if_fail (address != NULL, NULL);
+  handle = GPOINTER_TO_UINT(g_hash_table_lookup(priv->lookup.handles, address));
+  if (handle) {
+    priv->lookup.stats.address_hits++;
+    return handle;
+  }
+
+  priv->lookup.stats.address_misses++;
 
   repo = tp_base_connection_get_handles(
-    (TpBaseConnection *)self->priv->connection, TP_HANDLE_TYPE_CONTACT);
+    (TpBaseConnection *)priv->connection, TP_HANDLE_TYPE_CONTACT);
 
-  error = NULL;
   handle = tp_handle_ensure(repo, address,
            ring_network_normalization_context(), &error);
   if (handle == 0) {
     DEBUG("tp_handle_ensure: %s: %s (%d@%s)", address, GERROR_MSG_CODE(error));
     g_clear_error(&error);
+    return 0;
+  }
+
+  /* Keep the cache bounded; senders come back soon or not at all */
+  if (g_hash_table_size(priv->lookup.handles) >= RING_TEXT_MANAGER_MAX_ADDRESSES)
+    forget_handles(self);
+
+  /* The reference from tp_handle_ensure() is kept by the cache */
+  g_hash_table_insert(priv->lookup.handles, g_strdup(address),
+    GUINT_TO_POINTER(handle));
+
+  return handle;
+}
+
+static RingTextChannel *
+get_text_channel(RingTextManager *self,
+  char const *address,
+  gboolean class0,
+  gboolean self_invoked)
+{
+  RingTextManagerPrivate *priv = self->priv;
+  RingTextChannel *channel = NULL;
+  TpHandle handle, initiator;
+
+  g_return_val_if_fail (address != NULL, NULL);
+
+  handle = lookup_handle(self, address);
+  if (handle == 0)
     /* Xyzzy */
     return NULL;
-  }
 
-  initiator = self_invoked ? self->priv->connection->parent.self_handle : handle;
+  channel = g_hash_table_lookup(priv->lookup.channels,
+            LOOKUP_KEY(handle, class0));
+  if (channel) {
+    priv->lookup.stats.channel_hits++;
+    return channel;
+  }
 
-  channel = ring_text_manager_request(self, NULL, initiator, handle, 0, class0);
+  priv->lookup.stats.channel_misses++;
 
-  if (channel == NULL)
-    tp_handle_unref(repo, handle);
+  initiator = self_invoked ? priv->connection->parent.self_handle : handle;
 
-  return channel;
+  return ring_text_manager_request(self, NULL, initiator, handle, 0, class0);
 }
 
 #if nomore
@@ -842,15 +1240,6 @@ on_sms_service_outgoing_error(ModemSMSService *service,
   if (channel)
     ring_text_channel_outgoing_sms_error(channel, token, error);
 }
-
-static void
-on_sms_service_status_report(ModemSMSService *sms_service,
-  SMSGStatusReport *status_report,
-  gpointer _self)
-{
-  ring_text_manager_receive_status_report(
-    RING_TEXT_MANAGER(_self), status_report);
-}
 #endif
 
 /* ---------------------------------------------------------------------- */
@@ -885,85 +1274,44 @@ ring_text_manager_receive_deliver(RingTextManager *self,
   if (channel)
     ring_text_channel_receive_deliver(channel, deliver);
 }
-
-static void
-ring_text_manager_receive_status_report(RingTextManager *self,
-  SMSGStatusReport *status_report)
-{
-  RingTextManagerPrivate *priv = self->priv;
-  RingTextChannel *channel;
-
-  char const *recipient = sms_g_status_report_get_recipient(status_report);
-
-  DEBUG("SMS-STATUS_REPORT for %s", recipient);
-
-  if (priv->cstatus != TP_CONNECTION_STATUS_CONNECTED) {
-    /* Uh-oh */
-    DEBUG("not yet connected, ignoring");
-    return;
-  }
-
-  channel = get_text_channel(self, recipient, 0, 0);
-
-  if (channel)
-    ring_text_channel_receive_status_report(channel, status_report);
-}
 #endif
 
-static char *
-generate_token (void)
-{
-  char *token;
-  uuid_t uu;
-
-  token = g_new (gchar, 37);
-  uuid_generate_random (uu);
-  uuid_unparse_lower (uu, token);
-
-  return token;
-}
-
 static void
 receive_text (RingTextManager *self,
               RingTextChannel *channel,
               gchar const *message,
-              GHashTable *info,
+              ModemSMSInfo const *info,
               guint32 sms_class)
 {
-  char const *sent;
-  char *token;
-  gint64 message_sent;
-  gint64 message_received = (gint64) time(NULL);
-
-  sent = tp_asv_get_string (info, "SentTime");
-  if (sent)
-    message_sent = modem_sms_parse_time (sent);
-  else
-    message_sent = message_received;
+  char token[RING_TOKEN_LENGTH];
+  gint64 sent = info->sent ? info->sent : info->received;
+
+  ring_generate_token (token);
+
+  /* Class 0 messages are only shown, never saved */
+  if (sms_class != 0 &&
+      ring_sms_store_add (self->priv->store, token, info->sender, message,
+          sent, info->received))
+    ring_text_manager_trim_store (self);
 
-  token = generate_token ();
   ring_text_channel_receive_text (channel,
-      token, message, message_sent, message_received, sms_class);
-  g_free (token);
+      token, message, sent, info->received, sms_class);
 }
 
 static void
 on_incoming_message (ModemSMSService *sms,
                      gchar const *message,
-                     GHashTable *info,
+                     ModemSMSInfo const *info,
                      gpointer _self)
 {
   RingTextManager *self = RING_TEXT_MANAGER (_self);
-  char const *sender;
   RingTextChannel *channel;
 
   g_return_if_fail (info != NULL);
   g_return_if_fail (message != NULL);
+  g_return_if_fail (info->sender != NULL);
 
-  sender = tp_asv_get_string (info, "Sender");
-  g_return_if_fail (sender != NULL);
-
-  channel = get_text_channel (self, sender, 0, 0);
+  channel = get_text_channel (self, info->sender, 0, 0);
   g_return_if_fail (channel != NULL);
 
   receive_text (self, channel, message, info, G_MAXUINT32);
@@ -972,20 +1320,17 @@ on_incoming_message (ModemSMSService *sms,
 static void
 on_immediate_message (ModemSMSService *sms,
                       gchar const *message,
-                      GHashTable *info,
+                      ModemSMSInfo const *info,
                       gpointer _self)
 {
   RingTextManager *self = RING_TEXT_MANAGER (_self);
-  char const *sender;
   RingTextChannel *channel;
 
   g_return_if_fail (info != NULL);
   g_return_if_fail (message != NULL);
+  g_return_if_fail (info->sender != NULL);
 
-  sender = tp_asv_get_string (info, "Sender");
-  g_return_if_fail (sender != NULL);
-
-  channel = get_text_channel (self, sender, 0, 0);
+  channel = get_text_channel (self, info->sender, 0, 0);
   g_return_if_fail (channel != NULL);
 
   receive_text (self, channel, message, info, 0);
@@ -994,118 +1339,133 @@ on_immediate_message (ModemSMSService *sms,
 /* ---------------------------------------------------------------------- */
 /* StoredMessages interface */
 
-#if nomore
 static void
-ring_text_manager_not_connected(gpointer context)
+ring_text_manager_open_store (RingTextManager *self)
 {
-  GError error =
-    { TP_ERROR, TP_ERROR_NOT_AVAILABLE, "SMS service is not available" };
-  dbus_g_method_return_error(context, &error);
+  RingTextManagerPrivate *priv = self->priv;
+  char *path;
+  GError *error = NULL;
+
+  if (priv->store)
+    return;
+
+  path = ring_text_manager_state_file (self, "sms-store");
+
+  priv->store = ring_sms_store_open (path, &error);
+  if (priv->store == NULL)
+    {
+      DEBUG ("%s", error->message);
+      g_error_free (error);
+    }
+
+  g_free (path);
 }
 
-void
-ring_text_manager_deliver_stored_messages(RingTextManager *self,
-  char const **messages,
-  gpointer context)
+static void
+deliver_stored (char const *token,
+                char const *sender,
+                char const *text,
+                gint64 sent,
+                gint64 received,
+                gpointer _self)
 {
-#if nomore
-  /* XXX/KV: use ring_text_manager_is_connected () */
-  if (self->priv->status == TP_CONNECTION_STATUS_CONNECTED) {
-    int i;
-    ModemSMSService *service = self->priv->sms_service;
-
-    for (i = 0; messages[i]; i++) {
-      gpointer m = modem_sms_get_stored_message(service, messages[i]);
-
-      if (m == NULL) {
-        DEBUG("%s: not in received", messages[i]);
-        continue;
-      }
-
-      if (SMS_G_IS_DELIVER(m)) {
-        ring_text_manager_receive_deliver(self, m);
-      }
-      else if (SMS_G_IS_STATUS_REPORT(m)) {
-        ring_text_manager_receive_status_report(self, m);
-      }
-      else {
-        DEBUG("unknown %s in received", G_OBJECT_TYPE_NAME(m));
-      }
+  RingTextManager *self = RING_TEXT_MANAGER (_self);
+  RingTextChannel *channel;
+
+  channel = get_text_channel (self, sender, 0, 0);
+  if (channel == NULL)
+    {
+      DEBUG ("%s: no channel for %s", token, sender);
+      return;
     }
 
-    dbus_g_method_return(context);
-  }
-  else {
-    ring_text_manager_not_connected(context);
-  }
-#endif
+  ring_text_channel_receive_text (channel,
+      token, text, sent, received, G_MAXUINT32);
 }
 
-void
-ring_text_manager_expunge_messages(RingTextManager *self,
-  char const **messages,
-  gpointer context)
+/** Deliver stored messages again to their channels. */
+gboolean
+ring_text_manager_deliver_stored_messages (RingTextManager *self,
+                                           char const **messages,
+                                           GError **error)
 {
-  /* XXX/KV: use ring_text_manager_is_connected () */
-  if (self->priv->status == TP_CONNECTION_STATUS_CONNECTED) {
-    int i;
-    ModemSMSService *service = self->priv->sms_service;
-    GPtrArray *expunged = g_ptr_array_new();
-
-    for (i = 0; messages[i]; i++) {
-      if (modem_sms_request_expunge(service, messages[i], NULL, NULL)) {
-        g_ptr_array_add(expunged, (gpointer)g_strdup(messages[i]));
-      }
+  TpBaseConnection *base = TP_BASE_CONNECTION (self->priv->connection);
+  guint i;
+
+  if (self->priv->store == NULL ||
+      base->status != TP_CONNECTION_STATUS_CONNECTED)
+    {
+      g_set_error (error, TP_ERROR, TP_ERROR_NOT_AVAILABLE,
+          "SMS service is not available");
+      return FALSE;
     }
 
-    g_ptr_array_add(expunged, NULL);
+  for (i = 0; messages[i]; i++)
+    {
+      if (!ring_sms_store_get (self->priv->store, messages[i],
+              deliver_stored, self))
+        DEBUG ("%s: not stored", messages[i]);
+    }
 
-    dbus_g_method_return(context);
+  return TRUE;
+}
 
-    rtcom_tp_svc_connection_interface_stored_messages_emit_messages_expunged(
-      self->priv->connection,
-      (char const **)expunged->pdata);
+/* Emit MessagesExpunged, if any, and free the tokens */
+static void
+ring_text_manager_emit_expunged (RingTextManager *self,
+                                 char **expunged)
+{
+  if (expunged[0])
+    ring_svc_connection_interface_stored_messages_emit_messages_expunged (
+        self->priv->connection, (char const **)expunged);
 
-    g_strfreev((char **)g_ptr_array_free(expunged, FALSE));
-  }
-  else {
-    ring_text_manager_not_connected(context);
-  }
+  g_strfreev (expunged);
 }
 
-static ModemSMSServiceReply ring_text_manager_set_storage_status_reply;
-
-void
-ring_text_manager_set_storage_status(RingTextManager *self,
-  gboolean out_of_storage,
-  gpointer context)
+/* Drop the oldest messages from a store grown too big */
+static void
+ring_text_manager_trim_store (RingTextManager *self)
 {
-  /* XXX/KV: use ring_text_manager_is_connected () */
-  if (self->priv->status == TP_CONNECTION_STATUS_CONNECTED)
-    modem_sms_request_out_of_memory(
-      self->priv->sms_service,
-      out_of_storage,
-      ring_text_manager_set_storage_status_reply,
-      context);
-  else
-    ring_text_manager_not_connected(context);
+  char **expunged;
+
+  expunged = ring_sms_store_expunge_old (self->priv->store,
+      RING_TEXT_MANAGER_MAX_STORED,
+      (gint64) time (NULL) - RING_TEXT_MANAGER_MAX_STORED_AGE);
+
+  if (expunged[0])
+    DEBUG ("dropped %u old stored messages", g_strv_length (expunged));
+
+  ring_text_manager_emit_expunged (self, expunged);
 }
 
-static void
-ring_text_manager_set_storage_status_reply(ModemSMSService *service,
-  ModemRequest *request,
-  GError *error,
-  gpointer context)
+/** Remove messages from store.
+ *
+ * Emits MessagesExpunged once for all the removed messages.
+ */
+gboolean
+ring_text_manager_expunge_messages (RingTextManager *self,
+                                    char const **messages,
+                                    GError **error)
 {
-  if (!error)
-    dbus_g_method_return(context);
-  else
-    dbus_g_method_return_error(context, error);
+  TpBaseConnection *base = TP_BASE_CONNECTION (self->priv->connection);
+
+  if (self->priv->store == NULL ||
+      base->status != TP_CONNECTION_STATUS_CONNECTED)
+    {
+      g_set_error (error, TP_ERROR, TP_ERROR_NOT_AVAILABLE,
+          "SMS service is not available");
+      return FALSE;
+    }
+
+  ring_text_manager_emit_expunged (self,
+      ring_sms_store_expunge (self->priv->store,
+          (char const * const *)messages));
+
+  return TRUE;
 }
 
 char **
-ring_text_manager_list_stored_messages(RingTextManager const *self)
+ring_text_manager_list_stored_messages (RingTextManager const *self)
 {
-  return modem_sms_list_stored(self->priv->sms_service);
+  return ring_sms_store_list (self->priv->store);
 }
-#endif
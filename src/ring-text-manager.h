@@ -60,23 +60,73 @@ GType ring_text_manager_get_type(void);
 gpointer ring_text_manager_lookup(RingTextManager *self,
   char const *object_path);
 
-#if nomore
-void ring_text_manager_deliver_stored_messages(RingTextManager *,
+/* Upper limit for the "sms-send-window" property */
+#define RING_TEXT_MANAGER_MAX_SEND_WINDOW (64)
+
+/* Sending fails with ServiceBusy when this many messages are queued */
+#define RING_TEXT_MANAGER_MAX_QUEUED (1024)
+
+/* Received messages are kept until a client expunges them, but the
+ * oldest are dropped when there are more than this many of them or
+ * when they are older than this many seconds */
+#define RING_TEXT_MANAGER_MAX_STORED (1000)
+#define RING_TEXT_MANAGER_MAX_STORED_AGE (30 * 24 * 60 * 60)
+
+typedef struct {
+  guint window;                 /* Max. number of messages in flight */
+  guint in_flight;              /* Submitted, waiting for reply */
+  guint queued;                 /* Waiting for room in window */
+  guint max_queued;             /* High-water mark of queued */
+  guint submitted;              /* Submitted to modem */
+  guint sent;                   /* Successfully sent by modem */
+  guint failed;                 /* Failed or cancelled */
+  guint rejected;               /* Refused because queue was full */
+} RingTextManagerSendStats;
+
+typedef struct {
+  guint addresses;              /* Addresses with cached handle */
+  guint address_hits;           /* Handle found in cache */
+  guint address_misses;         /* Handle looked up from repository */
+  guint channels;               /* Channels in handle index */
+  guint channel_hits;           /* Existing channel found in index */
+  guint channel_misses;         /* Channel had to be created */
+} RingTextManagerLookupStats;
+
+struct _RingTextChannel;
+
+gboolean ring_text_manager_can_queue(RingTextManager *self,
+  GError **error);
+void ring_text_manager_schedule(RingTextManager *self,
+  struct _RingTextChannel *channel);
+void ring_text_manager_send_done(RingTextManager *self,
+  gboolean success);
+void ring_text_manager_unschedule(RingTextManager *self,
+  struct _RingTextChannel *channel,
+  guint n_queued,
+  guint n_in_flight);
+
+guint ring_text_manager_spool(RingTextManager *self,
+  char const *destination,
+  char const *text,
+  char const *token,
+  guint flags);
+void ring_text_manager_unspool(RingTextManager *self, guint id);
+
+void ring_text_manager_get_send_stats(RingTextManager const *self,
+  RingTextManagerSendStats *return_stats);
+void ring_text_manager_get_lookup_stats(RingTextManager const *self,
+  RingTextManagerLookupStats *return_stats);
+
+gboolean ring_text_manager_deliver_stored_messages(RingTextManager *,
   char const **messages,
-  gpointer context);
+  GError **error);
 
-void ring_text_manager_expunge_messages(RingTextManager *,
-  char const **message_identities,
-  gpointer context);
-
-void ring_text_manager_set_storage_status(RingTextManager *,
-  gboolean out_of_storage,
-  gpointer context);
+gboolean ring_text_manager_expunge_messages(RingTextManager *,
+  char const **messages,
+  GError **error);
 
 char **ring_text_manager_list_stored_messages(RingTextManager const *);
 
-#endif
-
 void ring_text_manager_add_capabilities(RingTextManager *self,
   guint handle, GPtrArray *returns);
 
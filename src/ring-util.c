@@ -25,6 +25,7 @@
 #include "ring-util.h"
 
 #include "modem/call.h"
+#include "modem/chars.h"
 #include "modem/errors.h"
 
 #include <telepathy-glib/base-connection.h>
@@ -79,25 +80,20 @@ ring_normalize_isdn(char const *s)
   char *isdn = g_strdup(s ? s : "");
 
   for (i = 0, j = 0; isdn[i]; i++) {
-    switch (isdn[i]) {
-      case ' ': case '.': case '(': case ')': case '-':
-        continue;
-      case '+':
-        if (j != 0) {
-          g_free(isdn);
-          return NULL;
-        }
-        /* FALLTHROUGH */
-      case '0': case '1': case '2': case '3': case '4':
-      case '5': case '6': case '7': case '8': case '9':
-        if (i != j)
-          isdn[j] = isdn[i];
-        j++;
-        break;
-      default:
-        g_free(isdn);
-        return NULL;
+    guint8 type = modem_char_class[(guchar)isdn[i]];
+
+    if (type & MODEM_CHAR_FILLER)
+      continue;
+
+    if (!(type & MODEM_CHAR_DIGIT) &&
+        !((type & MODEM_CHAR_PLUS) && j == 0)) {
+      g_free(isdn);
+      return NULL;
     }
+
+    if (i != j)
+      isdn[j] = isdn[i];
+    j++;
   }
 
   if (i != j)
@@ -505,3 +501,199 @@ tp_asv_get_initial_video (GHashTable *properties, gboolean default_value)
     return default_value;
 }
 
+
+/* ---------------------------------------------------------------------- */
+/* Message tokens */
+
+static guint64 token_state[2];
+
+/* xorshift128+ */
+static guint64
+token_random (void)
+{
+  guint64 s1 = token_state[0];
+  guint64 const s0 = token_state[1];
+
+  token_state[0] = s0;
+  s1 ^= s1 << 23;
+  token_state[1] = s1 ^ s0 ^ (s1 >> 17) ^ (s0 >> 26);
+
+  return token_state[1] + s0;
+}
+
+/** Generate a random RFC 4122 version 4 UUID to be used as message token.
+ *
+ * The generator is seeded once per process from GLib, so unlike libuuid
+ * this does not read /dev/urandom for every token. The tokens are unique
+ * but predictable; do not use them as secrets. Not thread-safe.
+ *
+ * @return @a buffer
+ */
+char *
+ring_generate_token (char buffer[RING_TOKEN_LENGTH])
+{
+  static char const hex[] = "0123456789abcdef";
+  guint8 uu[16];
+  guint64 r;
+  guint i, j;
+
+  if (G_UNLIKELY (token_state[0] == 0 && token_state[1] == 0))
+    {
+      token_state[0] = (guint64)g_random_int () << 32 | g_random_int ();
+      token_state[1] = (guint64)g_random_int () << 32 | g_random_int () | 1;
+    }
+
+  for (i = 0; i < 16; i += 8)
+    for (r = token_random (), j = 0; j < 8; j++, r >>= 8)
+      uu[i + j] = (guint8)r;
+
+  /* Version 4, variant RFC 4122 */
+  uu[6] = (uu[6] & 0x0f) | 0x40;
+  uu[8] = (uu[8] & 0x3f) | 0x80;
+
+  for (i = 0, j = 0; i < 16; i++)
+    {
+      if (i == 4 || i == 6 || i == 8 || i == 10)
+        buffer[j++] = '-';
+      buffer[j++] = hex[uu[i] >> 4];
+      buffer[j++] = hex[uu[i] & 15];
+    }
+
+  buffer[j] = '\0';
+
+  return buffer;
+}
+
+
+/* ---------------------------------------------------------------------- */
+/* Channel index */
+
+/*
+ * A channel index maps a key, such as the peer handle of a call or the
+ * object path of a conference member, to the channels having it. The
+ * channels are not referenced; the channel manager adds a channel when
+ * it announces it and removes it when the channel is closed.
+ */
+
+struct _RingChannelIndex
+{
+  /* key => GSList of channels, oldest first */
+  GHashTable *table;
+  GBoxedCopyFunc key_copy;
+  GDestroyNotify key_free;
+};
+
+/** Create a channel index.
+ *
+ * If @a key_copy is given, the index keeps its own copy of each key,
+ * freed with @a key_free.
+ */
+RingChannelIndex *
+ring_channel_index_new (GHashFunc hash,
+                        GEqualFunc equal,
+                        GBoxedCopyFunc key_copy,
+                        GDestroyNotify key_free)
+{
+  RingChannelIndex *self = g_slice_new0 (RingChannelIndex);
+
+  self->table = g_hash_table_new_full (hash, equal, key_free,
+      (GDestroyNotify) g_slist_free);
+  self->key_copy = key_copy;
+  self->key_free = key_free;
+
+  return self;
+}
+
+void
+ring_channel_index_free (RingChannelIndex *self)
+{
+  if (self == NULL)
+    return;
+
+  g_hash_table_destroy (self->table);
+  g_slice_free (RingChannelIndex, self);
+}
+
+void
+ring_channel_index_add (RingChannelIndex *self,
+                        gconstpointer key,
+                        gpointer channel)
+{
+  GSList *list;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (channel != NULL);
+
+  list = g_hash_table_lookup (self->table, key);
+
+  if (list == NULL)
+    {
+      gpointer k = self->key_copy ? self->key_copy (key) : (gpointer) key;
+      g_hash_table_insert (self->table, k, g_slist_prepend (NULL, channel));
+    }
+  else if (!g_slist_find (list, channel))
+    {
+      /* Non-empty list keeps its head */
+      g_slist_append (list, channel);
+    }
+}
+
+void
+ring_channel_index_remove (RingChannelIndex *self,
+                           gconstpointer key,
+                           gpointer channel)
+{
+  gpointer stored_key, value;
+  GSList *list, *rest;
+
+  g_return_if_fail (self != NULL);
+
+  if (!g_hash_table_lookup_extended (self->table, key, &stored_key, &value))
+    return;
+
+  list = value;
+
+  rest = g_slist_remove (list, channel);
+  if (rest == list)
+    return;
+
+  /* The head was removed and freed, replace it without freeing the rest */
+  g_hash_table_steal (self->table, key);
+
+  if (rest)
+    g_hash_table_insert (self->table, stored_key, rest);
+  else if (self->key_free)
+    self->key_free (stored_key);
+}
+
+void
+ring_channel_index_remove_all (RingChannelIndex *self)
+{
+  g_return_if_fail (self != NULL);
+
+  g_hash_table_remove_all (self->table);
+}
+
+/** Return the oldest channel with @a key, or NULL. */
+gpointer
+ring_channel_index_lookup (RingChannelIndex const *self,
+                           gconstpointer key)
+{
+  GSList *list;
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  list = g_hash_table_lookup (self->table, key);
+
+  return list ? list->data : NULL;
+}
+
+/** Return all channels with @a key, oldest first. */
+GSList const *
+ring_channel_index_lookup_all (RingChannelIndex const *self,
+                               gconstpointer key)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+
+  return g_hash_table_lookup (self->table, key);
+}
@@ -99,6 +99,31 @@ ring_signal_disconnect (gpointer object, gulong id[1])
 gboolean tp_asv_get_initial_audio (GHashTable *asv, gboolean default_value);
 gboolean tp_asv_get_initial_video (GHashTable *asv, gboolean default_value);
 
+/* Length of a message token, including the terminating NUL */
+#define RING_TOKEN_LENGTH (37)
+
+char *ring_generate_token (char buffer[RING_TOKEN_LENGTH]);
+
+/* Channels by peer handle, member object path or other key */
+typedef struct _RingChannelIndex RingChannelIndex;
+
+RingChannelIndex *ring_channel_index_new (GHashFunc hash,
+  GEqualFunc equal,
+  GBoxedCopyFunc key_copy,
+  GDestroyNotify key_free);
+void ring_channel_index_free (RingChannelIndex *);
+
+void ring_channel_index_add (RingChannelIndex *,
+  gconstpointer key, gpointer channel);
+void ring_channel_index_remove (RingChannelIndex *,
+  gconstpointer key, gpointer channel);
+void ring_channel_index_remove_all (RingChannelIndex *);
+
+gpointer ring_channel_index_lookup (RingChannelIndex const *,
+  gconstpointer key);
+GSList const *ring_channel_index_lookup_all (RingChannelIndex const *,
+  gconstpointer key);
+
 G_END_DECLS
 
 #endif /* #ifndef __RING_UTIL_H__*/
@@ -28,6 +28,8 @@
 
 #include <telepathy-glib/run.h>
 
+#include "modem/request.h"
+
 #include <stdlib.h>
 #include <sched.h>
 #include <sys/mman.h>
@@ -37,6 +39,7 @@
 #include <sys/resource.h>
 #include <errno.h>
 #include <string.h>
+#include <signal.h>
 #include <unistd.h>
 #if HAVE_LIBMLOCKNICE
 #include <mlocknice.h>
@@ -73,6 +76,68 @@ readfile(char *file)
   return g_strdup(buffer + ws);
 }
 
+/* Log pending modem requests and request latencies upon SIGUSR1.
+ *
+ * g_unix_signal_add() handles SIGUSR1 only since GLib 2.36, so the
+ * signal handler just writes to a pipe watched by the main loop. */
+static int telepathy_ring_signal_pipe[2] = { -1, -1 };
+
+static void
+telepathy_ring_on_sigusr1(int signo)
+{
+  int saved_errno = errno;
+  char c = 0;
+
+  if (write(telepathy_ring_signal_pipe[1], &c, 1) < 0)
+    ;                           /* Pipe full, dump is pending anyway */
+
+  errno = saved_errno;
+}
+
+static gboolean
+telepathy_ring_dump_requests(GIOChannel *source,
+  GIOCondition condition,
+  gpointer user_data)
+{
+  char buffer[64];
+
+  while (read(telepathy_ring_signal_pipe[0], buffer, sizeof buffer) > 0)
+    ;
+
+  modem_request_dump();
+  return TRUE;
+}
+
+static void
+telepathy_ring_catch_sigusr1(void)
+{
+  struct sigaction sa[1];
+  GIOChannel *channel;
+  int i;
+
+  if (pipe(telepathy_ring_signal_pipe) < 0) {
+    DEBUG("pipe(): %s", strerror(errno));
+    return;
+  }
+
+  for (i = 0; i < 2; i++) {
+    fcntl(telepathy_ring_signal_pipe[i], F_SETFL, O_NONBLOCK);
+    fcntl(telepathy_ring_signal_pipe[i], F_SETFD, FD_CLOEXEC);
+  }
+
+  channel = g_io_channel_unix_new(telepathy_ring_signal_pipe[0]);
+  g_io_add_watch(channel, G_IO_IN, telepathy_ring_dump_requests, NULL);
+  g_io_channel_unref(channel);
+
+  memset(sa, 0, sizeof sa);
+  sa->sa_handler = telepathy_ring_on_sigusr1;
+  sa->sa_flags = SA_RESTART;
+  sigemptyset(&sa->sa_mask);
+
+  if (sigaction(SIGUSR1, sa, NULL) < 0)
+    DEBUG("sigaction(SIGUSR1): %s", strerror(errno));
+}
+
 #define STATEDIR "/var/lib/telepathy-ring/"
 
 int
@@ -166,6 +231,8 @@ main (int argc, char** argv)
 #endif
   }
 
+  telepathy_ring_catch_sigusr1();
+
   return tp_run_connection_manager(
     "telepathy-ring", PACKAGE_VERSION,
     telepathy_ring_connection_manager_new,
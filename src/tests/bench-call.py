@@ -0,0 +1,163 @@
+#!/usr/bin/env python
+#
+# bench-call.py - time incoming calls from oFono CallAdded to NewChannels
+#
+# Copyright (C) 2011 Nokia Corporation
+#
+# This work is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This work is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this work; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+"""Drive incoming calls through telepathy-ring and fake oFono.
+
+Connects to the fake modem at /bench, then makes the fake oFono emit
+CallAdded for an incoming call, one at a time, and waits for the
+NewChannels signal for each. The time from asking for the call to
+seeing the channel is reported, as well as the CallAdded to
+NewChannels latency measured by telepathy-ring itself.
+
+Usage: bench-call.py [count]
+"""
+
+import sys
+import time
+
+import dbus
+from dbus.mainloop.glib import DBusGMainLoop
+
+try:
+    from gi.repository import GLib as gobject
+except ImportError:
+    import gobject
+
+CM_NAME = 'org.freedesktop.Telepathy.ConnectionManager.ring'
+CM_PATH = '/org/freedesktop/Telepathy/ConnectionManager/ring'
+CM = 'org.freedesktop.Telepathy.ConnectionManager'
+CONN = 'org.freedesktop.Telepathy.Connection'
+REQUESTS = 'org.freedesktop.Telepathy.Connection.Interface.Requests'
+DEBUG = 'com.Nokia.Telepathy.Connection.Interface.Debug'
+BENCH = 'org.ofono.Bench'
+
+TIMEOUT = 20
+
+
+class Bench(object):
+    def __init__(self, bus, system_bus):
+        self.loop = gobject.MainLoop()
+        self.channels = 0
+        self.status = None
+
+        cm = bus.get_object(CM_NAME, CM_PATH)
+        name, path = cm.RequestConnection('tel',
+            {'modem': dbus.ObjectPath('/bench')}, dbus_interface=CM)
+
+        self.conn = bus.get_object(name, path)
+        self.conn.connect_to_signal('StatusChanged', self.on_status_changed,
+                                    dbus_interface=CONN)
+        self.conn.connect_to_signal('NewChannels', self.on_new_channels,
+                                    dbus_interface=REQUESTS)
+
+        self.control = system_bus.get_object('org.ofono', '/')
+
+    def on_status_changed(self, status, reason):
+        self.status = status
+        self.loop.quit()
+
+    def on_new_channels(self, channels):
+        self.channels += len(channels)
+        self.loop.quit()
+
+    def on_timeout(self):
+        self.loop.quit()
+        return False
+
+    def wait(self, done):
+        timer = gobject.timeout_add_seconds(TIMEOUT, self.on_timeout)
+        deadline = time.time() + TIMEOUT
+        while not done() and time.time() < deadline:
+            self.loop.run()
+        gobject.source_remove(timer)
+        return done()
+
+    def connect(self):
+        self.conn.Connect(dbus_interface=CONN)
+        return self.wait(lambda: self.status == 0)
+
+    def ring(self):
+        seen = self.channels
+        started = time.time()
+        self.control.Emit('call', dbus.UInt32(1), dbus_interface=BENCH)
+        if not self.wait(lambda: self.channels > seen):
+            return None
+        return time.time() - started
+
+    def server_latency(self):
+        for row in self.conn.GetRequestLatencies(dbus_interface=DEBUG):
+            if row[0] == 'ring' and row[1] == 'CallAdded':
+                return row
+        return None
+
+    def disconnect(self):
+        self.conn.Disconnect(dbus_interface=CONN)
+
+
+def percentile(samples, p):
+    return samples[min(len(samples) - 1, int(len(samples) * p))]
+
+
+def main():
+    count = 100
+    if len(sys.argv) > 1:
+        count = int(sys.argv[1])
+
+    DBusGMainLoop(set_as_default=True)
+
+    bus = dbus.SessionBus()
+
+    # telepathy-ring is started by the caller, wait for it to show up
+    for i in range(100):
+        if bus.name_has_owner(CM_NAME):
+            break
+        time.sleep(0.1)
+
+    bench = Bench(bus, dbus.SystemBus())
+
+    if not bench.connect():
+        sys.stderr.write('bench-call: connection did not come up\n')
+        return 1
+
+    samples = []
+    for i in range(count):
+        latency = bench.ring()
+        if latency is None:
+            sys.stderr.write('bench-call: no channel for call %u\n' % i)
+            return 1
+        samples.append(latency * 1000.0)
+
+    samples.sort()
+    print('%-12s %6u calls  min %.2f  median %.2f  p90 %.2f  max %.2f ms' % (
+        'time-to-ring', len(samples), samples[0], percentile(samples, 0.5),
+        percentile(samples, 0.9), samples[-1]))
+
+    row = bench.server_latency()
+    if row:
+        print('%-12s %6u calls  mean %u ms  max %u ms  histogram %s' % (
+            'CallAdded', row[2], row[3], row[4],
+            ' '.join([str(b) for b in row[5]])))
+
+    bench.disconnect()
+
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,221 @@
+/*
+ * bench-ring.c - Benchmark connection manager hot paths in-process
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Run with "make bench". Each scenario is run in a loop, and the
+ * process CPU time and the number of memory allocations spent per
+ * operation are reported.
+ */
+
+#include "config.h"
+
+#include <ring-util.h>
+#include <ring-sms-store.h>
+#include <util.h>
+
+#include <uuid/uuid.h>
+
+#include <glib/gstdio.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ---------------------------------------------------------------------- */
+/* Allocation counting */
+
+static volatile gint n_allocs;
+
+static gpointer
+bench_malloc (gsize n)
+{
+  g_atomic_int_inc (&n_allocs);
+  return malloc (n);
+}
+
+static gpointer
+bench_realloc (gpointer mem, gsize n)
+{
+  if (mem == NULL)
+    g_atomic_int_inc (&n_allocs);
+  return realloc (mem, n);
+}
+
+static gpointer
+bench_calloc (gsize n_blocks, gsize n_block_bytes)
+{
+  g_atomic_int_inc (&n_allocs);
+  return calloc (n_blocks, n_block_bytes);
+}
+
+static GMemVTable bench_vtable = {
+  bench_malloc, bench_realloc, free, bench_calloc, bench_malloc, bench_realloc
+};
+
+/* ---------------------------------------------------------------------- */
+
+static gint64
+cpu_time (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+  return (gint64)ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static void
+bench_loop (char const *name,
+            void (*func) (gpointer),
+            gpointer data,
+            guint n)
+{
+  gint64 cpu;
+  gint allocs;
+  guint i;
+
+  for (i = 0; i < 100; i++)
+    func (data);
+
+  allocs = g_atomic_int_get (&n_allocs);
+  cpu = cpu_time ();
+  for (i = 0; i < n; i++)
+    func (data);
+  cpu = cpu_time () - cpu;
+  allocs = g_atomic_int_get (&n_allocs) - allocs;
+
+  printf ("%-12s %10.0f ops/cpu-s  %8.0f ns/op  %6.1f allocs/op\n",
+      name,
+      cpu > 0 ? n * (double)G_USEC_PER_SEC / cpu : 0.0,
+      cpu * 1000.0 / n,
+      (double)allocs / n);
+}
+
+/* ---------------------------------------------------------------------- */
+/* Scenarios */
+
+static void
+loop_token (gpointer dummy)
+{
+  char token[RING_TOKEN_LENGTH];
+
+  ring_generate_token (token);
+}
+
+/* How tokens for received messages used to be generated */
+static void
+loop_libuuid (gpointer dummy)
+{
+  char *token;
+  uuid_t uu;
+
+  token = g_new (gchar, 37);
+  uuid_generate_random (uu);
+  uuid_unparse_lower (uu, token);
+  g_free (token);
+}
+
+static void
+loop_generate_id (gpointer dummy)
+{
+  g_free (ring_generate_id ());
+}
+
+/* Received messages waiting to be expunged */
+#define STORED_MESSAGES (1000)
+
+static void
+on_stored (char const *token, char const *sender, char const *text,
+    gint64 sent, gint64 received, gpointer dummy)
+{
+}
+
+static void
+loop_store_get (gpointer store)
+{
+  ring_sms_store_get (store, "token-500", on_stored, NULL);
+}
+
+static void
+loop_store_add_expunge (gpointer store)
+{
+  char const *tokens[] = { "token-new", NULL };
+
+  ring_sms_store_add (store, tokens[0], "+358401234567", "message", 0, 0);
+  g_strfreev (ring_sms_store_expunge (store, tokens));
+}
+
+static void
+bench_store (guint n)
+{
+  RingSMSStore *store;
+  char *path;
+  char token[32];
+  guint i;
+  int fd;
+
+  fd = g_file_open_tmp ("bench-ring-store-XXXXXX", &path, NULL);
+  if (fd < 0)
+    return;
+  close (fd);
+  g_unlink (path);
+
+  store = ring_sms_store_open (path, NULL);
+
+  for (i = 0; i < STORED_MESSAGES; i++)
+    {
+      g_snprintf (token, sizeof token, "token-%u", i);
+      ring_sms_store_add (store, token, "+358401234567", "message", 0, 0);
+    }
+
+  bench_loop ("store-get", loop_store_get, store, n);
+  bench_loop ("store-add", loop_store_add_expunge, store, n / 10);
+
+  ring_sms_store_close (store);
+  g_unlink (path);
+  g_free (path);
+}
+
+/* ---------------------------------------------------------------------- */
+
+int
+main (int argc, char **argv)
+{
+  guint n = 100000;
+
+  /* Must be done before anything else allocates memory */
+  g_mem_set_vtable (&bench_vtable);
+
+  if (argc > 1)
+    n = strtoul (argv[1], NULL, 0);
+  if (n < 100)
+    n = 100;
+
+  g_type_init ();
+
+  bench_loop ("token", loop_token, NULL, n);
+  bench_loop ("libuuid", loop_libuuid, NULL, n);
+  bench_loop ("generate-id", loop_generate_id, NULL, n);
+  bench_store (n);
+
+  return 0;
+}
@@ -0,0 +1,36 @@
+#!/bin/sh
+#
+# run-bench-call.sh - run bench-call.py against telepathy-ring and fake oFono
+#
+# Run from with-session-bus.sh, the session bus is used as the system
+# bus for the fake oFono and telepathy-ring.
+#
+
+set -e
+
+srcdir=${srcdir:-.}
+PYTHON=${PYTHON:-python}
+
+DBUS_SYSTEM_BUS_ADDRESS="$DBUS_SESSION_BUS_ADDRESS"
+export DBUS_SYSTEM_BUS_ADDRESS
+
+$PYTHON $srcdir/../modem/tests/fake-ofono.py > fake-ofono.log 2>&1 &
+fake=$!
+
+./telepathy-ring > telepathy-ring.log 2>&1 &
+ring=$!
+
+trap 'kill $fake $ring 2>/dev/null || :' EXIT
+
+i=0
+until grep -q ready fake-ofono.log; do
+  i=`expr $i + 1`
+  if test $i -gt 100 || ! kill -0 $fake 2>/dev/null; then
+    echo "run-bench-call: fake oFono did not start" >&2
+    cat fake-ofono.log >&2
+    exit 1
+  fi
+  sleep 0.1
+done
+
+$PYTHON $srcdir/tests/bench-call.py "$@"
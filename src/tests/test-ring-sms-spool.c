@@ -0,0 +1,227 @@
+/*
+ * test-ring-sms-spool.c - Test cases for outgoing SMS spool
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include <ring-sms-spool.h>
+#include "test-ring.h"
+
+#include <glib/gstdio.h>
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static char *spool_dir;
+static char *spool_path;
+
+static void setup(void)
+{
+  spool_dir = g_build_filename(g_get_tmp_dir(), "test-ring-XXXXXX", NULL);
+  fail_unless(mkdtemp(spool_dir) != NULL);
+  spool_path = g_build_filename(spool_dir, "spool", NULL);
+}
+
+static void teardown(void)
+{
+  g_unlink(spool_path);
+  g_rmdir(spool_dir);
+  g_free(spool_path), spool_path = NULL;
+  g_free(spool_dir), spool_dir = NULL;
+}
+
+static char *
+find(char *haystack, gsize length, char const *needle)
+{
+  gsize n = strlen(needle), i;
+
+  for (i = 0; i + n <= length; i++)
+    if (memcmp(haystack + i, needle, n) == 0)
+      return haystack + i;
+
+  return NULL;
+}
+
+static void
+collect(guint id,
+  char const *destination,
+  char const *text,
+  char const *token,
+  guint flags,
+  gpointer user_data)
+{
+  g_ptr_array_add(user_data,
+    g_strdup_printf("%u:%s:%s:%s:%u", id, destination, text, token, flags));
+}
+
+static GPtrArray *
+spooled(RingSMSSpool *spool)
+{
+  GPtrArray *array = g_ptr_array_new_with_free_func(g_free);
+  ring_sms_spool_foreach(spool, collect, array);
+  return array;
+}
+
+START_TEST(test_spool_reopen)
+{
+  RingSMSSpool *spool;
+  GPtrArray *array;
+  GError *error = NULL;
+  char *long_text;
+  guint a, b, c;
+
+  spool = ring_sms_spool_open(spool_path, &error);
+  fail_unless(spool != NULL);
+
+  long_text = g_strnfill(1000, 'x');
+
+  a = ring_sms_spool_append(spool, "+358401234567", "first", "t1", 0);
+  b = ring_sms_spool_append(spool, "+358401234568", long_text, "t2", 1);
+  c = ring_sms_spool_append(spool, "+358401234569", "third", "t3", 2);
+  fail_unless(a != 0 && b != 0 && c != 0);
+  fail_unless(a != b && b != c && a != c);
+  fail_unless(ring_sms_spool_size(spool) == 3);
+
+  ring_sms_spool_remove(spool, a);
+  ring_sms_spool_remove(spool, a);
+  fail_unless(ring_sms_spool_size(spool) == 2);
+
+  ring_sms_spool_close(spool);
+
+  spool = ring_sms_spool_open(spool_path, &error);
+  fail_unless(spool != NULL);
+  fail_unless(ring_sms_spool_size(spool) == 2);
+
+  array = spooled(spool);
+  fail_unless(array->len == 2);
+  fail_unless(g_str_has_prefix(array->pdata[0], "2:+358401234568:xxx"));
+  fail_unless(g_str_has_suffix(array->pdata[0], "xxx:t2:1"));
+  fail_unless(strcmp(array->pdata[1], "3:+358401234569:third:t3:2") == 0);
+  g_ptr_array_free(array, TRUE);
+
+  /* Ids are not reused after reopen */
+  fail_unless(ring_sms_spool_append(spool, "+358401234567", "fourth", "t4", 0) > c);
+
+  ring_sms_spool_close(spool);
+  g_free(long_text);
+}
+END_TEST
+
+START_TEST(test_spool_compact)
+{
+  RingSMSSpool *spool;
+  GPtrArray *array;
+  GError *error = NULL;
+  guint i, id, keep = 0;
+  struct stat before, after;
+  char expected[64];
+
+  spool = ring_sms_spool_open(spool_path, &error);
+  fail_unless(spool != NULL);
+
+  for (i = 0; i < 2000; i++) {
+    id = ring_sms_spool_append(spool, "+358401234567", "message", "t", i);
+    fail_unless(id != 0);
+    if (i == 1234)
+      keep = id;
+    else
+      ring_sms_spool_remove(spool, id);
+  }
+
+  ring_sms_spool_sync(spool);
+  fail_unless(g_stat(spool_path, &before) == 0);
+
+  fail_unless(ring_sms_spool_compact(spool, &error));
+  fail_unless(g_stat(spool_path, &after) == 0);
+  fail_unless(after.st_size < before.st_size);
+  fail_unless((after.st_mode & 0777) == 0600);
+
+  array = spooled(spool);
+  fail_unless(array->len == 1);
+  g_snprintf(expected, sizeof expected, "%u:+358401234567:message:t:1234", keep);
+  fail_unless(strcmp(array->pdata[0], expected) == 0);
+  g_ptr_array_free(array, TRUE);
+
+  ring_sms_spool_remove(spool, keep);
+  ring_sms_spool_close(spool);
+
+  spool = ring_sms_spool_open(spool_path, &error);
+  fail_unless(spool != NULL);
+  fail_unless(ring_sms_spool_size(spool) == 0);
+  ring_sms_spool_close(spool);
+}
+END_TEST
+
+START_TEST(test_spool_torn_record)
+{
+  RingSMSSpool *spool;
+  GError *error = NULL;
+  char *content;
+  gsize length;
+  guint a;
+
+  spool = ring_sms_spool_open(spool_path, &error);
+  fail_unless(spool != NULL);
+  a = ring_sms_spool_append(spool, "+358401234567", "complete", "t1", 0);
+  ring_sms_spool_append(spool, "+358401234568", "torn", "t2", 0);
+  ring_sms_spool_close(spool);
+
+  /* Corrupt text of the second message */
+  fail_unless(g_file_get_contents(spool_path, &content, &length, NULL));
+  fail_unless(find(content, length, "torn") != NULL);
+  memcpy(find(content, length, "torn"), "TORN", 4);
+  fail_unless(g_file_set_contents(spool_path, content, length, NULL));
+  g_free(content);
+
+  spool = ring_sms_spool_open(spool_path, &error);
+  fail_unless(spool != NULL);
+  fail_unless(ring_sms_spool_size(spool) == 1);
+
+  /* The torn record gets overwritten */
+  fail_unless(ring_sms_spool_append(spool, "+358401234569", "new", "t3", 0) > a);
+  ring_sms_spool_close(spool);
+
+  spool = ring_sms_spool_open(spool_path, &error);
+  fail_unless(ring_sms_spool_size(spool) == 2);
+  ring_sms_spool_close(spool);
+}
+END_TEST
+
+static TCase *
+ring_sms_spool_tcase(void)
+{
+  TCase *tc = tcase_create("Test for outgoing SMS spool");
+
+  tcase_add_checked_fixture(tc, setup, teardown);
+
+  tcase_add_test(tc, test_spool_reopen);
+  tcase_add_test(tc, test_spool_compact);
+  tcase_add_test(tc, test_spool_torn_record);
+
+  tcase_set_timeout(tc, 5);
+
+  return tc;
+}
+
+struct test_cases ring_sms_spool_tcases[] = {
+  DECLARE_TEST_CASE(ring_sms_spool_tcase),
+  LAST_TEST_CASE
+};
@@ -0,0 +1,292 @@
+/*
+ * test-ring-sms-store.c - Test cases for received SMS store
+ *
+ * Copyright (C) 2011 Nokia Corporation
+ *
+ * This work is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This work is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "config.h"
+
+#include <ring-sms-store.h>
+#include "test-ring.h"
+
+#include <glib/gstdio.h>
+
+#include <sys/stat.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static char *store_dir;
+static char *store_path;
+
+static void setup(void)
+{
+  store_dir = g_build_filename(g_get_tmp_dir(), "test-ring-XXXXXX", NULL);
+  fail_unless(mkdtemp(store_dir) != NULL);
+  store_path = g_build_filename(store_dir, "store", NULL);
+}
+
+static void teardown(void)
+{
+  g_unlink(store_path);
+  g_rmdir(store_dir);
+  g_free(store_path), store_path = NULL;
+  g_free(store_dir), store_dir = NULL;
+}
+
+static void
+format(char const *token,
+  char const *sender,
+  char const *text,
+  gint64 sent,
+  gint64 received,
+  gpointer user_data)
+{
+  g_snprintf(user_data, 128, "%s:%s:%s:%d:%d",
+    token, sender, text, (int)sent, (int)received);
+}
+
+static gboolean
+lookup(RingSMSStore *store, char const *token, char const *expected)
+{
+  char buffer[128] = "";
+
+  if (!ring_sms_store_get(store, token, format, buffer))
+    return FALSE;
+
+  return strcmp(buffer, expected) == 0;
+}
+
+START_TEST(test_store_reopen)
+{
+  RingSMSStore *store;
+  GError *error = NULL;
+  char **tokens;
+
+  store = ring_sms_store_open(store_path, &error);
+  fail_unless(store != NULL);
+
+  fail_unless(ring_sms_store_add(store, "a", "+358401234567", "first", 1, 2));
+  fail_unless(ring_sms_store_add(store, "b", "+358401234568", "", 3, 4));
+  fail_unless(ring_sms_store_add(store, "c", "+358401234567", "third", 5, 6));
+  fail_unless(ring_sms_store_size(store) == 3);
+
+  fail_unless(lookup(store, "a", "a:+358401234567:first:1:2"));
+  fail_unless(lookup(store, "b", "b:+358401234568::3:4"));
+  fail_if(ring_sms_store_contains(store, "d"));
+
+  tokens = ring_sms_store_list_sender(store, "+358401234567");
+  fail_unless(g_strv_length(tokens) == 2);
+  fail_unless(strcmp(tokens[0], "a") == 0 && strcmp(tokens[1], "c") == 0);
+  g_strfreev(tokens);
+
+  ring_sms_store_close(store);
+
+  store = ring_sms_store_open(store_path, &error);
+  fail_unless(store != NULL);
+  fail_unless(ring_sms_store_size(store) == 3);
+  fail_unless(lookup(store, "c", "c:+358401234567:third:5:6"));
+
+  tokens = ring_sms_store_list(store);
+  fail_unless(g_strv_length(tokens) == 3);
+  fail_unless(strcmp(tokens[0], "a") == 0 && strcmp(tokens[2], "c") == 0);
+  g_strfreev(tokens);
+
+  ring_sms_store_close(store);
+}
+END_TEST
+
+START_TEST(test_store_expunge)
+{
+  RingSMSStore *store;
+  GError *error = NULL;
+  char const *batch[] = { "a", "unknown", "c", "a", NULL };
+  char **expunged;
+  char token[16];
+  guint i;
+
+  store = ring_sms_store_open(store_path, &error);
+  fail_unless(store != NULL);
+
+  for (i = 0; i < 10; i++) {
+    g_snprintf(token, sizeof token, "%c", 'a' + i);
+    fail_unless(ring_sms_store_add(store, token,
+        i % 2 ? "+358401234568" : "+358401234567", "message", i, i));
+  }
+
+  expunged = ring_sms_store_expunge(store, batch);
+  fail_unless(g_strv_length(expunged) == 2);
+  fail_unless(strcmp(expunged[0], "a") == 0);
+  fail_unless(strcmp(expunged[1], "c") == 0);
+  g_strfreev(expunged);
+  fail_unless(ring_sms_store_size(store) == 8);
+
+  expunged = ring_sms_store_expunge_sender(store, "+358401234568");
+  fail_unless(g_strv_length(expunged) == 5);
+  g_strfreev(expunged);
+
+  expunged = ring_sms_store_expunge_sender(store, "+358401234568");
+  fail_unless(expunged[0] == NULL);
+  g_strfreev(expunged);
+
+  fail_unless(ring_sms_store_size(store) == 3);
+  ring_sms_store_close(store);
+
+  store = ring_sms_store_open(store_path, &error);
+  fail_unless(ring_sms_store_size(store) == 3);
+  fail_unless(ring_sms_store_contains(store, "e"));
+  fail_if(ring_sms_store_contains(store, "b"));
+  ring_sms_store_close(store);
+}
+END_TEST
+
+START_TEST(test_store_expunge_old)
+{
+  RingSMSStore *store;
+  GError *error = NULL;
+  char **expunged;
+  char token[16];
+  guint i;
+
+  store = ring_sms_store_open(store_path, &error);
+  fail_unless(store != NULL);
+
+  for (i = 0; i < 10; i++) {
+    g_snprintf(token, sizeof token, "%c", 'a' + i);
+    fail_unless(ring_sms_store_add(store, token, "+358401234567",
+        "message", 100 + i, 100 + i));
+  }
+
+  /* Nothing is too old or too many */
+  expunged = ring_sms_store_expunge_old(store, 10, 100);
+  fail_unless(expunged[0] == NULL);
+  g_strfreev(expunged);
+
+  /* Received before 102 */
+  expunged = ring_sms_store_expunge_old(store, 10, 102);
+  fail_unless(g_strv_length(expunged) == 2);
+  fail_unless(strcmp(expunged[0], "a") == 0);
+  fail_unless(strcmp(expunged[1], "b") == 0);
+  g_strfreev(expunged);
+
+  /* Oldest over the limit */
+  expunged = ring_sms_store_expunge_old(store, 5, 0);
+  fail_unless(g_strv_length(expunged) == 3);
+  fail_unless(strcmp(expunged[0], "c") == 0);
+  fail_unless(strcmp(expunged[2], "e") == 0);
+  g_strfreev(expunged);
+
+  fail_unless(ring_sms_store_size(store) == 5);
+  fail_unless(ring_sms_store_contains(store, "f"));
+  ring_sms_store_close(store);
+}
+END_TEST
+
+START_TEST(test_store_compact)
+{
+  RingSMSStore *store;
+  GError *error = NULL;
+  char const *batch[2] = { NULL, NULL };
+  char token[16];
+  guint i;
+  struct stat before, after;
+
+  store = ring_sms_store_open(store_path, &error);
+  fail_unless(store != NULL);
+
+  for (i = 0; i < 1000; i++) {
+    g_snprintf(token, sizeof token, "token-%u", i);
+    fail_unless(ring_sms_store_add(store, token, "+358401234567",
+        "message", i, i));
+    if (i != 123) {
+      batch[0] = token;
+      g_strfreev(ring_sms_store_expunge(store, batch));
+    }
+  }
+
+  fail_unless(g_stat(store_path, &before) == 0);
+  fail_unless(ring_sms_store_compact(store, &error));
+  fail_unless(g_stat(store_path, &after) == 0);
+  fail_unless(after.st_size < before.st_size);
+  /* The messages are private whatever the umask */
+  fail_unless((after.st_mode & 0777) == 0600);
+
+  fail_unless(ring_sms_store_size(store) == 1);
+  fail_unless(lookup(store, "token-123",
+      "token-123:+358401234567:message:123:123"));
+
+  ring_sms_store_close(store);
+}
+END_TEST
+
+START_TEST(test_store_torn_record)
+{
+  RingSMSStore *store;
+  GError *error = NULL;
+  char *content, *torn;
+  gsize length;
+
+  store = ring_sms_store_open(store_path, &error);
+  fail_unless(store != NULL);
+  ring_sms_store_add(store, "a", "+358401234567", "complete", 0, 0);
+  ring_sms_store_add(store, "b", "+358401234568", "torn", 0, 0);
+  ring_sms_store_close(store);
+
+  /* Cut the second message short */
+  fail_unless(g_file_get_contents(store_path, &content, &length, NULL));
+  torn = g_strstr_len(content + 8, length - 8, "torn");
+  fail_unless(torn != NULL);
+  fail_unless(g_file_set_contents(store_path, content, torn - content, NULL));
+  g_free(content);
+
+  store = ring_sms_store_open(store_path, &error);
+  fail_unless(store != NULL);
+  fail_unless(ring_sms_store_size(store) == 1);
+
+  /* The torn record gets overwritten */
+  fail_unless(ring_sms_store_add(store, "c", "+358401234569", "new", 0, 0));
+  ring_sms_store_close(store);
+
+  store = ring_sms_store_open(store_path, &error);
+  fail_unless(ring_sms_store_size(store) == 2);
+  fail_unless(lookup(store, "c", "c:+358401234569:new:0:0"));
+  ring_sms_store_close(store);
+}
+END_TEST
+
+static TCase *
+ring_sms_store_tcase(void)
+{
+  TCase *tc = tcase_create("Test for received SMS store");
+
+  tcase_add_checked_fixture(tc, setup, teardown);
+
+  tcase_add_test(tc, test_store_reopen);
+  tcase_add_test(tc, test_store_expunge);
+  tcase_add_test(tc, test_store_expunge_old);
+  tcase_add_test(tc, test_store_compact);
+  tcase_add_test(tc, test_store_torn_record);
+
+  tcase_set_timeout(tc, 5);
+
+  return tc;
+}
+
+struct test_cases ring_sms_store_tcases[] = {
+  DECLARE_TEST_CASE(ring_sms_store_tcase),
+  LAST_TEST_CASE
+};
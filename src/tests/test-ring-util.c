@@ -157,6 +157,85 @@ START_TEST(test_properties_satisfy)
 }
 END_TEST
 
+START_TEST(test_generate_token)
+{
+  char token[RING_TOKEN_LENGTH];
+  GHashTable *seen = g_hash_table_new_full(g_str_hash, g_str_equal,
+                     g_free, NULL);
+  guint i, j;
+
+  for (i = 0; i < 1000; i++) {
+    fail_unless(ring_generate_token(token) == token);
+    fail_unless(strlen(token) == RING_TOKEN_LENGTH - 1);
+
+    for (j = 0; token[j]; j++) {
+      if (j == 8 || j == 13 || j == 18 || j == 23)
+        fail_unless(token[j] == '-');
+      else
+        fail_unless(g_ascii_isxdigit(token[j]) && !g_ascii_isupper(token[j]));
+    }
+
+    fail_unless(token[14] == '4');
+    fail_unless(strchr("89ab", token[19]) != NULL);
+
+    fail_if(g_hash_table_lookup(seen, token));
+    g_hash_table_insert(seen, g_strdup(token), token);
+  }
+
+  g_hash_table_destroy(seen);
+}
+END_TEST
+
+START_TEST(test_channel_index)
+{
+  RingChannelIndex *peers;
+  RingChannelIndex *paths;
+  int a, b, c;
+  GSList const *l;
+  char key[] = "/conn/incoming1";
+
+  peers = ring_channel_index_new(g_direct_hash, g_direct_equal, NULL, NULL);
+
+  fail_if(ring_channel_index_lookup(peers, GUINT_TO_POINTER(1)));
+
+  ring_channel_index_add(peers, GUINT_TO_POINTER(1), &a);
+  ring_channel_index_add(peers, GUINT_TO_POINTER(1), &b);
+  ring_channel_index_add(peers, GUINT_TO_POINTER(1), &b);
+  ring_channel_index_add(peers, GUINT_TO_POINTER(2), &c);
+
+  /* Oldest channel is found first */
+  fail_unless(ring_channel_index_lookup(peers, GUINT_TO_POINTER(1)) == &a);
+  fail_unless(ring_channel_index_lookup(peers, GUINT_TO_POINTER(2)) == &c);
+  l = ring_channel_index_lookup_all(peers, GUINT_TO_POINTER(1));
+  fail_unless(g_slist_length((GSList *)l) == 2);
+
+  ring_channel_index_remove(peers, GUINT_TO_POINTER(1), &a);
+  fail_unless(ring_channel_index_lookup(peers, GUINT_TO_POINTER(1)) == &b);
+  ring_channel_index_remove(peers, GUINT_TO_POINTER(1), &c);
+  fail_unless(ring_channel_index_lookup(peers, GUINT_TO_POINTER(1)) == &b);
+  ring_channel_index_remove(peers, GUINT_TO_POINTER(1), &b);
+  fail_if(ring_channel_index_lookup(peers, GUINT_TO_POINTER(1)));
+
+  ring_channel_index_remove_all(peers);
+  fail_if(ring_channel_index_lookup(peers, GUINT_TO_POINTER(2)));
+
+  ring_channel_index_free(peers);
+
+  /* Keys are copied */
+  paths = ring_channel_index_new(g_str_hash, g_str_equal,
+      (GBoxedCopyFunc)g_strdup, g_free);
+
+  ring_channel_index_add(paths, key, &a);
+  ring_channel_index_add(paths, key, &b);
+  ring_channel_index_remove(paths, key, &a);
+  key[strlen(key) - 1] = '2';
+  fail_if(ring_channel_index_lookup(paths, key));
+  fail_unless(ring_channel_index_lookup(paths, "/conn/incoming1") == &b);
+
+  ring_channel_index_free(paths);
+}
+END_TEST
+
 static TCase *
 ring_util_tcase(void)
 {
@@ -168,6 +247,8 @@ ring_util_tcase(void)
   tcase_add_test(tc, test_str_starts_with);
   tcase_add_test(tc, test_str_has_token);
   tcase_add_test(tc, test_properties_satisfy);
+  tcase_add_test(tc, test_generate_token);
+  tcase_add_test(tc, test_channel_index);
 
   tcase_set_timeout(tc, 5);
 
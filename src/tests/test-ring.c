@@ -45,6 +45,8 @@ main(int argc, char *argv[])
   args = parse_common_args(argc, argv);
 
   filter_add_tcases(suite, ring_tcases, args->tests);
+  filter_add_tcases(suite, ring_sms_spool_tcases, args->tests);
+  filter_add_tcases(suite, ring_sms_store_tcases, args->tests);
 
   runner = srunner_create(suite);
 
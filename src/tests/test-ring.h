@@ -25,6 +25,8 @@
 #include <test-common.h>
 
 extern struct test_cases ring_tcases[];
+extern struct test_cases ring_sms_spool_tcases[];
+extern struct test_cases ring_sms_store_tcases[];
 
 #endif
 